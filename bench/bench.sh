@@ -0,0 +1,48 @@
+# time halmos end to end on generated databases of several sizes
+# usage: sh bench/bench.sh [halmos] [mmgen]
+# BENCH_SIZES sets the numbers of theorems, BENCH_FLAGS extra mmgen flags
+
+HALMOS=$(cd "$(dirname "${1:-bin/halmos}")" && pwd)/$(basename "${1:-bin/halmos}")
+MMGEN=$(cd "$(dirname "${2:-bench/mmgen}")" && pwd)/$(basename "${2:-bench/mmgen}")
+SIZES=${BENCH_SIZES:-"1000 10000 50000"}
+DIR=$(mktemp -d)
+trap 'rm -rf "$DIR"' EXIT
+
+now() {
+	date +%s.%N
+}
+
+printf "%-10s %-11s %10s %10s %9s %12s %12s\n" "theorems" "proofs" \
+	"statements" "steps" "seconds" "stmts/sec" "steps/sec"
+for n in $SIZES
+do
+	for mode in normal compressed
+	do
+		z=""
+		if test $mode = compressed
+		then
+			z="-z"
+		fi
+		$MMGEN -t $n $z $BENCH_FLAGS > "$DIR/bench.mm" 2> "$DIR/stats" || exit 1
+		statements=$(awk '{print $2}' "$DIR/stats")
+		steps=$(awk '{print $4}' "$DIR/stats")
+		start=$(now)
+# halmos writes its preprocessed output to the current directory
+		(cd "$DIR" && "$HALMOS" bench.mm > out.log 2>&1)
+		end=$(now)
+		if ! grep -q "Found 0 errors" "$DIR/out.log" || \
+			test "$(grep -c "Found 0 errors" "$DIR/out.log")" -ne 2
+		then
+			echo "halmos reported errors on the generated database:"
+			tail "$DIR/out.log"
+			exit 1
+		fi
+		awk -v n=$n -v mode=$mode -v stmts=$statements -v steps=$steps \
+			-v start=$start -v end=$end 'BEGIN {
+			t = end - start
+			if (t <= 0) { t = 1e-9 }
+			printf "%-10d %-11s %10d %10d %9.3f %12.0f %12.0f\n", n, mode,
+				stmts, steps, t, stmts / t, steps / t
+		}'
+	done
+done
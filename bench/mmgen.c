@@ -0,0 +1,531 @@
+/* generate a valid metamath database of configurable size, for */
+/* benchmarking. The database is written to stdout. A summary line with */
+/* the number of statements and proof steps is written to stderr */
+/* */
+/* The database has a single typecode wff built from constants, variables, */
+/* negation and implication. Theorems prove ( T -> T ) for random terms T */
+/* through an identity axiom, instantiate earlier theorems with random */
+/* substitutions, or apply modus ponens to an essential hypothesis. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum op {
+  op_var,
+  op_const,
+  op_neg,
+  op_imp
+};
+
+struct term {
+  enum op op;
+  size_t id;
+  struct term* a;
+  struct term* b;
+};
+
+struct options {
+  size_t constants;
+  size_t variables;
+  size_t theorems;
+/* number of nested ${ $} blocks around each theorem */
+  size_t depth;
+/* percentage of variable pairs of a theorem with a $d restriction */
+  size_t disjoint;
+/* approximate number of proof steps */
+  size_t length;
+  int isCompressed;
+  unsigned long seed;
+};
+
+/* theorems of the form ( S -> S ) which later theorems may instantiate */
+enum { lemma_window = 64 };
+
+struct lemma {
+  size_t id;
+  struct term* stmt;
+/* variables of the statement in increasing order */
+  size_t* vars;
+  size_t varc;
+/* 1 for variables which occur in a $d restriction */
+  char* isDisjoint;
+};
+
+/* a proof step. label is either a printed label or a tag reference */
+struct step {
+  char label[32];
+/* index of the tag this step refers to, or -1 */
+  long tagRef;
+  int isTagged;
+};
+
+struct proof {
+  struct step* steps;
+  size_t size;
+  size_t max;
+  size_t tags;
+};
+
+static unsigned long rng_state;
+
+static size_t
+rnd(size_t n)
+{
+/* xorshift64 */
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 7;
+  rng_state ^= rng_state << 17;
+  return (size_t) (rng_state % n);
+}
+
+static void*
+xalloc(size_t size)
+{
+  void* p = malloc(size);
+  if (!p) {
+    fprintf(stderr, "out of memory\n");
+    exit(1);
+  }
+  return p;
+}
+
+static struct term*
+termNew(enum op op, size_t id, struct term* a, struct term* b)
+{
+  struct term* t = xalloc(sizeof(struct term));
+  t->op = op;
+  t->id = id;
+  t->a = a;
+  t->b = b;
+  return t;
+}
+
+static void
+termFree(struct term* t)
+{
+  if (!t) { return; }
+  termFree(t->a);
+  termFree(t->b);
+  free(t);
+}
+
+/* a random term with about n nodes. If isClosed, no variables are used */
+static struct term*
+termRandom(const struct options* opt, size_t n, int isClosed)
+{
+  if (n <= 1) {
+    if (!isClosed && rnd(2)) {
+      return termNew(op_var, rnd(opt->variables), NULL, NULL);
+    }
+    return termNew(op_const, rnd(opt->constants), NULL, NULL);
+  }
+  if (rnd(5) == 0) {
+    return termNew(op_neg, 0, termRandom(opt, n - 1, isClosed), NULL);
+  }
+  size_t left = 1 + rnd(n - 1);
+  return termNew(op_imp, 0, termRandom(opt, left, isClosed),
+    termRandom(opt, n - left, isClosed));
+}
+
+static struct term*
+termCopy(const struct term* t)
+{
+  if (!t) { return NULL; }
+  return termNew(t->op, t->id, termCopy(t->a), termCopy(t->b));
+}
+
+/* substitute variables with the terms in sub, indexed by variable */
+static struct term*
+termSubstitute(const struct term* t, struct term* const* sub)
+{
+  if (t->op == op_var) { return termCopy(sub[t->id]); }
+  struct term* a = t->a ? termSubstitute(t->a, sub) : NULL;
+  struct term* b = t->b ? termSubstitute(t->b, sub) : NULL;
+  return termNew(t->op, t->id, a, b);
+}
+
+static void
+termVariables(const struct term* t, char* isUsed)
+{
+  if (!t) { return; }
+  if (t->op == op_var) { isUsed[t->id] = 1; }
+  termVariables(t->a, isUsed);
+  termVariables(t->b, isUsed);
+}
+
+static void
+termPrint(FILE* f, const struct term* t)
+{
+  switch (t->op) {
+  case op_var:
+    fprintf(f, " v%lu", (unsigned long) t->id);
+    break;
+  case op_const:
+    fprintf(f, " c%lu", (unsigned long) t->id);
+    break;
+  case op_neg:
+    fprintf(f, " -.");
+    termPrint(f, t->a);
+    break;
+  case op_imp:
+    fprintf(f, " (");
+    termPrint(f, t->a);
+    fprintf(f, " ->");
+    termPrint(f, t->b);
+    fprintf(f, " )");
+    break;
+  }
+}
+
+static void
+proofAdd(struct proof* prf, const char* label)
+{
+  if (prf->size == prf->max) {
+    prf->max = prf->max ? 2 * prf->max : 64;
+    prf->steps = realloc(prf->steps, sizeof(struct step) * prf->max);
+    if (!prf->steps) {
+      fprintf(stderr, "out of memory\n");
+      exit(1);
+    }
+  }
+  struct step* s = &prf->steps[prf->size++];
+  strncpy(s->label, label, sizeof(s->label) - 1);
+  s->label[sizeof(s->label) - 1] = '\0';
+  s->tagRef = -1;
+  s->isTagged = 0;
+}
+
+/* push the syntax proof of t */
+static void
+proofSyntax(struct proof* prf, const struct term* t)
+{
+  char label[32];
+  switch (t->op) {
+  case op_var:
+    sprintf(label, "wv%lu", (unsigned long) t->id);
+    proofAdd(prf, label);
+    break;
+  case op_const:
+    sprintf(label, "wc%lu", (unsigned long) t->id);
+    proofAdd(prf, label);
+    break;
+  case op_neg:
+    proofSyntax(prf, t->a);
+    proofAdd(prf, "wn");
+    break;
+  case op_imp:
+    proofSyntax(prf, t->a);
+    proofSyntax(prf, t->b);
+    proofAdd(prf, "wi");
+    break;
+  }
+}
+
+/* push the syntax proof of t, reusing a tagged copy in compressed proofs. */
+/* *tag is the tag of t in this proof, or -1 if it has none yet */
+static void
+proofSyntaxTagged(struct proof* prf, const struct term* t, long* tag,
+  int isCompressed)
+{
+  if (!isCompressed) {
+    proofSyntax(prf, t);
+  } else if (*tag >= 0) {
+    proofAdd(prf, "");
+    prf->steps[prf->size - 1].tagRef = *tag;
+  } else {
+    proofSyntax(prf, t);
+    prf->steps[prf->size - 1].isTagged = 1;
+    *tag = prf->tags++;
+  }
+}
+
+static void
+printNumber(FILE* f, size_t n)
+{
+  char buf[32];
+  size_t len = 0;
+  buf[len++] = 'A' + (n - 1) % 20;
+  n = (n - 1) / 20;
+  while (n > 0) {
+    buf[len++] = 'U' + (n - 1) % 5;
+    n = (n - 1) / 5;
+  }
+  while (len > 0) {
+    fputc(buf[--len], f);
+  }
+}
+
+/* hyps are the labels of the mandatory hypotheses in order */
+static void
+proofPrint(FILE* f, const struct proof* prf, char (*hyps)[32], size_t hypc,
+  int isCompressed)
+{
+  size_t i, j;
+  if (!isCompressed) {
+    for (i = 0; i < prf->size; i++) {
+      fprintf(f, " %s", prf->steps[i].label);
+    }
+    return;
+  }
+/* collect the labels which are not mandatory hypotheses */
+  char (*labels)[32] = xalloc(sizeof(*labels) * (prf->size + 1));
+  size_t* num = xalloc(sizeof(size_t) * (prf->size + 1));
+  size_t labelc = 0;
+  for (i = 0; i < prf->size; i++) {
+    const struct step* s = &prf->steps[i];
+    if (s->tagRef >= 0) { continue; }
+    num[i] = 0;
+    for (j = 0; j < hypc; j++) {
+      if (strcmp(hyps[j], s->label) == 0) { num[i] = j + 1; }
+    }
+    if (num[i]) { continue; }
+    for (j = 0; j < labelc; j++) {
+      if (strcmp(labels[j], s->label) == 0) { break; }
+    }
+    if (j == labelc) {
+      strcpy(labels[labelc++], s->label);
+    }
+    num[i] = hypc + j + 1;
+  }
+  fprintf(f, " (");
+  for (j = 0; j < labelc; j++) {
+    fprintf(f, " %s", labels[j]);
+  }
+  fprintf(f, " ) ");
+  for (i = 0; i < prf->size; i++) {
+    const struct step* s = &prf->steps[i];
+    if (s->tagRef >= 0) {
+      printNumber(f, hypc + labelc + s->tagRef + 1);
+    } else {
+      printNumber(f, num[i]);
+    }
+    if (s->isTagged) { fputc('Z', f); }
+    if (i % 32 == 31) { fputc('\n', f); }
+  }
+  free(num);
+  free(labels);
+}
+
+static void
+usage(const char* name)
+{
+  fprintf(stderr,
+    "usage: %s [-c constants] [-v variables] [-t theorems] [-d depth]\n"
+    "  [-D disjoint percent] [-l proof length] [-z] [-s seed]\n"
+    "-z writes compressed proofs\n", name);
+  exit(1);
+}
+
+static size_t
+parseSize(const char* s, const char* name)
+{
+  char* end;
+  unsigned long n = strtoul(s, &end, 10);
+  if (*end) { usage(name); }
+  return n;
+}
+
+int
+main(int argc, char** argv)
+{
+  struct options opt = {8, 8, 1000, 1, 10, 40, 0, 1};
+  int i;
+  for (i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-z") == 0) {
+      opt.isCompressed = 1;
+      continue;
+    }
+    if (i + 1 >= argc || argv[i][0] != '-' || strlen(argv[i]) != 2) {
+      usage(argv[0]);
+    }
+    size_t n = parseSize(argv[i + 1], argv[0]);
+    switch (argv[i][1]) {
+    case 'c': opt.constants = n; break;
+    case 'v': opt.variables = n; break;
+    case 't': opt.theorems = n; break;
+    case 'd': opt.depth = n; break;
+    case 'D': opt.disjoint = n; break;
+    case 'l': opt.length = n; break;
+    case 's': opt.seed = n; break;
+    default: usage(argv[0]);
+    }
+    i++;
+  }
+/* implication and modus ponens need two variables, and closed terms need */
+/* a constant */
+  if (opt.variables < 2) { opt.variables = 2; }
+  if (opt.constants < 1) { opt.constants = 1; }
+  if (opt.length < 4) { opt.length = 4; }
+  if (opt.depth < 1) { opt.depth = 1; }
+  rng_state = opt.seed * 2654435761UL + 1;
+  FILE* f = stdout;
+  size_t statements = 0;
+  size_t steps = 0;
+  size_t k, j, v;
+
+/* the language */
+  fprintf(f, "$( generated by mmgen $)\n$c wff |- ( ) -> -. $.\n$c");
+  for (k = 0; k < opt.constants; k++) {
+    fprintf(f, " c%lu", (unsigned long) k);
+  }
+  fprintf(f, " $.\n");
+  fprintf(f, "$v");
+  for (v = 0; v < opt.variables; v++) {
+    fprintf(f, " v%lu", (unsigned long) v);
+  }
+  fprintf(f, " $.\n");
+  for (v = 0; v < opt.variables; v++) {
+    fprintf(f, "wv%lu $f wff v%lu $.\n", (unsigned long) v, (unsigned long) v);
+    statements++;
+  }
+  for (k = 0; k < opt.constants; k++) {
+    fprintf(f, "wc%lu $a wff c%lu $.\n", (unsigned long) k, (unsigned long) k);
+    statements++;
+  }
+  fprintf(f, "wn $a wff -. v0 $.\n");
+  fprintf(f, "wi $a wff ( v0 -> v1 ) $.\n");
+  fprintf(f, "ax-id $a |- ( v0 -> v0 ) $.\n");
+  fprintf(f, "${\n  min $e |- v0 $.\n  maj $e |- ( v0 -> v1 ) $.\n"
+    "  ax-mp $a |- v1 $.\n$}\n");
+  statements += 6;
+
+  struct lemma lemmas[lemma_window];
+  size_t lemmac = 0;
+  struct term** sub = xalloc(sizeof(struct term*) * opt.variables);
+  char* isUsed = xalloc(opt.variables);
+  char (*hyps)[32] = xalloc(sizeof(*hyps) * (opt.variables + 1));
+  struct proof prf = {NULL, 0, 0, 0};
+  for (k = 0; k < opt.theorems; k++) {
+    size_t kind = rnd(3);
+    struct term* stmt = NULL;
+    struct term* hyp = NULL;
+    prf.size = 0;
+    prf.tags = 0;
+    if (kind == 1 && lemmac == 0) { kind = 0; }
+    if (kind == 0) {
+/* |- ( T -> T ) by ax-id */
+      struct term* t = termRandom(&opt, opt.length / 2, 0);
+      long tag = -1;
+      proofSyntaxTagged(&prf, t, &tag, opt.isCompressed);
+      proofAdd(&prf, "ax-id");
+      stmt = termNew(op_imp, 0, t, termCopy(t));
+    } else if (kind == 1) {
+/* instantiate an earlier lemma */
+      const struct lemma* lem = &lemmas[rnd(lemmac)];
+      size_t size = opt.length / (2 * lem->varc + 1) + 1;
+      memset(sub, 0, sizeof(struct term*) * opt.variables);
+      for (j = 0; j < lem->varc; j++) {
+        v = lem->vars[j];
+/* substituting closed terms for variables with $d restrictions keeps */
+/* the restrictions satisfied */
+        sub[v] = termRandom(&opt, size, lem->isDisjoint[j]);
+        proofSyntax(&prf, sub[v]);
+      }
+      char label[32];
+      sprintf(label, "th%lu", (unsigned long) lem->id);
+      proofAdd(&prf, label);
+      stmt = termSubstitute(lem->stmt, sub);
+      for (j = 0; j < lem->varc; j++) {
+        termFree(sub[lem->vars[j]]);
+      }
+    } else {
+/* |- T from the hypothesis |- T by modus ponens with ( T -> T ) */
+      hyp = termRandom(&opt, opt.length / 4, 0);
+      long tag = -1;
+      char label[32];
+      sprintf(label, "th%lu.1", (unsigned long) k);
+      proofSyntaxTagged(&prf, hyp, &tag, opt.isCompressed);
+      proofSyntaxTagged(&prf, hyp, &tag, opt.isCompressed);
+      proofAdd(&prf, label);
+      proofSyntaxTagged(&prf, hyp, &tag, opt.isCompressed);
+      proofAdd(&prf, "ax-id");
+      proofAdd(&prf, "ax-mp");
+      stmt = termCopy(hyp);
+    }
+/* the mandatory variables, in order of their $f statements */
+    memset(isUsed, 0, opt.variables);
+    termVariables(stmt, isUsed);
+    size_t hypc = 0;
+    for (v = 0; v < opt.variables; v++) {
+      if (isUsed[v]) {
+        sprintf(hyps[hypc++], "wv%lu", (unsigned long) v);
+      }
+    }
+    for (j = 0; j < opt.depth; j++) {
+      fprintf(f, "${ ");
+    }
+    fputc('\n', f);
+    char* isDisjoint = xalloc(opt.variables);
+    memset(isDisjoint, 0, opt.variables);
+    if (kind != 2) {
+      size_t w;
+      for (v = 0; v < opt.variables; v++) {
+        for (w = v + 1; w < opt.variables; w++) {
+          if (isUsed[v] && isUsed[w] && rnd(100) < opt.disjoint) {
+            fprintf(f, "  $d v%lu v%lu $.\n", (unsigned long) v,
+              (unsigned long) w);
+            isDisjoint[v] = 1;
+            isDisjoint[w] = 1;
+          }
+        }
+      }
+    } else {
+      fprintf(f, "  th%lu.1 $e |-", (unsigned long) k);
+      termPrint(f, hyp);
+      fprintf(f, " $.\n");
+      sprintf(hyps[hypc++], "th%lu.1", (unsigned long) k);
+      statements++;
+    }
+    fprintf(f, "  th%lu $p |-", (unsigned long) k);
+    termPrint(f, stmt);
+    fprintf(f, " $=");
+    proofPrint(f, &prf, hyps, hypc, opt.isCompressed);
+    fprintf(f, " $.\n");
+    for (j = 0; j < opt.depth; j++) {
+      fprintf(f, "$} ");
+    }
+    fputc('\n', f);
+    statements++;
+    steps += prf.size;
+    termFree(hyp);
+    if (kind == 2) {
+      termFree(stmt);
+      free(isDisjoint);
+      continue;
+    }
+/* remember the theorem for instantiation, replacing the oldest */
+    struct lemma* lem;
+    if (lemmac < lemma_window) {
+      lem = &lemmas[lemmac++];
+    } else {
+      lem = &lemmas[k % lemma_window];
+      termFree(lem->stmt);
+      free(lem->vars);
+      free(lem->isDisjoint);
+    }
+    lem->id = k;
+    lem->stmt = stmt;
+    lem->vars = xalloc(sizeof(size_t) * opt.variables);
+    lem->isDisjoint = xalloc(opt.variables);
+    lem->varc = 0;
+    for (v = 0; v < opt.variables; v++) {
+      if (isUsed[v]) {
+        lem->isDisjoint[lem->varc] = isDisjoint[v];
+        lem->vars[lem->varc++] = v;
+      }
+    }
+    free(isDisjoint);
+  }
+  for (k = 0; k < lemmac; k++) {
+    termFree(lemmas[k].stmt);
+    free(lemmas[k].vars);
+    free(lemmas[k].isDisjoint);
+  }
+  free(prf.steps);
+  free(hyps);
+  free(isUsed);
+  free(sub);
+  fprintf(stderr, "statements %lu steps %lu\n", (unsigned long) statements,
+    (unsigned long) steps);
+  return 0;
+}
@@ -0,0 +1,9 @@
+$( tests/mm/test1.mm 0 $)
+$v P Q R $.
+$c -> ( ) |- wff $.
+wp $f wff P $.
+wq $f wff Q $.
+wr $f wff R $.
+w2 $a wff ( P -> Q ) $.
+wnew $p wff ( P -> ( Q -> R ) ) $=
+wp wq wr w2 w2 $.
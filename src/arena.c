@@ -0,0 +1,158 @@
+#include "arena.h"
+#include "memory.h"
+#include <string.h>
+
+/* every allocation is aligned to this */
+union arenaAlign {
+  double d;
+  void* p;
+  long l;
+};
+
+static size_t
+arenaRound(size_t size)
+{
+  const size_t align = sizeof(union arenaAlign);
+  return (size + align - 1) / align * align;
+}
+
+/* even an empty allocation takes some space, so it does not share its */
+/* address with the next one, which growing it in place would overwrite */
+size_t
+arenaAllocSize(size_t size)
+{
+  return size ? arenaRound(size) : sizeof(union arenaAlign);
+}
+
+/* the usable memory starts right after the header */
+static char*
+arenaBlockData(struct arenaBlock* b)
+{
+  return (char*) b + arenaRound(sizeof(struct arenaBlock));
+}
+
+static struct arenaBlock*
+arenaBlockNew(struct arena* a, size_t size)
+{
+  if (size < a->blockSize) { size = a->blockSize; }
+  enum memtag tag = memorySetTag(memtag_arena);
+  struct arenaBlock* b =
+    xmalloc(arenaRound(sizeof(struct arenaBlock)) + size);
+  memorySetTag(tag);
+  b->next = NULL;
+  b->size = size;
+  b->used = 0;
+  a->blocks++;
+  return b;
+}
+
+void
+arenaInit(struct arena* a, size_t blockSize)
+{
+  a->blockSize = arenaRound(blockSize);
+  a->blocks = 0;
+  a->head = arenaBlockNew(a, a->blockSize);
+  a->cur = a->head;
+  a->last = NULL;
+  a->used = 0;
+  a->peak = 0;
+}
+
+void
+arenaClean(struct arena* a)
+{
+  struct arenaBlock* b = a->head;
+  while (b) {
+    struct arenaBlock* next = b->next;
+    xfree(b);
+    b = next;
+  }
+  a->head = NULL;
+  a->cur = NULL;
+  a->last = NULL;
+  a->blocks = 0;
+}
+
+void*
+arenaAlloc(struct arena* a, size_t size)
+{
+  size = arenaAllocSize(size);
+/* move along the chain until a block has room, adding one at the end if */
+/* none does. Blocks after the current one never hold live allocations. */
+/* Space skipped here stays unused until the next reset or release */
+  while (a->cur->used + size > a->cur->size) {
+    if (!a->cur->next) {
+      a->cur->next = arenaBlockNew(a, size);
+    }
+    a->cur = a->cur->next;
+    a->cur->used = 0;
+  }
+  void* p = arenaBlockData(a->cur) + a->cur->used;
+  a->cur->used += size;
+  a->last = p;
+  a->used += size;
+  if (a->used > a->peak) { a->peak = a->used; }
+  return p;
+}
+
+void*
+arenaRealloc(struct arena* a, void* p, size_t oldSize, size_t size)
+{
+  if (!p) { return arenaAlloc(a, size); }
+  if (p == a->last) {
+    const size_t start = (char*) p - arenaBlockData(a->cur);
+    const size_t oldUsed = arenaAllocSize(oldSize);
+    const size_t newUsed = arenaAllocSize(size);
+    if (start + newUsed <= a->cur->size) {
+      a->cur->used = start + newUsed;
+      a->used = a->used - oldUsed + newUsed;
+      if (a->used > a->peak) { a->peak = a->used; }
+      return p;
+    }
+  }
+  if (size <= oldSize) { return p; }
+  void* q = arenaAlloc(a, size);
+  memcpy(q, p, oldSize);
+  return q;
+}
+
+struct arenaMark
+arenaGetMark(const struct arena* a)
+{
+  struct arenaMark mark;
+  mark.block = a->cur;
+  mark.blockUsed = a->cur->used;
+  mark.used = a->used;
+  return mark;
+}
+
+int
+arenaGetMarkAt(const struct arena* a, const void* p, struct arenaMark* mark)
+{
+  const char* data = arenaBlockData(a->cur);
+  if ((const char*) p < data || (const char*) p > data + a->cur->used) {
+    return 0;
+  }
+  mark->block = a->cur;
+  mark->blockUsed = (const char*) p - data;
+  mark->used = a->used - (a->cur->used - mark->blockUsed);
+  return 1;
+}
+
+void
+arenaRelease(struct arena* a, struct arenaMark mark)
+{
+  a->cur = mark.block;
+  a->cur->used = mark.blockUsed;
+  a->last = NULL;
+  a->used = mark.used;
+}
+
+void
+arenaReset(struct arena* a)
+{
+  a->cur = a->head;
+  a->cur->used = 0;
+  a->last = NULL;
+  a->used = 0;
+}
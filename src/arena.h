@@ -0,0 +1,72 @@
+#ifndef _HALMOSARENA_H_
+#define _HALMOSARENA_H_
+#include <stddef.h>
+
+/* a bump-pointer allocator for short-lived memory. Allocations are never */
+/* freed individually. arenaReset releases everything at once but keeps the */
+/* blocks, so an arena that is reset regularly stops calling malloc once it */
+/* has grown to its working size */
+struct arenaBlock {
+  struct arenaBlock* next;
+  size_t size;
+  size_t used;
+};
+
+struct arena {
+/* the first block in the chain */
+  struct arenaBlock* head;
+/* the block we are allocating from */
+  struct arenaBlock* cur;
+/* size of newly allocated blocks */
+  size_t blockSize;
+/* the most recent allocation, which can be grown in place */
+  void* last;
+/* number of blocks in the chain */
+  size_t blocks;
+/* bytes handed out since the last reset, and the maximum of that */
+  size_t used;
+  size_t peak;
+};
+
+void
+arenaInit(struct arena* a, size_t blockSize);
+
+void
+arenaClean(struct arena* a);
+
+void*
+arenaAlloc(struct arena* a, size_t size);
+
+/* the bytes an allocation of size takes in the arena */
+size_t
+arenaAllocSize(size_t size);
+
+/* grow or shrink p, which was allocated with size oldSize. If p is the most */
+/* recent allocation this is done in place, otherwise the contents are copied */
+void*
+arenaRealloc(struct arena* a, void* p, size_t oldSize, size_t size);
+
+/* a position in the arena to return to */
+struct arenaMark {
+  struct arenaBlock* block;
+  size_t blockUsed;
+  size_t used;
+};
+
+struct arenaMark
+arenaGetMark(const struct arena* a);
+
+/* the mark just before p, so releasing it frees p and everything allocated */
+/* after it. Returns 0 if p is not in the block we are allocating from */
+int
+arenaGetMarkAt(const struct arena* a, const void* p, struct arenaMark* mark);
+
+/* release everything allocated since the mark was taken */
+void
+arenaRelease(struct arena* a, struct arenaMark mark);
+
+/* make all memory allocated from the arena available again */
+void
+arenaReset(struct arena* a);
+
+#endif
@@ -1,5 +1,15 @@
 #include "array.h"
 
+size_t
+arrayGrowth(size_t max, size_t need)
+{
+  size_t grown = max / ARRAY_GROWTH_DEN * ARRAY_GROWTH_NUM
+    + max % ARRAY_GROWTH_DEN * ARRAY_GROWTH_NUM / ARRAY_GROWTH_DEN;
+/* a factor close to 1 or an empty array would not grow */
+  if (grown <= max) { grown = max + 1; }
+  return (grown > need) ? grown : need;
+}
+
 DEFINE_ARRAY(char)
 DEFINE_ARRAY(int)
 DEFINE_ARRAY(size_t)
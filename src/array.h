@@ -1,18 +1,41 @@
 #ifndef _HALMOSARRAY_H_
 #define _HALMOSARRAY_H_
 
+#include "arena.h"
 #include "dbg.h"
 #include "memory.h"
 
+/* arrays grow geometrically by ARRAY_GROWTH_NUM / ARRAY_GROWTH_DEN. The */
+/* factor can be changed at build time, e.g. -DARRAY_GROWTH_NUM=3 */
+/* -DARRAY_GROWTH_DEN=2 */
+#ifndef ARRAY_GROWTH_NUM
+#define ARRAY_GROWTH_NUM 2
+#endif
+#ifndef ARRAY_GROWTH_DEN
+#define ARRAY_GROWTH_DEN 1
+#endif
+
+/* the capacity to grow an array of capacity max to, so that it holds at */
+/* least need elements */
+size_t
+arrayGrowth(size_t max, size_t need);
+
+/* arrays set up with InitArena grow inside the arena and are released when */
+/* the arena is reset. Clean does not free their memory */
 #define DECLARE_ARRAY(type) \
 struct type ## Array { \
   type * vals; \
   size_t size; \
   size_t max; \
+  struct arena* arena; \
 }; \
 void type ## ArrayInit(struct type ## Array*, size_t); \
+void type ## ArrayInitArena(struct type ## Array*, size_t, struct arena*); \
 void type ## ArrayClean(struct type ## Array*); \
 void type ## ArrayResize(struct type ## Array*, size_t); \
+void type ## ArrayReserve(struct type ## Array*, size_t); \
+void type ## ArrayGrow(struct type ## Array*, size_t); \
+void type ## ArrayShrink(struct type ## Array*); \
 void type ## ArrayAdd(struct type ## Array*, type); \
 void type ## ArrayAppend(struct type ## Array*, const type*, size_t); \
 void type ## ArrayEmpty(struct type ## Array*);
@@ -23,30 +46,69 @@ type ## ArrayInit(struct type ## Array* a, size_t max) { \
   a->vals = xmalloc(sizeof(type) * max); \
   a->size = 0; \
   a->max = max; \
+  a->arena = NULL; \
+} \
+void \
+type ## ArrayInitArena(struct type ## Array* a, size_t max, \
+  struct arena* arena) { \
+  a->vals = arenaAlloc(arena, sizeof(type) * max); \
+  a->size = 0; \
+  a->max = max; \
+  a->arena = arena; \
 } \
 void \
 type ## ArrayClean(struct type ## Array* a) { \
-  free(a->vals); \
+  if (!a->arena) { xfree(a->vals); } \
   a->vals = NULL; \
   a->size = 0; \
   a->max = 0; \
 } \
 void \
 type ## ArrayResize(struct type ## Array* a, size_t max) { \
-  a->vals = xrealloc(a->vals, sizeof(type) * max); \
+  if (a->arena) { \
+    a->vals = arenaRealloc(a->arena, a->vals, sizeof(type) * a->max, \
+      sizeof(type) * max); \
+  } else if (a->size == 0) { \
+/* nothing to keep, so avoid the copy realloc might do */ \
+    xfree(a->vals); \
+    a->vals = xmalloc(sizeof(type) * max); \
+  } else { \
+    a->vals = xrealloc(a->vals, sizeof(type) * max); \
+  } \
   a->max = max; \
 } \
+/* make room for exactly max elements, if there isn't already */ \
+void \
+type ## ArrayReserve(struct type ## Array* a, size_t max) { \
+  if (max > a->max) { \
+    type ## ArrayResize(a, max); \
+  } \
+} \
+/* make room for at least need elements, growing geometrically */ \
+void \
+type ## ArrayGrow(struct type ## Array* a, size_t need) { \
+  if (need > a->max) { \
+    type ## ArrayResize(a, arrayGrowth(a->max, need)); \
+  } \
+} \
+/* release unused capacity */ \
+void \
+type ## ArrayShrink(struct type ## Array* a) { \
+  if (a->size < a->max && a->size > 0) { \
+    type ## ArrayResize(a, a->size); \
+  } \
+} \
 void \
 type ## ArrayAdd(struct type ## Array* a, type v) { \
   if (a->size >= a->max) { \
-    type ## ArrayResize(a, a->max * 2); \
+    type ## ArrayGrow(a, a->size + 1); \
   } \
   a->vals[a->size++] = v; \
 } \
 void \
 type ## ArrayAppend(struct type ## Array* a, const type* v, size_t size) { \
   if (a->size + size > a->max) { \
-    type ## ArrayResize(a, (a->size + size) * 2); \
+    type ## ArrayGrow(a, a->size + size); \
   } \
   size_t i; \
   for (i = 0; i < size; i++) { \
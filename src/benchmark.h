@@ -0,0 +1,81 @@
+#ifndef _HALMOSBENCHMARK_H_
+#define _HALMOSBENCHMARK_H_
+#include "timer.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/* microbenchmarks, in the style of unittest.h. A benchmark is a function */
+/* doing one operation on its argument. bench_run calibrates how many calls */
+/* make up a sample, warms up, takes bench_samples samples and reports the */
+/* median, 99th percentile, maximum and minimum time per call */
+
+enum {
+  bench_samples = 201,
+  bench_warmup = 3
+};
+
+/* the minimum length of a sample in seconds */
+static const double bench_sample_time = 1e-3;
+
+typedef void (*benchFunction)(void*);
+
+/* benchmarks store results here so the compiler can't drop the work */
+static volatile size_t bench_sink;
+
+static int
+benchCompare(const void* a, const void* b)
+{
+  const double x = *(const double*) a;
+  const double y = *(const double*) b;
+  return (x > y) - (x < y);
+}
+
+/* seconds for n calls of f */
+static double
+benchSample(benchFunction f, void* arg, size_t n)
+{
+  size_t i;
+  struct timer t;
+  timerInit(&t);
+  timerStart(&t);
+  for (i = 0; i < n; i++) {
+    f(arg);
+  }
+  timerStop(&t);
+  return t.wall;
+}
+
+static void
+benchRun(const char* name, benchFunction f, void* arg)
+{
+  size_t i;
+  size_t n = 1;
+  double s[bench_samples];
+  while (benchSample(f, arg, n) < bench_sample_time && n < ((size_t) 1 << 30)) {
+    n *= 2;
+  }
+  for (i = 0; i < bench_warmup; i++) {
+    benchSample(f, arg, n);
+  }
+  for (i = 0; i < bench_samples; i++) {
+    s[i] = benchSample(f, arg, n) / n * 1e9;
+  }
+  qsort(s, bench_samples, sizeof(double), benchCompare);
+  printf("%-36s %12.1f %12.1f %12.1f %12.1f %10lu\n", name,
+    s[bench_samples / 2], s[(bench_samples * 99) / 100], s[bench_samples - 1],
+    s[0], (unsigned long) n);
+}
+
+#define bench_run(f, arg) benchRun(#f, (f), (arg))
+
+#define BENCH(all) \
+int main(int argc, char* argv[]) { \
+  (void) argc; \
+  printf("BENCHMARKING -----%s\n", argv[0]); \
+  printf("%-36s %12s %12s %12s %12s %10s\n", "ns per call", "median", \
+    "p99", "max", "min", "calls"); \
+  all(); \
+  return 0; \
+}
+
+#endif
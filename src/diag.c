@@ -0,0 +1,222 @@
+#include "diag.h"
+#include "memory.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+DEFINE_ARRAY(diag)
+
+const size_t diag_none_file = (size_t)-1;
+
+static const char* diagPlaceholders[diag_max_symstrings] = {
+  DIAG_SYMSTRING "\x01",
+  DIAG_SYMSTRING "\x02",
+  DIAG_SYMSTRING "\x03",
+  DIAG_SYMSTRING "\x04",
+  DIAG_SYMSTRING "\x05",
+  DIAG_SYMSTRING "\x06",
+  DIAG_SYMSTRING "\x07",
+  DIAG_SYMSTRING "\x08"
+};
+
+static const char* diagLevelStrings[diagLevel_size] = {
+  "error",
+  "warning",
+  "info"
+};
+
+const char*
+diagLevelString(enum diagLevel level)
+{
+  return diagLevelStrings[level];
+}
+
+void
+diagListInit(struct diagList* l)
+{
+  enum memtag tag = memorySetTag(memtag_diag);
+  diagArrayInit(&l->diags, 16);
+  charArrayInit(&l->text, 256);
+  size_tArrayInit(&l->syms, 16);
+  memorySetTag(tag);
+  l->claimed = 0;
+  l->pending = 0;
+  l->key = 0;
+}
+
+void
+diagListClean(struct diagList* l)
+{
+  size_tArrayClean(&l->syms);
+  charArrayClean(&l->text);
+  diagArrayClean(&l->diags);
+}
+
+const char*
+diagListAddSymstring(struct diagList* l, const size_t* ids, size_t n)
+{
+  if (l->pending == diag_max_symstrings) { return "..."; }
+  enum memtag tag = memorySetTag(memtag_diag);
+  size_tArrayAdd(&l->syms, n);
+  size_tArrayAppend(&l->syms, ids, n);
+  memorySetTag(tag);
+  return diagPlaceholders[l->pending++];
+}
+
+const size_t*
+diagGetSymstring(const struct diagList* l, const struct diag* d, size_t k,
+  size_t* n)
+{
+  size_t i = d->syms;
+  while (i < d->symsEnd) {
+    if (k-- == 0) {
+      *n = l->syms.vals[i];
+      return l->syms.vals + i + 1;
+    }
+    i += l->syms.vals[i] + 1;
+  }
+  *n = 0;
+  return NULL;
+}
+
+void
+diagListAdd(struct diagList* l, enum error err, enum diagLevel level,
+  size_t file, size_t line, size_t offset, const char* fmt, ...)
+{
+  enum memtag tag = memorySetTag(memtag_diag);
+  struct diag d;
+  d.err = err;
+  d.level = level;
+  d.file = file;
+  d.line = line;
+  d.offset = offset;
+  d.msg = l->text.size;
+  d.syms = l->claimed;
+  d.symsEnd = l->syms.size;
+  d.key = l->key;
+  l->claimed = l->syms.size;
+  l->pending = 0;
+/* format the message into the room left at the end of text. Only if it */
+/* does not fit is text grown and the message formatted again */
+  size_t room = l->text.max - l->text.size;
+  va_list ap;
+  va_start(ap, fmt);
+  int len = vsnprintf(l->text.vals + l->text.size, room, fmt, ap);
+  va_end(ap);
+  if (len < 0) { len = 0; }
+  if ((size_t) len >= room) {
+    charArrayGrow(&l->text, l->text.size + len + 1);
+    va_start(ap, fmt);
+    vsnprintf(l->text.vals + l->text.size, len + 1, fmt, ap);
+    va_end(ap);
+  }
+  l->text.vals[l->text.size + len] = '\0';
+  l->text.size += len + 1;
+  diagArrayAdd(&l->diags, d);
+  memorySetTag(tag);
+}
+
+void
+diagListDrop(struct diagList* l, size_t size)
+{
+  if (size >= l->diags.size) { return; }
+  const struct diag* d = &l->diags.vals[size];
+  l->text.size = d->msg;
+  l->syms.size = d->syms;
+  l->claimed = d->syms;
+  l->pending = 0;
+  l->diags.size = size;
+}
+
+void
+diagListRemove(struct diagList* l, size_t key)
+{
+  size_t i, n = 0;
+  for (i = 0; i < l->diags.size; i++) {
+    if (l->diags.vals[i].key != key) { l->diags.vals[n++] = l->diags.vals[i]; }
+  }
+  if (n == l->diags.size) { return; }
+  l->diags.size = n;
+/* copy the text and symbol strings of the diagnostics kept, and those */
+/* of the one being recorded, together. The diagnostics may be sorted, so */
+/* the copies are new arrays */
+  enum memtag tag = memorySetTag(memtag_diag);
+  struct charArray text;
+  struct size_tArray syms;
+  charArrayInit(&text, l->text.max);
+  size_tArrayInit(&syms, l->syms.max);
+  for (i = 0; i < n; i++) {
+    struct diag* d = &l->diags.vals[i];
+    const char* msg = l->text.vals + d->msg;
+    d->msg = text.size;
+    charArrayAppend(&text, msg, strlen(msg) + 1);
+    const size_t syms0 = syms.size;
+    size_tArrayAppend(&syms, l->syms.vals + d->syms, d->symsEnd - d->syms);
+    d->syms = syms0;
+    d->symsEnd = syms.size;
+  }
+  const size_t claimed = syms.size;
+  size_tArrayAppend(&syms, l->syms.vals + l->claimed,
+    l->syms.size - l->claimed);
+  l->claimed = claimed;
+  memorySetTag(tag);
+  charArrayClean(&l->text);
+  size_tArrayClean(&l->syms);
+  l->text = text;
+  l->syms = syms;
+}
+
+static int
+diagCompare(const void* a, const void* b)
+{
+  const struct diag* x = a;
+  const struct diag* y = b;
+  if (x->file != y->file) { return (x->file < y->file) ? -1 : 1; }
+  if (x->line != y->line) { return (x->line < y->line) ? -1 : 1; }
+  if (x->offset != y->offset) { return (x->offset < y->offset) ? -1 : 1; }
+/* messages are added in order, so this keeps the order of recording */
+  if (x->msg != y->msg) { return (x->msg < y->msg) ? -1 : 1; }
+  return 0;
+}
+
+static int
+diagIsAtSamePlace(const struct diag* x, const struct diag* y)
+{
+  return x->file == y->file && x->line == y->line && x->offset == y->offset;
+}
+
+static int
+diagIsEqual(const struct diagList* l, const struct diag* x,
+  const struct diag* y)
+{
+  if (x->err != y->err || x->level != y->level || !diagIsAtSamePlace(x, y)) {
+    return 0;
+  }
+  if (strcmp(l->text.vals + x->msg, l->text.vals + y->msg) != 0) { return 0; }
+  const size_t n = x->symsEnd - x->syms;
+  if (n != y->symsEnd - y->syms) { return 0; }
+  return memcmp(l->syms.vals + x->syms, l->syms.vals + y->syms,
+    n * sizeof(size_t)) == 0;
+}
+
+void
+diagListSort(struct diagList* l, int isUnique)
+{
+  size_t i;
+  qsort(l->diags.vals, l->diags.size, sizeof(struct diag), diagCompare);
+  if (!isUnique || l->diags.size == 0) { return; }
+/* compare with the diagnostics kept at the same place */
+  size_t j, n = 0, first = 0;
+  for (i = 0; i < l->diags.size; i++) {
+    const struct diag* d = &l->diags.vals[i];
+    if (n > 0 && !diagIsAtSamePlace(&l->diags.vals[first], d)) {
+      first = n;
+    }
+    for (j = first; j < n; j++) {
+      if (diagIsEqual(l, &l->diags.vals[j], d)) { break; }
+    }
+    if (j == n) { l->diags.vals[n++] = *d; }
+  }
+  l->diags.size = n;
+}
@@ -0,0 +1,96 @@
+#ifndef _HALMOSDIAG_H_
+#define _HALMOSDIAG_H_
+#include "array.h"
+#include "error.h"
+
+/* Diagnostics are recorded as they are found and formatted at the end, */
+/* sorted by where they are. The symbol strings in a message are kept as */
+/* symbol ids and only turned into text when they are printed */
+
+enum diagLevel {
+  diagLevel_error,
+  diagLevel_warning,
+  diagLevel_info,
+  diagLevel_size
+};
+
+const char* diagLevelString(enum diagLevel level);
+
+/* in a message, DIAG_SYMSTRING followed by the character k + 1 stands */
+/* for the k-th symbol string of the diagnostic. The arguments of a call */
+/* are evaluated in any order, so they are told apart by k */
+#define DIAG_SYMSTRING "\x1a"
+enum { diag_max_symstrings = 8 };
+
+/* the file of diagnostics not found in the input */
+extern const size_t diag_none_file;
+
+struct diag {
+  enum error err;
+  enum diagLevel level;
+  size_t file;
+  size_t line;
+  size_t offset;
+/* the message is text.vals[msg ..], terminated by \0 */
+  size_t msg;
+/* the symbol strings of the message are syms.vals[syms .. symsEnd - 1], */
+/* each as its length followed by its symbol ids */
+  size_t syms;
+  size_t symsEnd;
+/* the key of the list when it was recorded */
+  size_t key;
+};
+typedef struct diag diag;
+DECLARE_ARRAY(diag)
+
+struct diagList {
+  struct diagArray diags;
+  struct charArray text;
+  struct size_tArray syms;
+/* syms.vals[claimed ..] belong to the diagnostic being recorded, which */
+/* has pending symbol strings */
+  size_t claimed;
+  size_t pending;
+/* the key of the diagnostics recorded next, to remove them together */
+/* later. 0 by default */
+  size_t key;
+};
+
+void
+diagListInit(struct diagList* l);
+
+void
+diagListClean(struct diagList* l);
+
+/* keep the symbol string ids[0 .. n - 1] for the next diagnostic recorded, */
+/* and return the placeholder to put in its message. Past */
+/* diag_max_symstrings, the string is dropped and "..." is returned */
+const char*
+diagListAddSymstring(struct diagList* l, const size_t* ids, size_t n);
+
+/* record a diagnostic. The message is formatted from fmt at once, with */
+/* its symbol strings left as placeholders */
+void
+diagListAdd(struct diagList* l, enum error err, enum diagLevel level,
+  size_t file, size_t line, size_t offset, const char* fmt, ...);
+
+/* forget the diagnostics recorded after the first size */
+void
+diagListDrop(struct diagList* l, size_t size);
+
+/* forget the diagnostics recorded with the key, and their text */
+void
+diagListRemove(struct diagList* l, size_t key);
+
+/* the k-th symbol string of d, whose length is put in n */
+const size_t*
+diagGetSymstring(const struct diagList* l, const struct diag* d, size_t k,
+  size_t* n);
+
+/* sort the diagnostics by file, line and offset. Diagnostics at the same */
+/* place keep their order, and if isUnique, the copies of a diagnostic */
+/* there are dropped */
+void
+diagListSort(struct diagList* l, int isUnique);
+
+#endif
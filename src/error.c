@@ -15,6 +15,7 @@ static const char* errorStrings[error_size] = {
   "expectedClosingBracket",
   "unterminatedFileInclusion",
   "failedOpenFile",
+  "failedWriteFile",
 /* external (user) errors */
   "expectedNewLine",
   "expectedConstantSymbol",
@@ -48,7 +49,9 @@ static const char* errorStrings[error_size] = {
   "invalidTagReferenceInCompressedProof",
   "invalidFile",
   "expectedFilename",
-  "unexpectedFilename"
+  "unexpectedFilename",
+  "mismatchedGrammar",
+  "changedStatement"
 /* error_size */
 };
 
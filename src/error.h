@@ -15,6 +15,7 @@ enum error {
   error_expectedClosingBracket,
   error_unterminatedFileInclusion,
   error_failedOpenFile,
+  error_failedWriteFile,
 /* external (user) errors */
   error_expectedNewLine,
   error_expectedConstantSymbol,
@@ -49,6 +50,10 @@ enum error {
   error_invalidFile,
   error_expectedFilename,
   error_expectedLineNumber,
+/* the syntax tree and string checks of a proof disagree */
+  error_mismatchedGrammar,
+/* the input given to a recheck changed outside the proofs */
+  error_changedStatement,
   error_size
 };
 
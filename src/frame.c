@@ -4,9 +4,11 @@ DEFINE_ARRAY(frame)
 void
 frameInit(struct frame* frm)
 {
+  enum memtag tag = memorySetTag(memtag_frame);
   size_tArrayInit(&frm->stmts, 1);
   size_tArrayInit(&frm->disjoint1, 1);
   size_tArrayInit(&frm->disjoint2, 1);
+  memorySetTag(tag);
 }
 
 void
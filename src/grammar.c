@@ -0,0 +1,791 @@
+#include "dbg.h"
+#include "frame.h"
+#include "grammar.h"
+#include "logger.h"
+#include "memory.h"
+#include "verifier.h"
+#include <string.h>
+
+DEFINE_ARRAY(grammarNode)
+DEFINE_ARRAY(grammarRule)
+DEFINE_ARRAY(grammarType)
+DEFINE_ARRAY(grammarMemo)
+DEFINE_ARRAY(grammarApp)
+
+const size_t grammar_none_id = 0;
+static const size_t grammar_table_size = 1024;
+/* give up on statements with more parses in progress than this. Only */
+/* ambiguous grammars get there */
+static const size_t grammar_max_results = 3 * (1 << 20);
+
+enum {
+  grammar_memo_unseen,
+  grammar_memo_busy,
+  grammar_memo_done
+};
+
+void
+grammarInit(struct grammar* g)
+{
+  size_t i;
+  enum memtag tag = memorySetTag(memtag_grammar);
+  grammarNodeArrayInit(&g->nodes, 1024);
+  size_tArrayInit(&g->args, 1024);
+  size_tArrayInit(&g->table, grammar_table_size);
+  for (i = 0; i < grammar_table_size; i++) {
+    g->table.vals[i] = 0;
+  }
+  g->table.size = grammar_table_size;
+  grammarRuleArrayInit(&g->rules, 16);
+  size_tArrayInit(&g->vars, 16);
+  size_tArrayInit(&g->varTypes, 16);
+  grammarTypeArrayInit(&g->types, 4);
+  size_tArrayInit(&g->symTypes, 256);
+  size_tArrayInit(&g->symRules, 256);
+  size_tArrayInit(&g->stmtTrees, 256);
+  grammarMemoArrayInit(&g->memo, 256);
+  size_tArrayInit(&g->results, 256);
+  size_tArrayInit(&g->kids, 64);
+  size_tArrayInit(&g->stack, 64);
+  size_tArrayInit(&g->tags, 16);
+  size_tArrayInit(&g->steps, 64);
+  size_tArrayInit(&g->subVars, 16);
+  size_tArrayInit(&g->subTrees, 16);
+  size_tArrayInit(&g->dv1, 16);
+  size_tArrayInit(&g->dv2, 16);
+  grammarAppArrayInit(&g->apps, 1);
+/* node 0 stands for statements which could not be parsed. It is not in */
+/* the table, so no tree is made of it */
+  struct grammarNode none;
+  none.rule = symbol_none_id;
+  none.h = 0;
+  none.first = 0;
+  none.argc = 0;
+  grammarNodeArrayAdd(&g->nodes, none);
+  memorySetTag(tag);
+  g->thm = grammar_none_id;
+  g->errc = 0;
+  g->isSkipped = 0;
+  g->isFailed = 0;
+  g->stmtCount = 0;
+  g->parsed = 0;
+  g->checked = 0;
+  g->skipped = 0;
+  g->mismatches = 0;
+  g->appLookups = 0;
+  g->appHits = 0;
+  timerInit(&g->timer);
+}
+
+void
+grammarClean(struct grammar* g)
+{
+  grammarNodeArrayClean(&g->nodes);
+  size_tArrayClean(&g->args);
+  size_tArrayClean(&g->table);
+  grammarRuleArrayClean(&g->rules);
+  size_tArrayClean(&g->vars);
+  size_tArrayClean(&g->varTypes);
+  grammarTypeArrayClean(&g->types);
+  size_tArrayClean(&g->symTypes);
+  size_tArrayClean(&g->symRules);
+  size_tArrayClean(&g->stmtTrees);
+  grammarMemoArrayClean(&g->memo);
+  size_tArrayClean(&g->results);
+  size_tArrayClean(&g->kids);
+  size_tArrayClean(&g->stack);
+  size_tArrayClean(&g->tags);
+  size_tArrayClean(&g->steps);
+  size_tArrayClean(&g->subVars);
+  size_tArrayClean(&g->subTrees);
+  size_tArrayClean(&g->dv1);
+  size_tArrayClean(&g->dv2);
+  grammarAppArrayClean(&g->apps);
+}
+
+void
+grammarSetApps(struct grammar* g, size_t size)
+{
+  size_t i;
+  size_t slots = 1;
+  while (slots < size) {
+    slots *= 2;
+  }
+  enum memtag tag = memorySetTag(memtag_grammar);
+  grammarAppArrayResize(&g->apps, slots);
+  memorySetTag(tag);
+  g->apps.size = size ? slots : 0;
+  for (i = 0; i < g->apps.size; i++) {
+    g->apps.vals[i].symId = symbol_none_id;
+  }
+}
+
+/* the entry of symId in a table indexed by symbols or statements, which */
+/* grows as they are added */
+static size_t*
+grammarEntry(struct size_tArray* a, size_t id)
+{
+  if (a->size <= id) {
+    enum memtag tag = memorySetTag(memtag_grammar);
+    size_tArrayGrow(a, id + 1);
+    memorySetTag(tag);
+    while (a->size <= id) {
+      a->vals[a->size++] = 0;
+    }
+  }
+  return &a->vals[id];
+}
+
+static size_t
+grammarGet(const struct size_tArray* a, size_t id)
+{
+  return (id < a->size) ? a->vals[id] : 0;
+}
+
+static int
+grammarIsVariable(const struct verifier* vrf, size_t symId)
+{
+  return vrf->symbols.vals[symId].type == symType_variable;
+}
+
+static hash_t
+grammarHashNode(size_t rule, const size_t* kids, size_t argc)
+{
+  if (argc == 0) { return (hash_t) hash_wy64("", 0, rule); }
+  return (hash_t) hash_wy64((const char*) kids, argc * sizeof(size_t), rule);
+}
+
+/* double the size of the table and put the nodes back */
+static void
+grammarGrowTable(struct grammar* g)
+{
+  size_t i;
+  const size_t size = 2 * g->table.size;
+  const size_t mask = size - 1;
+  size_tArrayResize(&g->table, size);
+  for (i = 0; i < size; i++) {
+    g->table.vals[i] = 0;
+  }
+  g->table.size = size;
+  for (i = 1; i < g->nodes.size; i++) {
+    size_t j = g->nodes.vals[i].h & mask;
+    while (g->table.vals[j]) {
+      j = (j + 1) & mask;
+    }
+    g->table.vals[j] = i + 1;
+  }
+}
+
+/* the slot of the node in the table, or the empty slot where it would go */
+static size_t
+grammarFindSlot(const struct grammar* g, hash_t h, size_t rule,
+  const size_t* kids, size_t argc)
+{
+  const size_t mask = g->table.size - 1;
+  size_t i = h & mask;
+  while (g->table.vals[i]) {
+    const size_t id = g->table.vals[i] - 1;
+    const struct grammarNode* n = &g->nodes.vals[id];
+    if (n->h == h && n->rule == rule && n->argc == argc && (argc == 0
+      || memcmp(g->args.vals + n->first, kids, argc * sizeof(size_t)) == 0)) {
+      break;
+    }
+    i = (i + 1) & mask;
+  }
+  return i;
+}
+
+size_t
+grammarFindNode(const struct grammar* g, size_t rule, const size_t* kids,
+  size_t argc)
+{
+  const hash_t h = grammarHashNode(rule, kids, argc);
+  const size_t slot = g->table.vals[grammarFindSlot(g, h, rule, kids, argc)];
+  return slot ? slot - 1 : grammar_none_id;
+}
+
+size_t
+grammarMakeNode(struct grammar* g, size_t rule, const size_t* kids,
+  size_t argc)
+{
+  const hash_t h = grammarHashNode(rule, kids, argc);
+  const size_t i = grammarFindSlot(g, h, rule, kids, argc);
+  if (g->table.vals[i]) { return g->table.vals[i] - 1; }
+/* a new node */
+  enum memtag tag = memorySetTag(memtag_grammar);
+  struct grammarNode n;
+  n.rule = rule;
+  n.h = h;
+  n.first = g->args.size;
+  n.argc = argc;
+  if (argc > 0) { size_tArrayAppend(&g->args, kids, argc); }
+  grammarNodeArrayAdd(&g->nodes, n);
+  const size_t id = g->nodes.size - 1;
+  g->table.vals[i] = id + 1;
+/* keep the load below one half */
+  if (2 * g->nodes.size > g->table.size) { grammarGrowTable(g); }
+  memorySetTag(tag);
+  return id;
+}
+
+size_t
+grammarGetTypeCode(const struct grammar* g, const struct verifier* vrf,
+  size_t node)
+{
+  const struct grammarNode* n = &g->nodes.vals[node];
+  size_t type = 0;
+  if (n->argc == 0 && grammarIsVariable(vrf, n->rule)) {
+    type = grammarGet(&g->symTypes, n->rule);
+  } else {
+    const size_t ruleId = grammarGet(&g->symRules, n->rule);
+    if (ruleId) { type = g->rules.vals[ruleId - 1].type + 1; }
+  }
+  return type ? g->types.vals[type - 1].symId : symbol_none_id;
+}
+
+void
+grammarAddFloating(struct grammar* g, const struct verifier* vrf,
+  size_t symId)
+{
+  const struct symbol* sym = &vrf->symbols.vals[symId];
+  const struct symstring* stmt = &vrf->stmts.vals[sym->stmt];
+  if (stmt->size != 2) { return; }
+  const size_t code = stmt->vals[0];
+  const size_t var = stmt->vals[1];
+  if (grammarIsVariable(vrf, code) || !grammarIsVariable(vrf, var)) { return; }
+  size_t type = grammarGet(&g->symTypes, code);
+  if (type == 0) {
+    struct grammarType t;
+    t.symId = code;
+    t.firstRule = 0;
+    t.lastRule = 0;
+    enum memtag tag = memorySetTag(memtag_grammar);
+    grammarTypeArrayAdd(&g->types, t);
+    memorySetTag(tag);
+    type = g->types.size;
+    *grammarEntry(&g->symTypes, code) = type;
+  }
+  *grammarEntry(&g->symTypes, var) = type;
+/* the tree of a floating hypothesis is the variable under its type code */
+  const size_t leaf = grammarMakeNode(g, var, NULL, 0);
+  *grammarEntry(&g->stmtTrees, sym->stmt) = grammarMakeNode(g, code, &leaf, 1);
+}
+
+/* add the assertion symId as a rule if it is a syntax axiom */
+static void
+grammarAddRule(struct grammar* g, const struct verifier* vrf, size_t symId)
+{
+  size_t i;
+  const struct symbol* sym = &vrf->symbols.vals[symId];
+  const struct symstring* stmt = &vrf->stmts.vals[sym->stmt];
+  const struct frame* frm = &vrf->frames.vals[sym->frame];
+  if (stmt->size == 0 || grammarIsVariable(vrf, stmt->vals[0])) { return; }
+  const size_t type = grammarGet(&g->symTypes, stmt->vals[0]);
+  if (type == 0) { return; }
+  const size_t argc = frm->stmts.size;
+  for (i = 0; i < argc; i++) {
+    if (!verifierIsType(vrf, frm->stmts.vals[i], symType_floating)) { return; }
+  }
+  enum memtag tag = memorySetTag(memtag_grammar);
+  struct grammarRule rule;
+  rule.symId = symId;
+  rule.type = type - 1;
+  rule.first = g->vars.size;
+  rule.argc = argc;
+  rule.next = 0;
+/* the frame is in reverse order */
+  for (i = 0; i < argc; i++) {
+    const size_t hyp = frm->stmts.vals[argc - 1 - i];
+    const struct symstring* f = &vrf->stmts.vals[vrf->symbols.vals[hyp].stmt];
+    size_tArrayAdd(&g->vars, f->vals[1]);
+    size_tArrayAdd(&g->varTypes, grammarGet(&g->symTypes, f->vals[0]) - 1);
+  }
+  grammarRuleArrayAdd(&g->rules, rule);
+  memorySetTag(tag);
+  const size_t ruleId = g->rules.size;
+  struct grammarType* t = &g->types.vals[type - 1];
+  if (t->lastRule) {
+    g->rules.vals[t->lastRule - 1].next = ruleId;
+  } else {
+    t->firstRule = ruleId;
+  }
+  t->lastRule = ruleId;
+  *grammarEntry(&g->symRules, symId) = ruleId;
+}
+
+void
+grammarAddStatement(struct grammar* g, const struct verifier* vrf,
+  size_t symId)
+{
+  const struct symbol* sym = &vrf->symbols.vals[symId];
+  if (sym->type == symType_assertion) { grammarAddRule(g, vrf, symId); }
+  size_t tree;
+  if (sym->type == symType_provable && g->thm != grammar_none_id) {
+/* parsed when its proof was checked */
+    tree = g->thm;
+  } else {
+    tree = grammarParse(g, vrf, &vrf->stmts.vals[sym->stmt]);
+  }
+  g->thm = grammar_none_id;
+  *grammarEntry(&g->stmtTrees, sym->stmt) = tree;
+}
+
+/* add a parse of the type at a position ending before end */
+static void
+grammarAddResult(struct grammar* g, size_t memo, size_t node, size_t end)
+{
+  enum memtag tag = memorySetTag(memtag_grammar);
+  size_tArrayAdd(&g->results, node);
+  size_tArrayAdd(&g->results, end);
+  size_tArrayAdd(&g->results, g->memo.vals[memo].head);
+  memorySetTag(tag);
+  g->memo.vals[memo].head = g->results.size - 2;
+}
+
+static void
+grammarParseAt(struct grammar* g, const struct verifier* vrf,
+  const size_t* body, size_t n, size_t type, size_t pos);
+
+/* match the tokens of the rule from k on with the body from pos on. The */
+/* children matched so far are in kids from kid */
+static void
+grammarMatch(struct grammar* g, const struct verifier* vrf,
+  const size_t* body, size_t n, size_t ruleId, size_t k, size_t pos,
+  size_t kid, size_t memo)
+{
+  size_t j;
+  const struct grammarRule* rule = &g->rules.vals[ruleId];
+  const size_t symId = rule->symId;
+  const struct symstring* pat = &vrf->stmts.vals[vrf->symbols.vals[symId].stmt];
+  if (g->results.size > grammar_max_results) { return; }
+  if (k == pat->size) {
+    const size_t node = grammarMakeNode(g, symId, g->kids.vals + kid,
+      rule->argc);
+    grammarAddResult(g, memo, node, pos);
+    return;
+  }
+  const size_t tok = pat->vals[k];
+  if (!grammarIsVariable(vrf, tok)) {
+    if (pos < n && body[pos] == tok) {
+      grammarMatch(g, vrf, body, n, ruleId, k + 1, pos + 1, kid, memo);
+    }
+    return;
+  }
+  for (j = 0; j < rule->argc; j++) {
+    if (g->vars.vals[rule->first + j] == tok) { break; }
+  }
+  if (j == rule->argc) { return; }
+  const size_t type = g->varTypes.vals[rule->first + j];
+  grammarParseAt(g, vrf, body, n, type, pos);
+  size_t r;
+  for (r = g->memo.vals[type * (n + 1) + pos].head; r;
+    r = g->results.vals[r + 1]) {
+    const size_t node = g->results.vals[r - 1];
+    const size_t end = g->results.vals[r];
+    const size_t old = g->kids.vals[kid + j];
+/* a variable used twice must match the same tree */
+    if (old != grammar_none_id && old != node) { continue; }
+    g->kids.vals[kid + j] = node;
+    grammarMatch(g, vrf, body, n, ruleId, k + 1, end, kid, memo);
+    g->kids.vals[kid + j] = old;
+  }
+}
+
+/* find all parses of the type starting at pos. A parse already in */
+/* progress is cut, so left recursive rules find nothing */
+static void
+grammarParseAt(struct grammar* g, const struct verifier* vrf,
+  const size_t* body, size_t n, size_t type, size_t pos)
+{
+  size_t i, r;
+  const size_t memo = type * (n + 1) + pos;
+  if (g->memo.vals[memo].state != grammar_memo_unseen) { return; }
+  g->memo.vals[memo].state = grammar_memo_busy;
+  if (pos < n && grammarIsVariable(vrf, body[pos])
+    && grammarGet(&g->symTypes, body[pos]) == type + 1) {
+    grammarAddResult(g, memo, grammarMakeNode(g, body[pos], NULL, 0), pos + 1);
+  }
+  for (r = g->types.vals[type].firstRule; r; r = g->rules.vals[r - 1].next) {
+    const struct grammarRule* rule = &g->rules.vals[r - 1];
+    const struct symstring* pat =
+      &vrf->stmts.vals[vrf->symbols.vals[rule->symId].stmt];
+/* most rules start with a constant */
+    if (pat->size > 1 && !grammarIsVariable(vrf, pat->vals[1])
+      && (pos == n || body[pos] != pat->vals[1])) {
+      continue;
+    }
+    const size_t kid = g->kids.size;
+    const size_t argc = rule->argc;
+    enum memtag tag = memorySetTag(memtag_grammar);
+    for (i = 0; i < argc; i++) {
+      size_tArrayAdd(&g->kids, grammar_none_id);
+    }
+    memorySetTag(tag);
+    grammarMatch(g, vrf, body, n, r - 1, 1, pos, kid, memo);
+    g->kids.size = kid;
+  }
+  g->memo.vals[memo].state = grammar_memo_done;
+}
+
+size_t
+grammarParse(struct grammar* g, const struct verifier* vrf,
+  const struct symstring* str)
+{
+  size_t i, r;
+  g->stmtCount++;
+  if (str->size < 2 || g->types.size == 0) { return grammar_none_id; }
+  const size_t code = str->vals[0];
+  const size_t* body = str->vals + 1;
+  const size_t n = str->size - 1;
+  const size_t count = g->types.size * (n + 1);
+  enum memtag tag = memorySetTag(memtag_grammar);
+  grammarMemoArrayGrow(&g->memo, count);
+  memorySetTag(tag);
+  for (i = 0; i < count; i++) {
+    g->memo.vals[i].state = grammar_memo_unseen;
+    g->memo.vals[i].head = 0;
+  }
+  g->memo.size = count;
+  g->results.size = 0;
+/* the body of a statement of a syntax type code is of that type. Others, */
+/* like |-, are tried with each type in the order they were declared */
+  size_t first = 0;
+  size_t last = g->types.size;
+  const size_t type = grammarGet(&g->symTypes, code);
+  if (type != 0 && !grammarIsVariable(vrf, code)) {
+    first = type - 1;
+    last = type;
+  }
+  size_t tree = grammar_none_id;
+  for (i = first; i < last && tree == grammar_none_id; i++) {
+    grammarParseAt(g, vrf, body, n, i, 0);
+/* take the first parse of the whole body */
+    for (r = g->memo.vals[i * (n + 1)].head; r; r = g->results.vals[r + 1]) {
+      if (g->results.vals[r] == n) {
+        tree = g->results.vals[r - 1];
+        break;
+      }
+    }
+  }
+  if (tree == grammar_none_id) { return grammar_none_id; }
+  g->parsed++;
+  return grammarMakeNode(g, code, &tree, 1);
+}
+
+void
+grammarFlatten(const struct grammar* g, const struct verifier* vrf,
+  struct symstring* str, size_t node)
+{
+  size_t i, j;
+  const struct grammarNode* n = &g->nodes.vals[node];
+  const size_t ruleId = grammarGet(&g->symRules, n->rule);
+  if (ruleId) {
+    const struct grammarRule* rule = &g->rules.vals[ruleId - 1];
+    const struct symstring* pat =
+      &vrf->stmts.vals[vrf->symbols.vals[rule->symId].stmt];
+    for (i = 1; i < pat->size; i++) {
+      const size_t tok = pat->vals[i];
+      if (!grammarIsVariable(vrf, tok)) {
+        symstringAdd(str, tok);
+        continue;
+      }
+      for (j = 0; j < rule->argc; j++) {
+        if (g->vars.vals[rule->first + j] == tok) { break; }
+      }
+      DEBUG_ASSERT(j < rule->argc, "variable not in rule");
+      grammarFlatten(g, vrf, str, g->args.vals[n->first + j]);
+    }
+  } else if (n->argc == 0) {
+/* a variable */
+    symstringAdd(str, n->rule);
+  } else {
+/* the root of a statement */
+    symstringAdd(str, n->rule);
+    grammarFlatten(g, vrf, str, g->args.vals[n->first]);
+  }
+}
+
+size_t
+grammarSubstitute(struct grammar* g, const struct verifier* vrf,
+  size_t node)
+{
+  size_t i;
+  const struct grammarNode* n = &g->nodes.vals[node];
+  const size_t rule = n->rule;
+  const size_t first = n->first;
+  const size_t argc = n->argc;
+  if (argc == 0) {
+    if (!grammarIsVariable(vrf, rule)) { return node; }
+    for (i = 0; i < g->subVars.size; i++) {
+      if (g->subVars.vals[i] == rule) { return g->subTrees.vals[i]; }
+    }
+    return node;
+  }
+/* nodes may move while the children are substituted */
+  const size_t kid = g->kids.size;
+  int isChanged = 0;
+  for (i = 0; i < argc; i++) {
+    const size_t child = g->args.vals[first + i];
+    const size_t s = grammarSubstitute(g, vrf, child);
+    if (s != child) { isChanged = 1; }
+    enum memtag tag = memorySetTag(memtag_grammar);
+    size_tArrayAdd(&g->kids, s);
+    memorySetTag(tag);
+  }
+  size_t res = node;
+  if (isChanged) { res = grammarMakeNode(g, rule, g->kids.vals + kid, argc); }
+  g->kids.size = kid;
+  return res;
+}
+
+/* add the variables of the tree to set */
+static void
+grammarGetVariables(const struct grammar* g, const struct verifier* vrf,
+  struct size_tArray* set, size_t node)
+{
+  size_t i;
+  const struct grammarNode* n = &g->nodes.vals[node];
+  if (n->argc == 0) {
+    if (grammarIsVariable(vrf, n->rule) && !symstringIsIn(set, n->rule)) {
+      size_tArrayAdd(set, n->rule);
+    }
+    return;
+  }
+  for (i = 0; i < n->argc; i++) {
+    grammarGetVariables(g, vrf, set, g->args.vals[n->first + i]);
+  }
+}
+
+/* the disjoint variable restrictions of frm hold for the substitution in */
+/* ctx. See verifierIsValidDisjointPairSubstitution */
+static int
+grammarIsValidSubstitution(struct grammar* g, const struct verifier* vrf,
+  const struct frame* ctx, const struct frame* frm)
+{
+  size_t i, j, k, l;
+  for (i = 0; i < g->subVars.size; i++) {
+    for (j = i + 1; j < g->subVars.size; j++) {
+      if (!frameAreDisjoint(frm, g->subVars.vals[i], g->subVars.vals[j])) {
+        continue;
+      }
+      g->dv1.size = 0;
+      g->dv2.size = 0;
+      enum memtag tag = memorySetTag(memtag_grammar);
+      grammarGetVariables(g, vrf, &g->dv1, g->subTrees.vals[i]);
+      grammarGetVariables(g, vrf, &g->dv2, g->subTrees.vals[j]);
+      memorySetTag(tag);
+      if (symstringIsIntersecting(&g->dv1, &g->dv2)) { return 0; }
+      for (k = 0; k < g->dv1.size; k++) {
+        for (l = 0; l < g->dv2.size; l++) {
+          if (!frameAreDisjoint(ctx, g->dv1.vals[k], g->dv2.vals[l])) {
+            return 0;
+          }
+        }
+      }
+    }
+  }
+  return 1;
+}
+
+/* the slot of the application of symId to args, or NULL if applications */
+/* are not remembered. isFound is set if the slot holds it */
+static struct grammarApp*
+grammarFindApp(struct grammar* g, size_t symId, const size_t* args,
+  size_t argc, int* isFound)
+{
+  *isFound = 0;
+  if (g->apps.size == 0 || argc > grammar_app_max_args) { return NULL; }
+  g->appLookups++;
+  const hash_t h = grammarHashNode(symId, args, argc);
+  struct grammarApp* app = &g->apps.vals[h & (g->apps.size - 1)];
+  if (app->symId == symId && app->argc == argc
+    && memcmp(app->args, args, argc * sizeof(size_t)) == 0) {
+    g->appHits++;
+    *isFound = 1;
+  }
+  return app;
+}
+
+static void
+grammarAddApp(struct grammarApp* app, size_t symId, const size_t* args,
+  size_t argc, size_t res)
+{
+  if (!app) { return; }
+  app->symId = symId;
+  app->argc = argc;
+  memcpy(app->args, args, argc * sizeof(size_t));
+  app->res = res;
+}
+
+/* the substitution of the floating hypotheses of frm by the arguments */
+/* from base. Returns 0 if an argument is not of the type of its variable */
+static int
+grammarSetSubstitution(struct grammar* g, const struct verifier* vrf,
+  const struct frame* frm, size_t base)
+{
+  size_t i;
+  const size_t argc = frm->stmts.size;
+  g->subVars.size = 0;
+  g->subTrees.size = 0;
+  for (i = 0; i < argc; i++) {
+    const struct symbol* hyp = &vrf->symbols.vals[frm->stmts.vals[argc - 1 - i]];
+    if (hyp->type != symType_floating) { continue; }
+    const struct symstring* pat = &vrf->stmts.vals[hyp->stmt];
+    const struct grammarNode* arg = &g->nodes.vals[g->stack.vals[base + i]];
+    if (pat->size != 2 || arg->argc != 1 || arg->rule != pat->vals[0]) {
+      return 0;
+    }
+    enum memtag tag = memorySetTag(memtag_grammar);
+    size_tArrayAdd(&g->subVars, pat->vals[1]);
+    size_tArrayAdd(&g->subTrees, g->args.vals[arg->first]);
+    memorySetTag(tag);
+  }
+  return 1;
+}
+
+/* pop the hypotheses of the assertion, and push its statement with the */
+/* trees of the floating hypotheses substituted. See verifierApplyAssertion */
+static void
+grammarApplyAssertion(struct grammar* g, const struct verifier* vrf,
+  const struct frame* ctx, size_t symId)
+{
+  size_t i;
+  const struct symbol* sym = &vrf->symbols.vals[symId];
+  const struct frame* frm = &vrf->frames.vals[sym->frame];
+  const size_t argc = frm->stmts.size;
+  if (g->stack.size < argc) {
+    g->isFailed = 1;
+    return;
+  }
+/* the first argument is the deepest. The frame is in reverse order */
+  const size_t base = g->stack.size - argc;
+  const size_t* args = g->stack.vals + base;
+/* applying a syntax axiom makes one node, which is as fast as the memo */
+  int isFound = 0;
+  struct grammarApp* app = NULL;
+  if (!grammarGet(&g->symRules, symId)) {
+    app = grammarFindApp(g, symId, args, argc, &isFound);
+  }
+  if (isFound) {
+    const int hasDisjoint = (frm->disjoint1.size > 0);
+    if (app->res == grammar_none_id
+      || (hasDisjoint && (!grammarSetSubstitution(g, vrf, frm, base)
+      || !grammarIsValidSubstitution(g, vrf, ctx, frm)))) {
+      g->isFailed = 1;
+      return;
+    }
+    const size_t res = app->res;
+    g->stack.size = base;
+    size_tArrayAdd(&g->stack, res);
+    return;
+  }
+  if (!grammarSetSubstitution(g, vrf, frm, base)) {
+    grammarAddApp(app, symId, args, argc, grammar_none_id);
+    g->isFailed = 1;
+    return;
+  }
+/* this depends on ctx, so it is not remembered */
+  if (!grammarIsValidSubstitution(g, vrf, ctx, frm)) {
+    g->isFailed = 1;
+    return;
+  }
+/* the essential hypotheses must be the same nodes as their arguments */
+  for (i = 0; i < argc; i++) {
+    const struct symbol* hyp = &vrf->symbols.vals[frm->stmts.vals[argc - 1 - i]];
+    if (hyp->type != symType_essential) { continue; }
+    const size_t tree = grammarGet(&g->stmtTrees, hyp->stmt);
+    if (tree == grammar_none_id) {
+      g->isSkipped = 1;
+      return;
+    }
+    if (grammarSubstitute(g, vrf, tree) != g->stack.vals[base + i]) {
+      grammarAddApp(app, symId, args, argc, grammar_none_id);
+      g->isFailed = 1;
+      return;
+    }
+  }
+  const size_t tree = grammarGet(&g->stmtTrees, sym->stmt);
+  if (tree == grammar_none_id) {
+    g->isSkipped = 1;
+    return;
+  }
+  const size_t res = grammarSubstitute(g, vrf, tree);
+  grammarAddApp(app, symId, args, argc, res);
+  g->stack.size = base;
+  size_tArrayAdd(&g->stack, res);
+}
+
+void
+grammarRunProof(struct grammar* g, struct verifier* vrf,
+  const struct frame* ctx, const struct proofStepArray* steps)
+{
+  size_t i;
+  g->errc = vrf->errc;
+  g->isSkipped = 0;
+  g->isFailed = 0;
+  g->stack.size = 0;
+  g->tags.size = 0;
+  g->steps.size = 0;
+  timerStart(&g->timer);
+  enum memtag tag = memorySetTag(memtag_grammar);
+  for (i = 0; i < steps->size; i++) {
+    const struct proofStep* step = &steps->vals[i];
+    if (step->isTagRef) {
+      size_tArrayAdd(&g->stack, g->tags.vals[step->id]);
+    } else {
+      const struct symbol* sym = &vrf->symbols.vals[step->id];
+      if (sym->type == symType_floating || sym->type == symType_essential) {
+        const size_t tree = grammarGet(&g->stmtTrees, sym->stmt);
+        if (tree == grammar_none_id) { g->isSkipped = 1; }
+        size_tArrayAdd(&g->stack, tree);
+      } else if (sym->type == symType_assertion
+        || sym->type == symType_provable) {
+        grammarApplyAssertion(g, vrf, ctx, step->id);
+      } else {
+        g->isFailed = 1;
+      }
+    }
+    if (g->isSkipped || g->isFailed) { break; }
+    size_tArrayAdd(&g->steps, g->stack.vals[g->stack.size - 1]);
+    if (step->isTagged) {
+      size_tArrayAdd(&g->tags, g->stack.vals[g->stack.size - 1]);
+    }
+  }
+  memorySetTag(tag);
+  timerStop(&g->timer);
+}
+
+void
+grammarCheckProof(struct grammar* g, struct verifier* vrf,
+  const struct symstring* thm)
+{
+  g->thm = grammarParse(g, vrf, thm);
+  if (g->isSkipped || g->thm == grammar_none_id) {
+    g->skipped++;
+    return;
+  }
+  g->checked++;
+  const int isTreeValid = !g->isFailed && g->stack.size == 1
+    && g->stack.vals[0] == g->thm;
+  const int isStringValid = (vrf->errc == g->errc);
+  if (isTreeValid != isStringValid) {
+    g->mismatches++;
+    H_LOG_ERR(vrf, error_mismatchedGrammar, 1,
+      "the syntax tree check %s the proof but the string check %s it",
+      isTreeValid ? "accepts" : "rejects",
+      isStringValid ? "accepts" : "rejects");
+    return;
+  }
+/* if both got to the end, they must have derived the same statement */
+  if (g->isFailed || g->stack.size == 0 || vrf->stack.size == 0) { return; }
+  struct symstring str;
+  symstringInit(&str);
+  grammarFlatten(g, vrf, &str, g->stack.vals[0]);
+  if (!symstringIsEqual(&str, &vrf->stack.vals[0])) {
+    g->mismatches++;
+    H_LOG_ERR(vrf, error_mismatchedGrammar, 1,
+      "the syntax tree check derived %s but the string check derived %s",
+      verifierDiagSym(vrf, &str), verifierDiagSym(vrf, &vrf->stack.vals[0]));
+  }
+  symstringClean(&str);
+}
@@ -0,0 +1,206 @@
+#ifndef _HALMOSGRAMMAR_H_
+#define _HALMOSGRAMMAR_H_
+#include "array.h"
+#include "hash.h"
+#include "symstring.h"
+#include "timer.h"
+struct frame;
+struct proofStepArray;
+struct verifier;
+
+/* The grammar stage parses statements into syntax trees, using the type */
+/* codes of $f statements and the syntax axioms, which are $a statements */
+/* of such a type code with only $f hypotheses. Nodes are made once, so */
+/* two trees are equal if and only if they are the same node */
+
+/* id of the node of statements which could not be parsed */
+extern const size_t grammar_none_id;
+
+/* a node is a variable, with no children, a syntax axiom applied to the */
+/* trees of its variables, or the root of a statement, whose rule is the */
+/* type code and whose child is the body */
+struct grammarNode {
+/* symId of the variable, syntax axiom or type code */
+  size_t rule;
+  hash_t h;
+/* the children are args.vals[first .. first + argc - 1] */
+  size_t first;
+  size_t argc;
+};
+typedef struct grammarNode grammarNode;
+DECLARE_ARRAY(grammarNode)
+
+/* a syntax axiom. Its children are its variables in the order of the */
+/* floating hypotheses in its frame */
+struct grammarRule {
+  size_t symId;
+/* index to the types */
+  size_t type;
+/* the variables are vars.vals[first .. first + argc - 1] */
+  size_t first;
+  size_t argc;
+/* the next rule of the same type + 1, or 0 */
+  size_t next;
+};
+typedef struct grammarRule grammarRule;
+DECLARE_ARRAY(grammarRule)
+
+/* a type code of $f statements */
+struct grammarType {
+  size_t symId;
+/* the first and last rule of the type + 1, or 0 */
+  size_t firstRule;
+  size_t lastRule;
+};
+typedef struct grammarType grammarType;
+DECLARE_ARRAY(grammarType)
+
+/* an assertion applied to arguments, remembered across proofs. The */
+/* result depends only on the assertion and the argument trees, except for */
+/* the disjoint variable restrictions, which are checked again in each */
+/* context */
+enum { grammar_app_max_args = 8 };
+struct grammarApp {
+/* symbol_none_id if the slot is empty */
+  size_t symId;
+  size_t argc;
+  size_t args[grammar_app_max_args];
+/* the tree pushed, or grammar_none_id if the hypotheses do not match */
+  size_t res;
+};
+typedef struct grammarApp grammarApp;
+DECLARE_ARRAY(grammarApp)
+
+/* what is known about a token at a position of the statement being */
+/* parsed, for each type */
+struct grammarMemo {
+  int state;
+/* the parses found, as a list in results */
+  size_t head;
+};
+typedef struct grammarMemo grammarMemo;
+DECLARE_ARRAY(grammarMemo)
+
+struct grammar {
+  struct grammarNodeArray nodes;
+  struct size_tArray args;
+/* hashed set of nodes. Slots hold the node id + 1, or 0 if empty */
+  struct size_tArray table;
+  struct grammarRuleArray rules;
+/* the variables of the rules, and their types */
+  struct size_tArray vars;
+  struct size_tArray varTypes;
+  struct grammarTypeArray types;
+/* for each symbol, the type + 1 of a type code, or of a variable through */
+/* its latest $f statement, or 0 */
+  struct size_tArray symTypes;
+/* for each symbol, the rule + 1 of a syntax axiom, or 0 */
+  struct size_tArray symRules;
+/* for each statement, the root of its tree */
+  struct size_tArray stmtTrees;
+/* scratch space of the parser: the memo for each type and position, */
+/* lists of (node, end, next) triples, and the children being matched */
+  struct grammarMemoArray memo;
+  struct size_tArray results;
+  struct size_tArray kids;
+/* the proof stack and the tagged steps of the tree check, and the tree */
+/* pushed by each step */
+  struct size_tArray stack;
+  struct size_tArray tags;
+  struct size_tArray steps;
+/* the substitution of the assertion being applied */
+  struct size_tArray subVars;
+  struct size_tArray subTrees;
+/* the variables in the substitutions of two disjoint variables */
+  struct size_tArray dv1;
+  struct size_tArray dv2;
+/* the applications remembered, in a table of a power of two slots where */
+/* a new application replaces the one in its slot. Empty if not used */
+  struct grammarAppArray apps;
+  size_t appLookups;
+  size_t appHits;
+/* time spent running proofs on trees */
+  struct timer timer;
+/* the tree of the last theorem checked, reused when it is added */
+  size_t thm;
+/* the number of errors before the proof, and whether the tree check was */
+/* skipped or failed */
+  size_t errc;
+  int isSkipped;
+  int isFailed;
+/* counts */
+  size_t stmtCount;
+  size_t parsed;
+  size_t checked;
+  size_t skipped;
+  size_t mismatches;
+};
+
+void
+grammarInit(struct grammar* g);
+
+void
+grammarClean(struct grammar* g);
+
+/* remember the results of up to size assertion applications, or none if */
+/* size is 0. The size is rounded up to a power of two */
+void
+grammarSetApps(struct grammar* g, size_t size);
+
+/* return the node with the given rule and children, making it if needed */
+size_t
+grammarMakeNode(struct grammar* g, size_t rule, const size_t* kids,
+  size_t argc);
+
+/* return the node with the given rule and children, or grammar_none_id */
+/* if it was not made. Nothing is changed, so threads may look up nodes */
+/* at once while none are made */
+size_t
+grammarFindNode(const struct grammar* g, size_t rule, const size_t* kids,
+  size_t argc);
+
+/* the type code of a tree which is a variable or a syntax axiom applied, */
+/* or symbol_none_id */
+size_t
+grammarGetTypeCode(const struct grammar* g, const struct verifier* vrf,
+  size_t node);
+
+/* record the type code of the variable of the $f statement symId */
+void
+grammarAddFloating(struct grammar* g, const struct verifier* vrf,
+  size_t symId);
+
+/* parse the statement of the $e, $a, or $p statement symId. Syntax axioms */
+/* are added as rules first */
+void
+grammarAddStatement(struct grammar* g, const struct verifier* vrf,
+  size_t symId);
+
+/* return the tree of the statement str, or grammar_none_id */
+size_t
+grammarParse(struct grammar* g, const struct verifier* vrf,
+  const struct symstring* str);
+
+/* append the tokens of the tree to str */
+void
+grammarFlatten(const struct grammar* g, const struct verifier* vrf,
+  struct symstring* str, size_t node);
+
+/* replace the variables in the tree by the trees of subVars and subTrees */
+size_t
+grammarSubstitute(struct grammar* g, const struct verifier* vrf,
+  size_t node);
+
+/* run the steps of a proof on trees. The tree pushed by each step is put */
+/* in steps, up to where the check failed or was skipped */
+void
+grammarRunProof(struct grammar* g, struct verifier* vrf,
+  const struct frame* ctx, const struct proofStepArray* steps);
+
+/* compare the tree check of the proof of thm with the string check, which */
+/* has run since grammarRunProof */
+void
+grammarCheckProof(struct grammar* g, struct verifier* vrf,
+  const struct symstring* thm);
+
+#endif
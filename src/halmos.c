@@ -1,10 +1,13 @@
 #include "dbg.h"
 #include "halmos.h"
+#include "memory.h"
+#include "minimizer.h"
 #include "preproc.h"
 #include "verifier.h"
 #include <errno.h>
 #include <stdio.h>
-#include <time.h>
+#include <stdlib.h>
+#include <string.h>
 
 static const char* flags[halmosflag_size] = {
   "",
@@ -17,6 +20,25 @@ static const char* flags[halmosflag_size] = {
   "--report-hash",
   "--report-time",
   "--help",
+  "--metrics-json",
+  "--report-memory",
+  "--perf-counters",
+  "--threads",
+  "--preproc-cache",
+  "--include-graph",
+  "--grammar",
+  "--only",
+  "--lazy",
+  "--deps",
+  "--rdeps",
+  "--error-limit",
+  "--error-json",
+  "--unique-errors",
+  "--grammar-memo",
+  "--candidates",
+  "--minimize",
+  "--find-duplicates",
+  "--minimize-suffix",
   // "--include",
 };
 
@@ -30,6 +52,26 @@ static const size_t flagsArgc[halmosflag_size] = {
   0, /* report-count */
   0, /* report-hash */
   0, /* report-time */
+  0, /* help */
+  1, /* metrics-json - the output file */
+  0, /* report-memory */
+  0, /* perf-counters */
+  1, /* threads - the number of threads */
+  1, /* preproc-cache - the cache directory */
+  1, /* include-graph - the output file */
+  0, /* grammar */
+  1, /* only - comma-separated labels */
+  0, /* lazy */
+  1, /* deps - a $p label */
+  1, /* rdeps - a $a or $p label */
+  1, /* error-limit - the number of diagnostics */
+  1, /* error-json - the output file */
+  0, /* unique-errors */
+  1, /* grammar-memo - the number of applications */
+  1, /* candidates - a $a or $p label */
+  1, /* minimize - a $p label or all */
+  0, /* find-duplicates */
+  1, /* minimize-suffix - added to the names of the files written */
   // 0, /* include */
 };
 
@@ -57,14 +99,359 @@ halmosClean(struct halmos* h)
   (void) h;
 }
 
+/* write the phase timers and counters of the verifier as a json object */
+void
+halmosWriteMetrics(struct halmos* h, const struct verifier* vrf,
+  const char* filename)
+{
+  size_t i;
+  struct memstat mem;
+  FILE* f = fopen(filename, "w");
+  if (!f) {
+    printf("failed to open %s\n", filename);
+    return;
+  }
+  (void) h;
+  fprintf(f, "{\n  \"timers\": {\n");
+  for (i = 0; i < phase_size; i++) {
+    const struct timer* t = &vrf->timers[i];
+    fprintf(f, "    \"%s\": {\"wall\": %.9f, \"cpu\": %.9f, "
+      "\"count\": %lu}%s\n", phaseString(i), t->wall, t->cpu, t->count,
+      (i + 1 < phase_size) ? "," : "");
+  }
+  fprintf(f, "  },\n  \"symCount\": {\n");
+  for (i = symType_constant; i < symType_size; i++) {
+    fprintf(f, "    \"%s\": %lu%s\n", symTypeString(i), vrf->symCount[i],
+      (i + 1 < symType_size) ? "," : "");
+  }
+  fprintf(f, "  },\n");
+  fprintf(f, "  \"hashc\": %lu,\n", vrf->hashc);
+  fprintf(f, "  \"errors\": %lu,\n", vrf->errc);
+  fprintf(f, "  \"allocations\": {\n");
+  for (i = 0; i <= memtag_size; i++) {
+    if (i < memtag_size) {
+      memoryGetStats(&mem, i);
+    } else {
+      memoryGetTotal(&mem);
+    }
+    fprintf(f, "    \"%s\": {\"mallocs\": %lu, \"reallocs\": %lu, "
+      "\"bytes\": %lu, \"copies\": %lu, \"copyBytes\": %lu, "
+      "\"frees\": %lu, \"live\": %lu, \"peak\": %lu}%s\n",
+      (i < memtag_size) ? memtagString(i) : "total", mem.mallocs,
+      mem.reallocs, mem.bytes, mem.copies, mem.copyBytes, mem.frees, mem.live,
+      mem.peak, (i < memtag_size) ? "," : "");
+  }
+  fprintf(f, "  }\n");
+  fprintf(f, "}\n");
+  fclose(f);
+}
+
+void
+halmosReportMemory(struct halmos* h)
+{
+  size_t i;
+  struct memstat mem;
+  (void) h;
+  printf("------memory\n");
+#ifndef MEMORY_STATS
+  printf("(build with -DMEMORY_STATS for frees, live and peak bytes)\n");
+#endif
+  printf("%-14s %10s %10s %12s %8s %12s %12s\n", "tag", "mallocs",
+    "reallocs", "bytes", "copies", "copy bytes", "peak");
+  for (i = 0; i <= memtag_size; i++) {
+    if (i < memtag_size) {
+      memoryGetStats(&mem, i);
+    } else {
+      memoryGetTotal(&mem);
+    }
+    printf("%-14s %10lu %10lu %12lu %8lu %12lu %12lu\n",
+      (i < memtag_size) ? memtagString(i) : "total", mem.mallocs,
+      mem.reallocs, mem.bytes, mem.copies, mem.copyBytes, mem.peak);
+  }
+}
+
+void
+halmosReportCounters(struct halmos* h, const struct verifier* vrf)
+{
+  size_t i, j;
+  (void) h;
+  printf("------performance counters\n");
+  if (!perfIsOpen(&vrf->perf)) {
+    printf("unavailable: %s\n", strerror(vrf->perf.err));
+    return;
+  }
+  if (!vrf->perf.isInherited) {
+    printf("(the main thread only, not the threads it started)\n");
+  }
+  printf("%-14s %8s", "phase", "count");
+  for (j = 0; j < perfevent_size; j++) {
+    printf(" %14s", perfeventString(j));
+  }
+  printf(" %6s\n", "ipc");
+  for (i = 0; i < phase_size; i++) {
+    const struct perfcount* c = &vrf->counts[i];
+    if (c->count == 0) { continue; }
+    printf("%-14s %8lu", phaseString(i), c->count);
+    for (j = 0; j < perfevent_size; j++) {
+      if (perfIsCounted(&vrf->perf, j)) {
+        printf(" %14.0f", perfcountGet(c, j));
+      } else {
+        printf(" %14s", "n/a");
+      }
+    }
+    double cycles = perfcountGet(c, perfevent_cycles);
+    if (perfIsCounted(&vrf->perf, perfevent_instructions) && cycles > 0) {
+      printf(" %6.2f\n", perfcountGet(c, perfevent_instructions) / cycles);
+    } else {
+      printf(" %6s\n", "n/a");
+    }
+  }
+}
+
+void
+halmosReportDeps(struct halmos* h, struct verifier* vrf, const char* label,
+  int isReverse)
+{
+  size_t i, n;
+  (void) h;
+  printf("------%s %s\n", isReverse ? "rdeps" : "deps", label);
+  const size_t symId = verifierFindLabel(vrf, label);
+  const enum symType type = (symId == symbol_none_id) ? symType_none
+    : vrf->symbols.vals[symId].type;
+  if (isReverse && type != symType_assertion && type != symType_provable) {
+    printf("%s is not a $a or $p statement\n", label);
+    return;
+  }
+  if (!isReverse && type != symType_provable) {
+    printf("%s is not a $p statement\n", label);
+    return;
+  }
+  const size_t* ids = isReverse ? verifierGetRdeps(vrf, symId, &n)
+    : verifierGetDeps(vrf, symId, &n);
+  if (!ids) {
+    printf("The proof of %s was not checked\n", label);
+    return;
+  }
+  for (i = 0; i < n; i++) {
+    printf("%s\n", verifierGetSymName(vrf, ids[i]));
+  }
+  if (isReverse) {
+    struct symstring cone;
+    symstringInit(&cone);
+    verifierGetCone(vrf, symId, &cone);
+    printf("%lu theorems use %s, directly or not\n", cone.size, label);
+    symstringClean(&cone);
+  }
+}
+
+void
+halmosReportCandidates(struct halmos* h, struct verifier* vrf,
+  const char* label)
+{
+  size_t i;
+  (void) h;
+  printf("------candidates %s\n", label);
+  const size_t symId = verifierFindLabel(vrf, label);
+  if (symId == symbol_none_id
+    || (!verifierIsType(vrf, symId, symType_assertion)
+    && !verifierIsType(vrf, symId, symType_provable))) {
+    printf("%s is not a $a or $p statement\n", label);
+    return;
+  }
+  struct symstring found;
+  symstringInit(&found);
+  const struct symstring* stmt = &vrf->stmts.vals[vrf->symbols.vals[symId].stmt];
+  verifierFindConclusions(vrf, stmt, &found);
+  size_t count = 0;
+  for (i = 0; i < found.size; i++) {
+    if (found.vals[i] >= symId) { continue; }
+    printf("%s\n", verifierGetSymName(vrf, found.vals[i]));
+    count++;
+  }
+  printf("Found %lu candidates\n", count);
+  symstringClean(&found);
+}
+
+void
+halmosReportDuplicates(struct halmos* h, struct verifier* vrf)
+{
+  size_t i;
+  (void) h;
+  printf("------duplicates\n");
+  struct size_tArray found;
+  size_tArrayInit(&found, 16);
+  const size_t groupc = verifierFindDuplicates(vrf, &found);
+  int isFirst = 1;
+  for (i = 0; i < found.size; i++) {
+    if (found.vals[i] == symbol_none_id) {
+      printf("\n");
+      isFirst = 1;
+      continue;
+    }
+    printf(isFirst ? "%s" : " %s", verifierGetSymName(vrf, found.vals[i]));
+    isFirst = 0;
+  }
+  printf("Found %lu groups of %lu equivalent assertions\n", groupc,
+    found.size - groupc);
+  size_tArrayClean(&found);
+}
+
+void
+halmosMinimize(struct halmos* h, struct verifier* vrf, const char* label,
+  const char* suffix)
+{
+  size_t i, j;
+  printf("------minimize %s\n", label);
+  struct minimizer m;
+  minimizerInit(&m, vrf);
+  if (h->flags[halmosflag_threads]) {
+    minimizerSetThreads(&m,
+      strtoul(h->flagsArgv[halmosflag_threads][0], NULL, 10));
+  }
+  if (strcmp(label, "all") == 0) {
+    for (i = 0; i < vrf->symbols.size; i++) {
+      if (verifierIsType(vrf, i, symType_provable)) { minimizerAdd(&m, i); }
+    }
+  } else {
+    const size_t symId = verifierFindLabel(vrf, label);
+    if (symId == symbol_none_id
+      || !verifierIsType(vrf, symId, symType_provable)) {
+      printf("%s is not a $p statement\n", label);
+      minimizerClean(&m);
+      return;
+    }
+    minimizerAdd(&m, symId);
+  }
+  minimizerRun(&m);
+  printf("Searched %lu proofs in %lf sec\n", m.searched, m.timer.wall);
+  printf("Shortened %lu proofs from %lu to %lu steps, %lu steps fewer\n",
+    m.results.size, m.before, m.after, m.before - m.after);
+  if (m.rejected > 0) {
+    printf("The verifier rejected %lu shorter proofs\n", m.rejected);
+  }
+/* write each source file once, when its first shorter proof is found */
+  struct charArray out;
+  charArrayInit(&out, 256);
+  for (i = 0; i < m.results.size; i++) {
+    const size_t file = vrf->locs.vals[
+      vrf->symbols.vals[m.results.vals[i].thm].frame].file;
+    for (j = 0; j < i; j++) {
+      if (vrf->locs.vals[vrf->symbols.vals[m.results.vals[j].thm].frame].file
+        == file) { break; }
+    }
+    if (j < i) { continue; }
+    const char* name = vrf->files.vals[file].vals;
+    charArrayEmpty(&out);
+    charArrayAppend(&out, name, strlen(name));
+    charArrayAppend(&out, suffix, strlen(suffix) + 1);
+    if (file != file_none_id && minimizerWrite(&m, file, out.vals)) {
+      printf("Wrote the shorter proofs in %s to %s\n", name, out.vals);
+    } else {
+      printf("failed to write the shorter proofs in %s\n", name);
+    }
+  }
+  charArrayClean(&out);
+  minimizerClean(&m);
+}
+
+void
+halmosReportDiags(struct halmos* h, struct verifier* vrf, size_t limit)
+{
+  const int isUnique = h->flags[halmosflag_unique_errors];
+  verifierPrintDiags(vrf, stderr, limit, isUnique);
+  if (!h->flags[halmosflag_error_json]) { return; }
+  const char* filename = h->flagsArgv[halmosflag_error_json][0];
+  FILE* f = fopen(filename, "w");
+  if (!f) {
+    printf("failed to open %s\n", filename);
+    return;
+  }
+  verifierWriteDiagsJson(vrf, f, limit, isUnique);
+  fclose(f);
+}
+
+/* write str escaped for a quoted dot string */
+static void
+halmosWriteDotString(FILE* f, const char* str)
+{
+  for (; *str; str++) {
+    if (*str == '"' || *str == '\\') { fputc('\\', f); }
+    fputc(*str, f);
+  }
+}
+
+void
+halmosWriteIncludeGraph(struct halmos* h, const struct preproc* p,
+  const struct verifier* vrf, const char* filename)
+{
+  size_t i, j, k;
+  FILE* f = fopen(filename, "w");
+  if (!f) {
+    printf("failed to open %s\n", filename);
+    return;
+  }
+  (void) h;
+  fprintf(f, "digraph includes {\n  node [shape=box];\n");
+  for (i = 0; i < p->files.size; i++) {
+    const struct preprocFile* file = p->files.vals[i];
+/* files are known to the verifier by the name they were spliced by */
+    const char* name = file->splicedAs ? file->splicedAs : file->name.vals;
+    size_t stmts = 0;
+    double proofs = 0;
+    const size_t fileId = verifierGetFileId(vrf, name);
+    if (file->splicedAs && fileId != file_none_id) {
+      stmts = vrf->stats.vals[fileId].stmts;
+      proofs = vrf->stats.vals[fileId].proofs.wall;
+    }
+    const double preprocMs = 1000 * file->timer.wall;
+    fprintf(f, "  f%lu [label=\"", i);
+    halmosWriteDotString(f, name);
+    if (file->isFailed) {
+      fprintf(f, "\\nnot found\", style=dashed];\n");
+      continue;
+    }
+    fprintf(f, "\\n%lu bytes\\npreproc %.1f ms\\n%lu statements"
+      "\\nproofs %.1f ms\"", (size_t) file->size, preprocMs, stmts,
+      1000 * proofs);
+/* the same numbers, for tools reading the graph */
+    fprintf(f, ", bytes=%lu, preproc_ms=%.3f, stmts=%lu, proof_ms=%.3f];\n",
+      (size_t) file->size, preprocMs, stmts, 1000 * proofs);
+  }
+  for (i = 0; i < p->files.size; i++) {
+    const struct preprocEventArray* events = &p->files.vals[i]->events;
+    for (j = 0; j < events->size; j++) {
+      const struct preprocEvent* e = &events->vals[j];
+      if (e->type != preprocEventType_include) { continue; }
+/* a file included twice by the same file has one edge */
+      for (k = 0; k < j; k++) {
+        if (events->vals[k].type == preprocEventType_include
+          && events->vals[k].fileId == e->fileId) { break; }
+      }
+      if (k < j) { continue; }
+      fprintf(f, "  f%lu -> f%lu;\n", i, e->fileId);
+    }
+  }
+  fprintf(f, "}\n");
+  fclose(f);
+}
+
+/* read the number s into n. Returns 0 if s is empty or not only digits */
+static int
+halmosParseCount(const char* s, size_t* n)
+{
+  char* end;
+  if (*s < '0' || *s > '9') { return 0; }
+  errno = 0;
+  *n = strtoul(s, &end, 10);
+  return !errno && *end == '\0';
+}
+
 void
 halmosCompile(struct halmos* h, const char* filename)
 {
   size_t i;
   struct preproc p;
   struct verifier vrf;
-  double ptime = 0.0;
-  double vrftime = 0.0;
   verifierInit(&vrf);
   preprocInit(&p);
   if (h->flags[halmosflag_help]) {
@@ -73,9 +460,8 @@ halmosCompile(struct halmos* h, const char* filename)
     h->flags[halmosflag_no_verify] = 1;
   }
   if (h->flags[halmosflag_verbose]) {
-    errno = 0;
-    size_t verb = strtoul(h->flagsArgv[halmosflag_verbose][0], NULL, 10);
-    if (errno) {
+    size_t verb = 0;
+    if (!halmosParseCount(h->flagsArgv[halmosflag_verbose][0], &verb)) {
       printf("%s requires a positive integer\n", flags[halmosflag_verbose]);
       h->flags[halmosflag_no_preproc] = 1;
       h->flags[halmosflag_no_verify] = 1;
@@ -83,33 +469,118 @@ halmosCompile(struct halmos* h, const char* filename)
       verifierSetVerbosity(&vrf, verb);
     }
   }
+  size_t errorLimit = 0;
+  if (h->flags[halmosflag_error_limit]) {
+    if (!halmosParseCount(h->flagsArgv[halmosflag_error_limit][0],
+      &errorLimit)) {
+      printf("%s requires a positive integer\n",
+        flags[halmosflag_error_limit]);
+      h->flags[halmosflag_no_preproc] = 1;
+      h->flags[halmosflag_no_verify] = 1;
+    }
+  }
+  if (h->flags[halmosflag_threads]) {
+    size_t threads = 0;
+    if (!halmosParseCount(h->flagsArgv[halmosflag_threads][0], &threads)
+      || threads == 0) {
+      printf("%s requires a positive integer\n", flags[halmosflag_threads]);
+      h->flags[halmosflag_no_preproc] = 1;
+      h->flags[halmosflag_no_verify] = 1;
+    } else {
+      preprocSetThreads(&p, threads);
+    }
+  }
+  if (h->flags[halmosflag_preproc_cache]) {
+    preprocSetCache(&p, h->flagsArgv[halmosflag_preproc_cache][0]);
+  }
+  if (h->flags[halmosflag_summary]) {
+    h->flags[halmosflag_report_count] = 1;
+    h->flags[halmosflag_report_hash] = 1;
+    h->flags[halmosflag_report_time] = 1;
+    h->flags[halmosflag_report_memory] = 1;
+  }
+/* only pay for the timers if someone looks at them */
+  if (h->flags[halmosflag_report_time] || h->flags[halmosflag_metrics_json]) {
+    verifierSetTiming(&vrf, 1);
+  }
+  if (h->flags[halmosflag_perf_counters]) {
+    verifierSetCounting(&vrf, 1);
+  }
+  if (h->flags[halmosflag_include_graph]) {
+    verifierSetFileTiming(&vrf, 1);
+  }
+  if (h->flags[halmosflag_grammar_memo]) {
+    size_t apps = 0;
+    if (!halmosParseCount(h->flagsArgv[halmosflag_grammar_memo][0], &apps)) {
+      printf("%s requires a positive integer\n",
+        flags[halmosflag_grammar_memo]);
+      h->flags[halmosflag_no_preproc] = 1;
+      h->flags[halmosflag_no_verify] = 1;
+    } else {
+      h->flags[halmosflag_grammar] = 1;
+      verifierSetGrammar(&vrf, 1);
+      grammarSetApps(vrf.gram, apps);
+    }
+  }
+  if (h->flags[halmosflag_grammar]) {
+    verifierSetGrammar(&vrf, 1);
+  }
+  if (h->flags[halmosflag_only]) {
+    verifierSetOnly(&vrf, h->flagsArgv[halmosflag_only][0]);
+  }
+/* the minimizer reads the proofs again and runs them on trees */
+  if (h->flags[halmosflag_minimize]) {
+    h->flags[halmosflag_grammar] = 1;
+    h->flags[halmosflag_lazy] = 1;
+    verifierSetGrammar(&vrf, 1);
+  }
+  if (h->flags[halmosflag_lazy]) {
+    verifierSetLazy(&vrf, 1);
+  }
   if (!h->flags[halmosflag_no_preproc]) {
     printf("------preproc\n");
     printf("------%s\n", filename);
-    clock_t start = clock();
+    verifierBeginPhase(&vrf, phase_preprocess);
     preprocCompile(&p, filename, "out.mm");
-    clock_t end = clock();
-    ptime = ((double) end - start) / CLOCKS_PER_SEC;
+    verifierEndPhase(&vrf, phase_preprocess);
     /* don't verify if preproc failed */
     if (p.errCount > 0) {
       h->flags[halmosflag_no_verify] = 1;
     }
     printf("Found %lu errors\n", p.errCount);
+    if (h->flags[halmosflag_preproc_cache]) {
+      printf("Reused %lu of %lu files from the cache\n",
+        preprocCountCached(&p), p.files.size);
+    }
   }
 /* don't compile if preproc was specified */
   if (!h->flags[halmosflag_preproc] && !h->flags[halmosflag_no_verify]) {
     printf("------verifier\n");
-    clock_t start = clock();
+    struct timer t;
+    timerInit(&t);
+    timerStart(&t);
     verifierCompile(&vrf, "out.mm");
-    clock_t end = clock();
-    vrftime = ((double) end - start) / CLOCKS_PER_SEC;
+    if (h->flags[halmosflag_lazy]) {
+/* statements and frames can be queried from here on */
+      timerStop(&t);
+      printf("Read the database in %lf sec\n", t.wall);
+      timerInit(&t);
+      timerStart(&t);
+      verifierBeginChecking(&vrf);
+      verifierEndChecking(&vrf, 1);
+      timerStop(&t);
+      printf("Checked the proofs in %lf sec more, %lu failed\n", t.wall,
+        verifierCountProofs(&vrf, proofState_failed));
+    }
+    if (h->flags[halmosflag_only]) {
+      printf("Checked %lu of %lu proofs\n", vrf.proofc,
+        vrf.symCount[symType_provable]);
+    }
+    halmosReportDiags(h, &vrf, errorLimit);
     printf("Found %lu errors\n", vrf.errc);
   }
   if (h->flags[halmosflag_summary]) {
     printf("------summary\n");
-    h->flags[halmosflag_report_count] = 1;
-    h->flags[halmosflag_report_hash] = 1;
-    h->flags[halmosflag_report_time] = 1;
   }
   if (h->flags[halmosflag_report_count]) {
     printf("------symbol count\n");
@@ -119,10 +590,63 @@ halmosCompile(struct halmos* h, const char* filename)
   }
   if (h->flags[halmosflag_report_hash]) {
     printf("------hash collision count\nFound %lu collisions\n", vrf.hashc);
+    printf("Token cache found %lu of %lu symbols\n", vrf.cache.hits,
+      vrf.cache.lookups);
+  }
+  if (h->flags[halmosflag_grammar]) {
+    const struct grammar* g = vrf.gram;
+    printf("------grammar\n");
+    printf("Parsed %lu of %lu statements into %lu nodes\n", g->parsed,
+      g->stmtCount, g->nodes.size - 1);
+    printf("Checked %lu proofs on syntax trees in %lf sec and skipped %lu\n",
+      g->checked, g->timer.wall, g->skipped);
+    if (g->apps.size > 0) {
+      printf("Found %lu of %lu assertion applications in the memo of %lu\n",
+        g->appHits, g->appLookups, g->apps.size);
+    }
+    printf("Found %lu disagreements with the string check\n", g->mismatches);
+  }
+  if (h->flags[halmosflag_deps]) {
+    halmosReportDeps(h, &vrf, h->flagsArgv[halmosflag_deps][0], 0);
+  }
+  if (h->flags[halmosflag_candidates]) {
+    halmosReportCandidates(h, &vrf, h->flagsArgv[halmosflag_candidates][0]);
+  }
+  if (h->flags[halmosflag_find_duplicates]) {
+    halmosReportDuplicates(h, &vrf);
+  }
+  if (h->flags[halmosflag_rdeps]) {
+    halmosReportDeps(h, &vrf, h->flagsArgv[halmosflag_rdeps][0], 1);
+  }
+  if (h->flags[halmosflag_minimize] && !h->flags[halmosflag_no_verify]
+    && !h->flags[halmosflag_preproc]) {
+    const char* suffix = ".min";
+    if (h->flags[halmosflag_minimize_suffix]) {
+      suffix = h->flagsArgv[halmosflag_minimize_suffix][0];
+    }
+    halmosMinimize(h, &vrf, h->flagsArgv[halmosflag_minimize][0], suffix);
   }
   if (h->flags[halmosflag_report_time]) {
-    printf("------processing time\npreprocessing: %lf sec\n"
-      "verification: %lf sec\n", ptime, vrftime);
+    printf("------processing time (wall / cpu)\n");
+    for (i = 0; i < phase_size; i++) {
+      const struct timer* t = &vrf.timers[i];
+      printf("%s: %lf / %lf sec (%lu)\n", phaseString(i), t->wall, t->cpu,
+        t->count);
+    }
+  }
+  if (h->flags[halmosflag_report_memory]) {
+    halmosReportMemory(h);
+  }
+  if (h->flags[halmosflag_perf_counters]) {
+    halmosReportCounters(h, &vrf);
+  }
+  if (h->flags[halmosflag_metrics_json]) {
+    halmosWriteMetrics(h, &vrf, h->flagsArgv[halmosflag_metrics_json][0]);
+  }
+  if (h->flags[halmosflag_include_graph]
+    && !h->flags[halmosflag_no_preproc]) {
+    halmosWriteIncludeGraph(h, &p, &vrf,
+      h->flagsArgv[halmosflag_include_graph][0]);
   }
   preprocClean(&p);
   verifierClean(&vrf);
@@ -1,5 +1,6 @@
 #ifndef _HALMOSHALMOS_H_
 #define _HALMOSHALMOS_H_
+#include <stddef.h>
 
 enum halmosflag {
   halmosflag_none = 0,
@@ -12,10 +13,32 @@ enum halmosflag {
   halmosflag_report_hash, /* report count of hash collisions */
   halmosflag_report_time, /* report the processing time spent */
   halmosflag_help, /* show help message */
+  halmosflag_metrics_json, /* write timers and counters as json */
+  halmosflag_report_memory, /* report heap use by tag */
+  halmosflag_perf_counters, /* count hardware events for each phase */
+  halmosflag_threads, /* the number of threads to use */
+  halmosflag_preproc_cache, /* reuse scanned files from a directory */
+  halmosflag_include_graph, /* write the include graph as dot */
+  halmosflag_grammar, /* check proofs on syntax trees too */
+  halmosflag_only, /* check only the proofs some theorems need */
+  halmosflag_lazy, /* read first, then check proofs in the background */
+  halmosflag_deps, /* list the assertions a proof applies */
+  halmosflag_rdeps, /* list the proofs applying an assertion */
+  halmosflag_error_limit, /* print only the first diagnostics */
+  halmosflag_error_json, /* write the diagnostics as json */
+  halmosflag_unique_errors, /* drop repeated diagnostics */
+  halmosflag_grammar_memo, /* remember assertion applications on trees */
+  halmosflag_candidates, /* list the assertions which could prove one */
+  halmosflag_minimize, /* shorten proofs with earlier assertions */
+  halmosflag_find_duplicates, /* list assertions equal up to renaming */
+  halmosflag_minimize_suffix, /* name the files written by minimize */
   // halmosflag_include,
   halmosflag_size
 };
 
+struct preproc;
+struct verifier;
+
 struct halmos {
   char flags[halmosflag_size];
   char** flagsArgv[halmosflag_size];
@@ -27,6 +50,52 @@ halmosInit(struct halmos* h);
 void
 halmosClean(struct halmos* h);
 
+void
+halmosWriteMetrics(struct halmos* h, const struct verifier* vrf,
+  const char* filename);
+
+void
+halmosReportMemory(struct halmos* h);
+
+void
+halmosReportCounters(struct halmos* h, const struct verifier* vrf);
+
+/* write the files of the include tree and the includes between them as a */
+/* graphviz digraph, with the size, preprocessing time, statement count, */
+/* and proof time of each file */
+void
+halmosWriteIncludeGraph(struct halmos* h, const struct preproc* p,
+  const struct verifier* vrf, const char* filename);
+
+/* print the assertions applied by the proof of label, or if isReverse, */
+/* the proofs applying label and the size of its reverse-dependency cone */
+void
+halmosReportDeps(struct halmos* h, struct verifier* vrf, const char* label,
+  int isReverse);
+
+/* print the $a and $p statements before label whose statements could be */
+/* unified with the statement of label */
+void
+halmosReportCandidates(struct halmos* h, struct verifier* vrf,
+  const char* label);
+
+/* print the groups of $a and $p statements which are the same up to */
+/* renaming their variables */
+void
+halmosReportDuplicates(struct halmos* h, struct verifier* vrf);
+
+/* shorten the proof of label, or of every $p statement if label is all, */
+/* and print the steps saved. Each source file with shorter proofs is */
+/* written with them to its name followed by suffix */
+void
+halmosMinimize(struct halmos* h, struct verifier* vrf, const char* label,
+  const char* suffix);
+
+/* print the diagnostics of the verifier, sorted by where they were found, */
+/* and write them as json if asked */
+void
+halmosReportDiags(struct halmos* h, struct verifier* vrf, size_t limit);
+
 void
 halmosCompile(struct halmos* h, const char* filename);
 
@@ -1,5 +1,20 @@
 #include "hash.h"
 
+/* read little-endian words byte by byte, so keys need not be aligned. */
+/* Compilers turn these into single loads on little-endian machines */
+static uint32_t
+hashRead32(const uint8_t* p)
+{
+  return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16)
+    | ((uint32_t) p[3] << 24);
+}
+
+static uint64_t
+hashRead64(const uint8_t* p)
+{
+  return (uint64_t) hashRead32(p) | ((uint64_t) hashRead32(p + 4) << 32);
+}
+
 uint32_t hash_djb2(const char* str, size_t len, uint32_t seed)
 {
   (void) len;
@@ -22,10 +37,10 @@ uint32_t hash_murmur3(const char* str, size_t len, uint32_t seed)
   uint32_t n = 0xe6546b64;
   uint32_t h = seed;
   size_t block_size = len / 4;
-  const uint32_t* blocks = (uint32_t*) str;
+  const uint8_t* blocks = (const uint8_t*) str;
   size_t i;
   for (i = 0; i < block_size; i++) {
-    uint32_t k = blocks[i];
+    uint32_t k = hashRead32(blocks + 4 * i);
     k *= c1;
 /* rotate left by r1 */
     k = (k << r1) | (k >> (32 - r1));
@@ -34,18 +49,20 @@ uint32_t hash_murmur3(const char* str, size_t len, uint32_t seed)
     h = (h << r2) | (h >> (32 - r2));
     h = h * m + n;
   }
-  const uint8_t* tail = (uint8_t*)&blocks[block_size];
+  const uint8_t* tail = blocks + 4 * block_size;
   uint32_t k1 = 0;
   switch (len & 3) {
   case 3:
-    k1 ^= tail[2] << 16;
+    k1 ^= (uint32_t) tail[2] << 16;
+    /* fall through */
   case 2:
-    k1 ^= tail[1] << 8;
+    k1 ^= (uint32_t) tail[1] << 8;
+    /* fall through */
   case 1:
     k1 ^= tail[0];
-    k1 += c1;
+    k1 *= c1;
     k1 = (k1 << r1) | (k1 >> (32 - r1));
-    k1 += c2;
+    k1 *= c2;
     h ^= k1;
   }
   h ^= len;
@@ -56,3 +73,63 @@ uint32_t hash_murmur3(const char* str, size_t len, uint32_t seed)
   h ^= (h >> 16);
   return h;
 }
+
+static const uint64_t wy0 = 0xa0761d6478bd642full;
+static const uint64_t wy1 = 0xe7037ed1a0b428dbull;
+static const uint64_t wy2 = 0x8ebc6af09c88c6e3ull;
+
+/* multiply to 128 bits and fold the halves together */
+static uint64_t
+hashMum(uint64_t a, uint64_t b)
+{
+#ifdef __SIZEOF_INT128__
+  __extension__ unsigned __int128 r = (unsigned __int128) a * b;
+  return (uint64_t) r ^ (uint64_t) (r >> 64);
+#else
+  uint64_t ha = a >> 32, la = (uint32_t) a, hb = b >> 32, lb = (uint32_t) b;
+  uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+  uint64_t t = rl + (rm0 << 32);
+  uint64_t c = t < rl;
+  uint64_t lo = t + (rm1 << 32);
+  c += lo < t;
+  uint64_t hi = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+  return lo ^ hi;
+#endif
+}
+
+uint64_t hash_wy64(const char* str, size_t len, uint64_t seed)
+{
+  const uint8_t* p = (const uint8_t*) str;
+  const size_t total = len;
+  uint64_t h = seed ^ hashMum(seed ^ wy0, wy1);
+  uint64_t a, b;
+  while (len > 16) {
+    h = hashMum(hashRead64(p) ^ wy1, hashRead64(p + 8) ^ h);
+    p += 16;
+    len -= 16;
+  }
+/* the last 1 to 16 bytes, read as two possibly overlapping words */
+  if (len >= 8) {
+    a = hashRead64(p);
+    b = hashRead64(p + len - 8);
+  } else if (len >= 4) {
+    a = hashRead32(p);
+    b = hashRead32(p + len - 4);
+  } else if (len > 0) {
+    a = ((uint64_t) p[0] << 16) | ((uint64_t) p[len >> 1] << 8) | p[len - 1];
+    b = 0;
+  } else {
+    a = 0;
+    b = 0;
+  }
+  return hashMum(wy2 ^ total, hashMum(a ^ wy1, b ^ h));
+}
+
+hash_t hashString(const char* str, size_t len)
+{
+#ifdef HASH_64
+  return hash_wy64(str, len, 0);
+#else
+  return hash_murmur3(str, len, 0);
+#endif
+}
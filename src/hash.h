@@ -4,10 +4,25 @@
 #include <stddef.h>
 #include <stdint.h>
 
+/* the hash of symbol names. Build with -DHASH_64 to use a 64-bit hash, */
+/* which makes collisions in large databases practically impossible */
+#ifdef HASH_64
+typedef uint64_t hash_t;
+#else
+typedef uint32_t hash_t;
+#endif
+
 typedef uint32_t (*hashfunction)(const char*, size_t, uint32_t);
 
 uint32_t hash_djb2(const char*, size_t, uint32_t);
 
 uint32_t hash_murmur3(const char*, size_t, uint32_t);
 
+/* a 64-bit hash in the style of wyhash. It reads up to 16 bytes per */
+/* multiply, so it is faster than murmur3 on long names */
+uint64_t hash_wy64(const char*, size_t, uint64_t);
+
+/* the hash used for the symbol tables, hash_murmur3 or hash_wy64 */
+hash_t hashString(const char* str, size_t len);
+
 #endif
@@ -1,22 +1,203 @@
 #include "dbg.h"
 #include "memory.h"
+#include <pthread.h>
 #include <stdlib.h>
+
+static const char* memtagStrings[memtag_size] = {
+  "none",
+  "symtab",
+  "statement",
+  "stack",
+  "substitution",
+  "reader",
+  "frame",
+  "arena",
+  "grammar",
+  "diag",
+  "minimizer"
+};
+
+static struct memstat memstats[memtag_size];
+/* each thread has its own tag */
+static __thread enum memtag memtag_current = memtag_none;
+/* while other threads run, the counters are updated under the lock */
+static size_t memory_threads = 0;
+static pthread_mutex_t memory_lock = PTHREAD_MUTEX_INITIALIZER;
+static void
+memoryLock(void)
+{
+  if (memory_threads) { pthread_mutex_lock(&memory_lock); }
+}
+
+static void
+memoryUnlock(void)
+{
+  if (memory_threads) { pthread_mutex_unlock(&memory_lock); }
+}
+
+#ifdef MEMORY_STATS
+static size_t memory_live = 0;
+static size_t memory_peak = 0;
+
+/* prepended to every block so we know its size and tag when it is freed. */
+/* The union keeps the returned pointer aligned. */
+union memheader {
+  struct {
+    size_t size;
+    size_t tag;
+  } h;
+  double d;
+  void* p;
+};
+
+static void
+memoryAddLive(enum memtag tag, size_t size)
+{
+  struct memstat* s = &memstats[tag];
+  s->live += size;
+  if (s->live > s->peak) { s->peak = s->live; }
+  memory_live += size;
+  if (memory_live > memory_peak) { memory_peak = memory_live; }
+}
+
+static void
+memorySubLive(enum memtag tag, size_t size)
+{
+  memstats[tag].live -= size;
+  memory_live -= size;
+}
+#endif
+
+const char*
+memtagString(enum memtag tag)
+{
+  return memtagStrings[tag];
+}
+
+enum memtag
+memorySetTag(enum memtag tag)
+{
+  enum memtag old = memtag_current;
+  memtag_current = tag;
+  return old;
+}
+
 void*
 xmalloc(size_t size) {
+#ifdef MEMORY_STATS
+  union memheader* m = malloc(sizeof(union memheader) + size);
+  if (!m) {
+    LOG_FAT("malloc failed");
+    abort();
+  }
+  m->h.size = size;
+  m->h.tag = memtag_current;
+  memoryLock();
+  memoryAddLive(memtag_current, size);
+  void* p = m + 1;
+#else
   void* p = malloc(size);
   if (!p) {
     LOG_FAT("malloc failed");
     abort();
   }
+  memoryLock();
+#endif
+  memstats[memtag_current].mallocs++;
+  memstats[memtag_current].bytes += size;
+  memoryUnlock();
   return p;
 }
 
 void*
 xrealloc(void* p, size_t size) {
+#ifdef MEMORY_STATS
+  if (!p) { return xmalloc(size); }
+  union memheader* m = (union memheader*) p - 1;
+  const size_t old = m->h.size;
+  const enum memtag tag = m->h.tag;
+  union memheader* n = realloc(m, sizeof(union memheader) + size);
+  if (!n) {
+    LOG_FAT("realloc failed");
+    abort();
+  }
+  n->h.size = size;
+  memoryLock();
+  memorySubLive(tag, old);
+  memoryAddLive(tag, size);
+  if (n != m) {
+    memstats[tag].copies++;
+    memstats[tag].copyBytes += (old < size) ? old : size;
+  }
+  void* q = n + 1;
+#else
+  const enum memtag tag = memtag_current;
   void* q = realloc(p, size);
   if (!q) {
     LOG_FAT("realloc failed");
     abort();
   }
+  memoryLock();
+/* comparing the pointers is fine: we don't dereference p */
+  if (p && q != p) { memstats[tag].copies++; }
+#endif
+  memstats[tag].reallocs++;
+  memstats[tag].bytes += size;
+  memoryUnlock();
   return q;
 }
+
+void
+xfree(void* p)
+{
+#ifdef MEMORY_STATS
+  if (!p) { return; }
+  union memheader* m = (union memheader*) p - 1;
+  memoryLock();
+  memstats[m->h.tag].frees++;
+  memorySubLive(m->h.tag, m->h.size);
+  memoryUnlock();
+  free(m);
+#else
+  free(p);
+#endif
+}
+
+void
+memoryBeginThreads(void)
+{
+  memory_threads++;
+}
+
+void
+memoryEndThreads(void)
+{
+  DEBUG_ASSERT(memory_threads > 0, "memoryEndThreads without Begin");
+  memory_threads--;
+}
+
+void
+memoryGetStats(struct memstat* stat, enum memtag tag)
+{
+  *stat = memstats[tag];
+}
+
+void
+memoryGetTotal(struct memstat* stat)
+{
+  size_t i;
+  memset(stat, 0, sizeof(*stat));
+  for (i = 0; i < memtag_size; i++) {
+    const struct memstat* s = &memstats[i];
+    stat->mallocs += s->mallocs;
+    stat->reallocs += s->reallocs;
+    stat->bytes += s->bytes;
+    stat->copies += s->copies;
+    stat->frees += s->frees;
+    stat->copyBytes += s->copyBytes;
+    stat->live += s->live;
+  }
+#ifdef MEMORY_STATS
+  stat->peak = memory_peak;
+#endif
+}
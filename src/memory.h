@@ -1,6 +1,64 @@
 #ifndef _HALMOSMEMORY_H_
 #define _HALMOSMEMORY_H_
 #include <stddef.h>
+
+/* what the memory is used for. Allocations are attributed to the tag set */
+/* by the most recent memorySetTag() */
+enum memtag {
+  memtag_none,
+  memtag_symtab,
+  memtag_statement,
+  memtag_stack,
+  memtag_substitution,
+  memtag_reader,
+  memtag_frame,
+  memtag_arena,
+  memtag_grammar,
+  memtag_diag,
+  memtag_minimizer,
+  memtag_size
+};
+
+const char* memtagString(enum memtag tag);
+
+/* counters for heap use through xmalloc, xrealloc and xfree */
+struct memstat {
+  size_t mallocs;
+  size_t reallocs;
+/* total bytes requested */
+  size_t bytes;
+/* reallocations that moved the block */
+  size_t copies;
+/* the following are only counted when compiled with MEMORY_STATS, since */
+/* they need the size of each block */
+  size_t frees;
+  size_t copyBytes;
+  size_t live;
+  size_t peak;
+};
+
 void* xmalloc(size_t size);
 void* xrealloc(void* p, size_t size);
+/* memory from xmalloc and xrealloc must be released with this */
+void xfree(void* p);
+
+/* set the tag for subsequent allocations of the calling thread and return */
+/* the previous tag */
+enum memtag
+memorySetTag(enum memtag tag);
+
+/* call before starting threads that allocate, and after joining them, so */
+/* the counters are kept under a lock in between */
+void
+memoryBeginThreads(void);
+
+void
+memoryEndThreads(void);
+
+void
+memoryGetStats(struct memstat* stat, enum memtag tag);
+
+/* the sum over all tags. peak is the peak of the total */
+void
+memoryGetTotal(struct memstat* stat);
 #endif
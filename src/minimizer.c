@@ -0,0 +1,1103 @@
+#include "hash.h"
+#include "memory.h"
+#include "minimizer.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+DEFINE_ARRAY(minimizerStep)
+DEFINE_ARRAY(minimizerJob)
+DEFINE_ARRAY(minimizerResult)
+
+enum { minimizer_max_threads = 8 };
+/* the number of proofs read and searched at a time */
+static const size_t minimizer_batch_size = 256;
+static const size_t minimizer_table_size = 256;
+/* the steps matched with the hypotheses of an assertion before it is */
+/* given up */
+static const size_t minimizer_max_matches = 4096;
+/* compressed proofs are broken into lines of this many characters */
+static const size_t minimizer_line_size = 72;
+static const size_t minimizer_none_id = (size_t) -1;
+
+void
+minimizerInit(struct minimizer* m, struct verifier* vrf)
+{
+  m->vrf = vrf;
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  m->threads = (cpus > 0) ? (size_t) cpus : 1;
+  if (m->threads > minimizer_max_threads) {
+    m->threads = minimizer_max_threads;
+  }
+  enum memtag tag = memorySetTag(memtag_minimizer);
+  size_tArrayInit(&m->thms, 16);
+  trieInit(&m->index);
+  minimizerJobArrayInit(&m->jobs, 1);
+  minimizerResultArrayInit(&m->results, 16);
+  charArrayInit(&m->text, 1024);
+  symstringInit(&m->labels);
+  memorySetTag(tag);
+  m->next = 0;
+  pthread_mutex_init(&m->lock, NULL);
+  m->searched = 0;
+  m->rejected = 0;
+  m->before = 0;
+  m->after = 0;
+  timerInit(&m->timer);
+}
+
+void
+minimizerClean(struct minimizer* m)
+{
+  symstringClean(&m->labels);
+  charArrayClean(&m->text);
+  minimizerResultArrayClean(&m->results);
+  minimizerJobArrayClean(&m->jobs);
+  trieClean(&m->index);
+  size_tArrayClean(&m->thms);
+  pthread_mutex_destroy(&m->lock);
+}
+
+void
+minimizerSetThreads(struct minimizer* m, size_t threads)
+{
+  m->threads = (threads > 0) ? threads : 1;
+  if (m->threads > minimizer_max_threads) {
+    m->threads = minimizer_max_threads;
+  }
+}
+
+void
+minimizerAdd(struct minimizer* m, size_t symId)
+{
+  enum memtag tag = memorySetTag(memtag_minimizer);
+  size_tArrayAdd(&m->thms, symId);
+  memorySetTag(tag);
+}
+
+static void
+minimizerWorkerInit(struct minimizerWorker* w, struct minimizer* m)
+{
+  w->m = m;
+  minimizerStepArrayInit(&w->steps, 256);
+  size_tArrayInit(&w->kids, 256);
+  size_tArrayInit(&w->table, minimizer_table_size);
+  size_tArrayInit(&w->floats, 16);
+  size_tArrayInit(&w->stack, 64);
+  size_tArrayInit(&w->tags, 16);
+  size_tArrayInit(&w->subVars, 16);
+  size_tArrayInit(&w->subTrees, 16);
+  size_tArrayInit(&w->hyps, 16);
+  size_tArrayInit(&w->args, 16);
+  size_tArrayInit(&w->dv1, 16);
+  size_tArrayInit(&w->dv2, 16);
+  size_tArrayInit(&w->buf, 64);
+  size_tArrayInit(&w->marks, 256);
+  size_tArrayInit(&w->refs, 256);
+  size_tArrayInit(&w->tagIds, 256);
+  w->stamp = 0;
+  w->tagCount = 0;
+  w->matches = 0;
+  symstringInit(&w->str);
+  size_tArrayInit(&w->ends, 64);
+  size_tArrayInit(&w->found, 64);
+}
+
+static void
+minimizerWorkerClean(struct minimizerWorker* w)
+{
+  size_tArrayClean(&w->found);
+  size_tArrayClean(&w->ends);
+  symstringClean(&w->str);
+  size_tArrayClean(&w->tagIds);
+  size_tArrayClean(&w->refs);
+  size_tArrayClean(&w->marks);
+  size_tArrayClean(&w->buf);
+  size_tArrayClean(&w->dv2);
+  size_tArrayClean(&w->dv1);
+  size_tArrayClean(&w->args);
+  size_tArrayClean(&w->hyps);
+  size_tArrayClean(&w->subTrees);
+  size_tArrayClean(&w->subVars);
+  size_tArrayClean(&w->tags);
+  size_tArrayClean(&w->stack);
+  size_tArrayClean(&w->floats);
+  size_tArrayClean(&w->table);
+  size_tArrayClean(&w->kids);
+  minimizerStepArrayClean(&w->steps);
+}
+
+/* the tree of the statement of symId, or grammar_none_id */
+static size_t
+minimizerGetTree(const struct verifier* vrf, size_t symId)
+{
+  const struct grammar* g = vrf->gram;
+  const size_t stmt = vrf->symbols.vals[symId].stmt;
+  return (stmt < g->stmtTrees.size) ? g->stmtTrees.vals[stmt]
+    : grammar_none_id;
+}
+
+static int
+minimizerIsHypothesis(const struct verifier* vrf, size_t symId)
+{
+  return verifierIsType(vrf, symId, symType_floating)
+    || verifierIsType(vrf, symId, symType_essential);
+}
+
+/* statements of the type code of a $f statement are proved by syntax */
+/* axioms, so there is nothing to shorten */
+static int
+minimizerIsSyntax(const struct verifier* vrf, size_t code)
+{
+  const struct grammar* g = vrf->gram;
+  return code < g->symTypes.size && g->symTypes.vals[code] != 0
+    && !verifierIsType(vrf, code, symType_variable);
+}
+
+static size_t
+minimizerHashStatement(size_t code, size_t body)
+{
+  const size_t key[2] = {code, body};
+  return (size_t) hash_wy64((const char*) key, sizeof(key), 0);
+}
+
+/* the slot of the step proving the statement, or the empty slot where it */
+/* would go */
+static size_t
+minimizerFindSlot(const struct minimizerWorker* w, size_t code, size_t body)
+{
+  const size_t mask = w->table.size - 1;
+  size_t i = minimizerHashStatement(code, body) & mask;
+  while (w->table.vals[i]) {
+    const struct minimizerStep* s = &w->steps.vals[w->table.vals[i] - 1];
+    if (s->code == code && s->body == body) { break; }
+    i = (i + 1) & mask;
+  }
+  return i;
+}
+
+/* the first step proving the statement, or minimizer_none_id */
+static size_t
+minimizerFindStep(const struct minimizerWorker* w, size_t code, size_t body)
+{
+  const size_t slot = w->table.vals[minimizerFindSlot(w, code, body)];
+  return slot ? slot - 1 : minimizer_none_id;
+}
+
+static void
+minimizerEmptyTable(struct minimizerWorker* w, size_t size)
+{
+  size_t i;
+  size_tArrayResize(&w->table, size);
+  for (i = 0; i < size; i++) {
+    w->table.vals[i] = 0;
+  }
+  w->table.size = size;
+}
+
+/* add a step, and index it if it is the first to prove its statement */
+static size_t
+minimizerAddStep(struct minimizerWorker* w, size_t label, size_t code,
+  size_t body, size_t first, size_t argc)
+{
+  size_t i;
+  struct minimizerStep s;
+  s.label = label;
+  s.code = code;
+  s.body = body;
+  s.first = first;
+  s.argc = argc;
+  minimizerStepArrayAdd(&w->steps, s);
+  const size_t id = w->steps.size - 1;
+  if (2 * w->steps.size > w->table.size) {
+/* double the table and put the steps back, the first of each statement */
+    minimizerEmptyTable(w, 2 * w->table.size);
+    for (i = 0; i < w->steps.size; i++) {
+      const struct minimizerStep* t = &w->steps.vals[i];
+      const size_t slot = minimizerFindSlot(w, t->code, t->body);
+      if (!w->table.vals[slot]) { w->table.vals[slot] = i + 1; }
+    }
+    return id;
+  }
+  const size_t slot = minimizerFindSlot(w, code, body);
+  if (!w->table.vals[slot]) { w->table.vals[slot] = id + 1; }
+  return id;
+}
+
+/* the step of the hypothesis, remembering the variables of $f statements */
+static size_t
+minimizerAddHypothesis(struct minimizerWorker* w, size_t hyp)
+{
+  const struct verifier* vrf = w->m->vrf;
+  const struct grammar* g = vrf->gram;
+  const size_t tree = minimizerGetTree(vrf, hyp);
+  if (tree == grammar_none_id) { return minimizer_none_id; }
+  const struct grammarNode* n = &g->nodes.vals[tree];
+  const size_t code = n->rule;
+  const size_t body = g->args.vals[n->first];
+  const size_t id = minimizerFindStep(w, code, body);
+  if (id != minimizer_none_id) { return id; }
+  if (verifierIsType(vrf, hyp, symType_floating)) {
+    size_tArrayAdd(&w->floats, g->nodes.vals[body].rule);
+    size_tArrayAdd(&w->floats, hyp);
+  }
+  return minimizerAddStep(w, hyp, code, body, w->kids.size, 0);
+}
+
+/* build the graph of the proof of the job. A step proving a statement */
+/* proved before is replaced by the earlier step, so the edges go to */
+/* earlier steps. Returns the last step, or minimizer_none_id */
+static size_t
+minimizerBuild(struct minimizerWorker* w, const struct minimizerJob* job)
+{
+  size_t i;
+  const struct verifier* vrf = w->m->vrf;
+  const struct grammar* g = vrf->gram;
+  const struct frame* ctx =
+    &vrf->frames.vals[vrf->symbols.vals[job->thm].frame];
+  const struct proofStepArray* steps = &job->prf.steps;
+  w->steps.size = 0;
+  w->kids.size = 0;
+  w->floats.size = 0;
+  w->stack.size = 0;
+  w->tags.size = 0;
+  minimizerEmptyTable(w, minimizer_table_size);
+/* the hypotheses come first, so that any step may use them */
+  for (i = 0; i < ctx->stmts.size; i++) {
+    if (minimizerAddHypothesis(w, ctx->stmts.vals[i]) == minimizer_none_id) {
+      return minimizer_none_id;
+    }
+  }
+  for (i = 0; i < steps->size; i++) {
+    const struct proofStep* step = &steps->vals[i];
+    size_t id;
+    if (step->isTagRef) {
+      id = w->tags.vals[step->id];
+    } else if (minimizerIsHypothesis(vrf, step->id)) {
+      id = minimizerAddHypothesis(w, step->id);
+      if (id == minimizer_none_id) { return minimizer_none_id; }
+    } else {
+      const struct symbol* sym = &vrf->symbols.vals[step->id];
+      const size_t argc = vrf->frames.vals[sym->frame].stmts.size;
+      const size_t base = w->stack.size - argc;
+      const struct grammarNode* n = &g->nodes.vals[job->trees.vals[i]];
+      const size_t body = g->args.vals[n->first];
+      id = minimizerFindStep(w, n->rule, body);
+      if (id == minimizer_none_id) {
+        const size_t first = w->kids.size;
+        size_tArrayAppend(&w->kids, w->stack.vals + base, argc);
+        id = minimizerAddStep(w, step->id, n->rule, body, first, argc);
+      }
+      w->stack.size = base;
+    }
+    size_tArrayAdd(&w->stack, id);
+    if (step->isTagged) { size_tArrayAdd(&w->tags, id); }
+  }
+  return (w->stack.size == 1) ? w->stack.vals[0] : minimizer_none_id;
+}
+
+static size_t
+minimizerCountFrom(struct minimizerWorker* w, size_t id)
+{
+  size_t i;
+  const struct minimizerStep* s = &w->steps.vals[id];
+  if (s->argc == 0 && minimizerIsHypothesis(w->m->vrf, s->label)) {
+    return 1;
+  }
+  if (w->marks.vals[id] == w->stamp + 1) {
+    w->refs.vals[id]++;
+    return 1;
+  }
+/* a step which needs itself */
+  if (w->marks.vals[id] == w->stamp) { return minimizer_none_id; }
+  w->marks.vals[id] = w->stamp;
+  w->refs.vals[id] = 1;
+  size_t count = 1;
+  for (i = 0; i < s->argc; i++) {
+    const size_t n = minimizerCountFrom(w, w->kids.vals[s->first + i]);
+    if (n == minimizer_none_id) { return minimizer_none_id; }
+    count += n;
+  }
+  w->marks.vals[id] = w->stamp + 1;
+  return count;
+}
+
+/* the number of steps of the proof from root, written with the steps */
+/* used again referred to by tag, or minimizer_none_id if it has a cycle. */
+/* The steps reached are marked with stamp + 1 */
+static size_t
+minimizerCount(struct minimizerWorker* w, size_t root)
+{
+  while (w->marks.size < w->steps.size) {
+    size_tArrayAdd(&w->marks, 0);
+    size_tArrayAdd(&w->refs, 0);
+    size_tArrayAdd(&w->tagIds, 0);
+  }
+  w->stamp += 2;
+  return minimizerCountFrom(w, root);
+}
+
+/* write the steps of the proof from id, after it was counted */
+static void
+minimizerEmit(struct minimizerWorker* w, size_t id,
+  struct proofStepArray* steps)
+{
+  size_t i;
+  const struct minimizerStep* s = &w->steps.vals[id];
+  struct proofStep step;
+  step.id = s->label;
+  step.isTagRef = 0;
+  step.isTagged = 0;
+  step.line = 0;
+  step.offset = 0;
+  if (s->argc == 0 && minimizerIsHypothesis(w->m->vrf, s->label)) {
+    proofStepArrayAdd(steps, step);
+    return;
+  }
+  if (w->marks.vals[id] == w->stamp + 1) {
+    step.id = w->tagIds.vals[id];
+    step.isTagRef = 1;
+    proofStepArrayAdd(steps, step);
+    return;
+  }
+  for (i = 0; i < s->argc; i++) {
+    minimizerEmit(w, w->kids.vals[s->first + i], steps);
+  }
+  if (w->refs.vals[id] > 1) {
+    step.isTagged = 1;
+    w->tagIds.vals[id] = w->tagCount++;
+  }
+  w->marks.vals[id] = w->stamp + 1;
+  proofStepArrayAdd(steps, step);
+}
+
+/* match the tree pat of an assertion with the tree node, adding to the */
+/* substitution */
+static int
+minimizerMatch(struct minimizerWorker* w, size_t pat, size_t node)
+{
+  size_t i;
+  const struct verifier* vrf = w->m->vrf;
+  const struct grammar* g = vrf->gram;
+  const struct grammarNode* p = &g->nodes.vals[pat];
+  if (p->argc == 0 && verifierIsType(vrf, p->rule, symType_variable)) {
+    for (i = 0; i < w->subVars.size; i++) {
+      if (w->subVars.vals[i] == p->rule) {
+        return w->subTrees.vals[i] == node;
+      }
+    }
+    if (grammarGetTypeCode(g, vrf, pat) != grammarGetTypeCode(g, vrf, node)) {
+      return 0;
+    }
+    size_tArrayAdd(&w->subVars, p->rule);
+    size_tArrayAdd(&w->subTrees, node);
+    return 1;
+  }
+  const struct grammarNode* n = &g->nodes.vals[node];
+  if (p->rule != n->rule || p->argc != n->argc) { return 0; }
+  for (i = 0; i < p->argc; i++) {
+    if (!minimizerMatch(w, g->args.vals[p->first + i],
+      g->args.vals[n->first + i])) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/* whether the variables of the tree pat are all substituted */
+static int
+minimizerIsBound(const struct minimizerWorker* w, size_t pat)
+{
+  size_t i;
+  const struct verifier* vrf = w->m->vrf;
+  const struct grammar* g = vrf->gram;
+  const struct grammarNode* p = &g->nodes.vals[pat];
+  if (p->argc == 0) {
+    return !verifierIsType(vrf, p->rule, symType_variable)
+      || symstringIsIn(&w->subVars, p->rule);
+  }
+  for (i = 0; i < p->argc; i++) {
+    if (!minimizerIsBound(w, g->args.vals[p->first + i])) { return 0; }
+  }
+  return 1;
+}
+
+/* the tree pat with the substitution applied, or grammar_none_id if it */
+/* was never made, in which case no step proves it */
+static size_t
+minimizerSubstitute(struct minimizerWorker* w, size_t pat)
+{
+  size_t i;
+  const struct verifier* vrf = w->m->vrf;
+  const struct grammar* g = vrf->gram;
+  const struct grammarNode* p = &g->nodes.vals[pat];
+  if (p->argc == 0) {
+    if (!verifierIsType(vrf, p->rule, symType_variable)) { return pat; }
+    for (i = 0; i < w->subVars.size; i++) {
+      if (w->subVars.vals[i] == p->rule) { return w->subTrees.vals[i]; }
+    }
+    return grammar_none_id;
+  }
+  const size_t base = w->buf.size;
+  for (i = 0; i < p->argc; i++) {
+    const size_t s = minimizerSubstitute(w, g->args.vals[p->first + i]);
+    if (s == grammar_none_id) {
+      w->buf.size = base;
+      return grammar_none_id;
+    }
+    size_tArrayAdd(&w->buf, s);
+  }
+  const size_t res = grammarFindNode(g, p->rule, w->buf.vals + base, p->argc);
+  w->buf.size = base;
+  return res;
+}
+
+/* find steps before step end proving the essential hypotheses from the */
+/* k-th on, with a substitution which agrees with the one so far */
+static int
+minimizerMatchHypotheses(struct minimizerWorker* w, size_t end, size_t k)
+{
+  size_t i;
+  if (k == w->hyps.size) { return 1; }
+  const struct verifier* vrf = w->m->vrf;
+  const struct grammar* g = vrf->gram;
+  const size_t tree = minimizerGetTree(vrf, w->hyps.vals[k]);
+  if (tree == grammar_none_id) { return 0; }
+  const struct grammarNode* p = &g->nodes.vals[tree];
+  const size_t code = p->rule;
+  const size_t pat = g->args.vals[p->first];
+/* the statement is known, so it is looked up */
+  if (minimizerIsBound(w, pat)) {
+    const size_t body = minimizerSubstitute(w, pat);
+    if (body == grammar_none_id) { return 0; }
+    const size_t id = minimizerFindStep(w, code, body);
+    if (id == minimizer_none_id || id >= end) { return 0; }
+    size_tArrayAdd(&w->args, id);
+    if (minimizerMatchHypotheses(w, end, k + 1)) { return 1; }
+    w->args.size--;
+    return 0;
+  }
+  const size_t size = w->subVars.size;
+  for (i = 0; i < end; i++) {
+    const struct minimizerStep* s = &w->steps.vals[i];
+    if (s->code != code) { continue; }
+    if (++w->matches > minimizer_max_matches) { return 0; }
+    if (minimizerMatch(w, pat, s->body)) {
+      size_tArrayAdd(&w->args, i);
+      if (minimizerMatchHypotheses(w, end, k + 1)) { return 1; }
+      w->args.size--;
+    }
+    w->subVars.size = size;
+    w->subTrees.size = size;
+  }
+  return 0;
+}
+
+/* add the variables of the tree to set */
+static void
+minimizerGetVariables(const struct minimizerWorker* w, struct size_tArray* set,
+  size_t node)
+{
+  size_t i;
+  const struct verifier* vrf = w->m->vrf;
+  const struct grammar* g = vrf->gram;
+  const struct grammarNode* n = &g->nodes.vals[node];
+  if (n->argc == 0) {
+    if (verifierIsType(vrf, n->rule, symType_variable)
+      && !symstringIsIn(set, n->rule)) {
+      size_tArrayAdd(set, n->rule);
+    }
+    return;
+  }
+  for (i = 0; i < n->argc; i++) {
+    minimizerGetVariables(w, set, g->args.vals[n->first + i]);
+  }
+}
+
+/* the disjoint variable restrictions of frm hold for the substitution in */
+/* ctx. See verifierIsValidDisjointPairSubstitution */
+static int
+minimizerIsDisjoint(struct minimizerWorker* w, const struct frame* ctx,
+  const struct frame* frm)
+{
+  size_t i, j, k, l;
+  for (i = 0; i < w->subVars.size; i++) {
+    for (j = i + 1; j < w->subVars.size; j++) {
+      if (!frameAreDisjoint(frm, w->subVars.vals[i], w->subVars.vals[j])) {
+        continue;
+      }
+      w->dv1.size = 0;
+      w->dv2.size = 0;
+      minimizerGetVariables(w, &w->dv1, w->subTrees.vals[i]);
+      minimizerGetVariables(w, &w->dv2, w->subTrees.vals[j]);
+      if (symstringIsIntersecting(&w->dv1, &w->dv2)) { return 0; }
+      for (k = 0; k < w->dv1.size; k++) {
+        for (l = 0; l < w->dv2.size; l++) {
+          if (!frameAreDisjoint(ctx, w->dv1.vals[k], w->dv2.vals[l])) {
+            return 0;
+          }
+        }
+      }
+    }
+  }
+  return 1;
+}
+
+/* the step proving the syntax statement of the type code and body, made */
+/* from the $f statements and syntax axioms if it is not in the proof. */
+/* Returns minimizer_none_id if a variable has no $f statement in it */
+static size_t
+minimizerSyntaxStep(struct minimizerWorker* w, size_t code, size_t body)
+{
+  size_t i;
+  const struct verifier* vrf = w->m->vrf;
+  const struct grammar* g = vrf->gram;
+  const size_t id = minimizerFindStep(w, code, body);
+  if (id != minimizer_none_id) { return id; }
+  const struct grammarNode* n = &g->nodes.vals[body];
+  if (n->argc == 0 && verifierIsType(vrf, n->rule, symType_variable)) {
+    for (i = 0; i < w->floats.size; i += 2) {
+      if (w->floats.vals[i] == n->rule) {
+        return minimizerAddStep(w, w->floats.vals[i + 1], code, body,
+          w->kids.size, 0);
+      }
+    }
+    return minimizer_none_id;
+  }
+/* the children of a syntax axiom are in the order of its hypotheses */
+  const size_t base = w->buf.size;
+  for (i = 0; i < n->argc; i++) {
+    const size_t kid = g->args.vals[n->first + i];
+    const size_t s =
+      minimizerSyntaxStep(w, grammarGetTypeCode(g, vrf, kid), kid);
+    if (s == minimizer_none_id) {
+      w->buf.size = base;
+      return minimizer_none_id;
+    }
+    size_tArrayAdd(&w->buf, s);
+  }
+  const size_t first = w->kids.size;
+  size_tArrayAppend(&w->kids, w->buf.vals + base, n->argc);
+  w->buf.size = base;
+  return minimizerAddStep(w, n->rule, code, body, first, n->argc);
+}
+
+/* make step id an application of the assertion symId, if its conclusion */
+/* matches the statement of the step and steps before it prove its */
+/* essential hypotheses. Returns 0 if it does not apply */
+static int
+minimizerTry(struct minimizerWorker* w, const struct frame* ctx, size_t id,
+  size_t symId)
+{
+  size_t i;
+  const struct verifier* vrf = w->m->vrf;
+  const struct grammar* g = vrf->gram;
+  const struct symbol* sym = &vrf->symbols.vals[symId];
+  const struct frame* frm = &vrf->frames.vals[sym->frame];
+  const size_t argc = frm->stmts.size;
+  const size_t tree = minimizerGetTree(vrf, symId);
+  if (tree == grammar_none_id) { return 0; }
+  const struct grammarNode* root = &g->nodes.vals[tree];
+  const struct minimizerStep s = w->steps.vals[id];
+  if (root->rule != s.code) { return 0; }
+  w->subVars.size = 0;
+  w->subTrees.size = 0;
+  if (!minimizerMatch(w, g->args.vals[root->first], s.body)) { return 0; }
+/* the frame is in reverse order */
+  w->hyps.size = 0;
+  for (i = 0; i < argc; i++) {
+    const size_t hyp = frm->stmts.vals[argc - 1 - i];
+    if (verifierIsType(vrf, hyp, symType_essential)) {
+      size_tArrayAdd(&w->hyps, hyp);
+    }
+  }
+  w->args.size = 0;
+  w->matches = 0;
+  if (!minimizerMatchHypotheses(w, id, 0)) { return 0; }
+  if (!minimizerIsDisjoint(w, ctx, frm)) { return 0; }
+  const size_t base = w->buf.size;
+  size_t e = 0;
+  for (i = 0; i < argc; i++) {
+    const size_t hyp = frm->stmts.vals[argc - 1 - i];
+    size_t arg;
+    if (verifierIsType(vrf, hyp, symType_essential)) {
+      arg = w->args.vals[e++];
+    } else {
+      const struct symstring* f = &vrf->stmts.vals[vrf->symbols.vals[hyp].stmt];
+      const size_t var = f->vals[1];
+      const size_t* sub = NULL;
+      size_t j;
+      for (j = 0; j < w->subVars.size; j++) {
+        if (w->subVars.vals[j] == var) { sub = &w->subTrees.vals[j]; }
+      }
+      arg = sub ? minimizerSyntaxStep(w, f->vals[0], *sub)
+        : minimizer_none_id;
+    }
+    if (arg == minimizer_none_id) {
+      w->buf.size = base;
+      return 0;
+    }
+    size_tArrayAdd(&w->buf, arg);
+  }
+  struct minimizerStep* t = &w->steps.vals[id];
+  t->label = symId;
+  t->first = w->kids.size;
+  t->argc = argc;
+  size_tArrayAppend(&w->kids, w->buf.vals + base, argc);
+  w->buf.size = base;
+  return 1;
+}
+
+/* append the tree in preorder to str, and where each subtree ends to ends */
+static void
+minimizerPreorder(const struct grammar* g, struct symstring* str,
+  struct size_tArray* ends, size_t node)
+{
+  size_t i;
+  const struct grammarNode* n = &g->nodes.vals[node];
+  const size_t pos = str->size;
+  symstringAdd(str, n->rule);
+  size_tArrayAdd(ends, 0);
+  for (i = 0; i < n->argc; i++) {
+    minimizerPreorder(g, str, ends, g->args.vals[n->first + i]);
+  }
+  ends->vals[pos] = str->size;
+}
+
+/* try the candidates for each step reached, from the last, keeping the */
+/* one which makes the proof shortest */
+static void
+minimizerSearch(struct minimizerWorker* w, struct minimizerJob* job)
+{
+  size_t i, j;
+  const struct verifier* vrf = w->m->vrf;
+  const struct grammar* g = vrf->gram;
+  const struct frame* ctx =
+    &vrf->frames.vals[vrf->symbols.vals[job->thm].frame];
+  job->best.size = 0;
+  const size_t root = minimizerBuild(w, job);
+  if (root == minimizer_none_id) { return; }
+  size_t best = minimizerCount(w, root);
+  if (best == minimizer_none_id) { return; }
+  const size_t original = w->steps.size;
+  for (i = original; i-- > 0;) {
+    const struct minimizerStep s = w->steps.vals[i];
+    if (w->marks.vals[i] != w->stamp + 1 || minimizerIsSyntax(vrf, s.code)) {
+      continue;
+    }
+/* the statement is the type code over the body */
+    w->str.size = 0;
+    w->ends.size = 0;
+    symstringAdd(&w->str, s.code);
+    size_tArrayAdd(&w->ends, 0);
+    minimizerPreorder(g, &w->str, &w->ends, s.body);
+    w->ends.vals[0] = w->str.size;
+    w->found.size = 0;
+    trieFindSpans(&w->m->index, w->str.vals, w->ends.vals, w->str.size,
+      &w->found);
+    struct minimizerStep kept = s;
+    int isTried = 0;
+    for (j = 0; j < w->found.size; j++) {
+      if (w->found.vals[j] >= job->thm) { continue; }
+      if (!minimizerTry(w, ctx, i, w->found.vals[j])) { continue; }
+      isTried = 1;
+      const size_t count = minimizerCount(w, root);
+      if (count < best) {
+        best = count;
+        kept = w->steps.vals[i];
+      }
+      w->steps.vals[i] = s;
+    }
+    w->steps.vals[i] = kept;
+/* mark the steps reached again, if counting changed the marks */
+    if (isTried) { minimizerCount(w, root); }
+  }
+  if (best >= job->prf.steps.size) { return; }
+  minimizerCount(w, root);
+  w->stamp += 2;
+  w->tagCount = 0;
+  minimizerEmit(w, root, &job->best);
+}
+
+static void*
+minimizerWork(void* arg)
+{
+  struct minimizerWorker* w = arg;
+  struct minimizer* m = w->m;
+  memorySetTag(memtag_minimizer);
+  while (1) {
+    pthread_mutex_lock(&m->lock);
+    if (m->next == m->jobs.size) {
+      pthread_mutex_unlock(&m->lock);
+      break;
+    }
+    struct minimizerJob* job = &m->jobs.vals[m->next++];
+    pthread_mutex_unlock(&m->lock);
+    minimizerSearch(w, job);
+  }
+  return NULL;
+}
+
+/* read the proofs of thms[from .. to - 1] which were verified, and run */
+/* them on trees */
+static void
+minimizerRead(struct minimizer* m, size_t from, size_t to)
+{
+  size_t i;
+  struct verifier* vrf = m->vrf;
+  struct grammar* g = vrf->gram;
+  m->jobs.size = 0;
+  for (i = from; i < to; i++) {
+    const size_t thm = m->thms.vals[i];
+    if (verifierGetProofState(vrf, thm) != proofState_verified) { continue; }
+    struct minimizerJob* job = &m->jobs.vals[m->jobs.size];
+    job->thm = thm;
+    job->prf.dependencies.size = 0;
+    job->prf.steps.size = 0;
+    job->trees.size = 0;
+    job->best.size = 0;
+    if (!verifierReadProof(vrf, thm, &job->prf)) { continue; }
+    grammarRunProof(g, vrf, &vrf->frames.vals[vrf->symbols.vals[thm].frame],
+      &job->prf.steps);
+    if (g->isFailed || g->isSkipped || g->stack.size != 1
+      || g->steps.size != job->prf.steps.size) {
+      continue;
+    }
+    size_tArrayAppend(&job->trees, g->steps.vals, g->steps.size);
+    m->jobs.size++;
+    m->searched++;
+  }
+}
+
+/* search the proofs read with the workers, this thread being one */
+static void
+minimizerSearchAll(struct minimizer* m, struct minimizerWorker* workers)
+{
+  size_t i;
+  pthread_t threads[minimizer_max_threads];
+  size_t n = m->threads - 1;
+  m->next = 0;
+  if (n == 0) {
+    minimizerWork(&workers[0]);
+    return;
+  }
+  memoryBeginThreads();
+  for (i = 0; i < n; i++) {
+    if (pthread_create(&threads[i], NULL, minimizerWork, &workers[i + 1])) {
+      break;
+    }
+  }
+  n = i;
+  minimizerWork(&workers[0]);
+  for (i = 0; i < n; i++) {
+    pthread_join(threads[i], NULL);
+  }
+  memoryEndThreads();
+}
+
+/* append the number of a step of a compressed proof to the text */
+static void
+minimizerEncode(struct minimizer* m, size_t num, int isTagged, size_t* col)
+{
+  char digits[32];
+  size_t len = 0;
+/* the last digit is A to T, and the ones before it are U to Y */
+  digits[len++] = 'A' + (num - 1) % 20;
+  num = (num - 1) / 20;
+  while (num > 0) {
+    digits[len++] = 'U' + (num - 1) % 5;
+    num = (num - 1) / 5;
+  }
+  if (isTagged) {
+    memmove(digits + 1, digits, len);
+    digits[0] = 'Z';
+    len++;
+  }
+  if (*col + len > minimizer_line_size) {
+    charArrayAppend(&m->text, "\n      ", 7);
+    *col = 6;
+  }
+  while (len > 0) {
+    charArrayAdd(&m->text, digits[--len]);
+    (*col)++;
+  }
+}
+
+/* append the steps as a compressed proof of thm to the text */
+static void
+minimizerCompress(struct minimizer* m, size_t thm,
+  const struct proofStepArray* steps)
+{
+  size_t i, j;
+  const struct verifier* vrf = m->vrf;
+  const struct frame* ctx = &vrf->frames.vals[vrf->symbols.vals[thm].frame];
+  const size_t hyps = ctx->stmts.size;
+/* the labels which are not mandatory hypotheses, in the order of use */
+  m->labels.size = 0;
+  for (i = 0; i < steps->size; i++) {
+    const struct proofStep* step = &steps->vals[i];
+    if (step->isTagRef || symstringIsIn(&ctx->stmts, step->id)
+      || symstringIsIn(&m->labels, step->id)) {
+      continue;
+    }
+    symstringAdd(&m->labels, step->id);
+  }
+  size_t col = 2;
+  charArrayAppend(&m->text, "( ", 2);
+  for (i = 0; i < m->labels.size; i++) {
+    const char* name = verifierGetSymName(vrf, m->labels.vals[i]);
+    const size_t len = strlen(name);
+    if (col + len + 1 > minimizer_line_size) {
+      charArrayAppend(&m->text, "\n      ", 7);
+      col = 6;
+    }
+    charArrayAppend(&m->text, name, len);
+    charArrayAdd(&m->text, ' ');
+    col += len + 1;
+  }
+  charArrayAppend(&m->text, ") ", 2);
+  col += 2;
+/* see verifierParseCompressedProof for the numbers */
+  for (i = 0; i < steps->size; i++) {
+    const struct proofStep* step = &steps->vals[i];
+    size_t num;
+    if (step->isTagRef) {
+      num = hyps + m->labels.size + 1 + step->id;
+    } else {
+      for (j = 0; j < hyps && ctx->stmts.vals[j] != step->id; j++) {}
+      if (j < hyps) {
+        num = hyps - j;
+      } else {
+        for (j = 0; m->labels.vals[j] != step->id; j++) {}
+        num = hyps + 1 + j;
+      }
+    }
+    minimizerEncode(m, num, step->isTagged, &col);
+  }
+}
+
+/* keep the shorter proofs which the verifier accepts */
+static void
+minimizerCheck(struct minimizer* m)
+{
+  size_t i;
+  for (i = 0; i < m->jobs.size; i++) {
+    const struct minimizerJob* job = &m->jobs.vals[i];
+    if (job->best.size == 0) { continue; }
+    if (!verifierIsProof(m->vrf, job->thm, &job->best)) {
+      m->rejected++;
+      continue;
+    }
+    struct minimizerResult res;
+    res.thm = job->thm;
+    res.before = job->prf.steps.size;
+    res.after = job->best.size;
+    res.text = m->text.size;
+    minimizerCompress(m, job->thm, &job->best);
+    res.len = m->text.size - res.text;
+    minimizerResultArrayAdd(&m->results, res);
+    m->before += res.before;
+    m->after += res.after;
+  }
+}
+
+/* add the assertions before the last theorem to the index, except the */
+/* syntax axioms */
+static void
+minimizerIndex(struct minimizer* m)
+{
+  size_t i;
+  struct verifier* vrf = m->vrf;
+  const struct grammar* g = vrf->gram;
+  struct symstring str;
+  struct size_tArray ends;
+  symstringInit(&str);
+  size_tArrayInit(&ends, 64);
+  size_t last = 0;
+  for (i = 0; i < m->thms.size; i++) {
+    if (m->thms.vals[i] > last) { last = m->thms.vals[i]; }
+  }
+  for (i = 0; i < last; i++) {
+    if (verifierIsType(vrf, i, symType_variable)) {
+      trieSetWildcard(&m->index, i);
+    }
+    if (!verifierIsType(vrf, i, symType_assertion)
+      && !verifierIsType(vrf, i, symType_provable)) {
+      continue;
+    }
+    const size_t tree = minimizerGetTree(vrf, i);
+    if (tree == grammar_none_id
+      || minimizerIsSyntax(vrf, g->nodes.vals[tree].rule)) {
+      continue;
+    }
+    str.size = 0;
+    ends.size = 0;
+    minimizerPreorder(g, &str, &ends, tree);
+    trieAdd(&m->index, str.vals, str.size, i);
+  }
+  size_tArrayClean(&ends);
+  symstringClean(&str);
+}
+
+void
+minimizerRun(struct minimizer* m)
+{
+  size_t i, from;
+  struct minimizerWorker workers[minimizer_max_threads];
+  timerStart(&m->timer);
+  enum memtag tag = memorySetTag(memtag_minimizer);
+  minimizerIndex(m);
+  for (i = 0; i < m->threads; i++) {
+    minimizerWorkerInit(&workers[i], m);
+  }
+  for (i = 0; i < minimizer_batch_size; i++) {
+    struct minimizerJob job;
+    proofInit(&job.prf);
+    size_tArrayInit(&job.trees, 64);
+    proofStepArrayInit(&job.best, 64);
+    minimizerJobArrayAdd(&m->jobs, job);
+  }
+  for (from = 0; from < m->thms.size; from += minimizer_batch_size) {
+    size_t to = from + minimizer_batch_size;
+    if (to > m->thms.size) { to = m->thms.size; }
+    minimizerRead(m, from, to);
+    minimizerSearchAll(m, workers);
+    minimizerCheck(m);
+  }
+  m->jobs.size = minimizer_batch_size;
+  for (i = 0; i < m->jobs.size; i++) {
+    struct minimizerJob* job = &m->jobs.vals[i];
+    proofStepArrayClean(&job->best);
+    size_tArrayClean(&job->trees);
+    proofClean(&job->prf);
+  }
+  m->jobs.size = 0;
+  for (i = 0; i < m->threads; i++) {
+    minimizerWorkerClean(&workers[i]);
+  }
+  memorySetTag(tag);
+  timerStop(&m->timer);
+}
+
+static const char* minimizer_whitespace = " \t\n\f\r";
+
+/* the next token of s[0 .. len - 1] from *at, outside comments. Returns */
+/* its start and moves *at past it, or returns len if there is none */
+static size_t
+minimizerNextToken(const char* s, size_t len, size_t* at)
+{
+  int isComment = 0;
+  while (*at < len) {
+    size_t begin = *at;
+    while (begin < len && strchr(minimizer_whitespace, s[begin])) { begin++; }
+    size_t end = begin;
+    while (end < len && !strchr(minimizer_whitespace, s[end])) { end++; }
+    *at = end;
+    if (begin == end) { break; }
+    const int isKeyword = (end - begin == 2 && s[begin] == '$');
+    if (isComment) {
+      if (isKeyword && s[begin + 1] == ')') { isComment = 0; }
+    } else if (isKeyword && s[begin + 1] == '(') {
+      isComment = 1;
+    } else {
+      return begin;
+    }
+  }
+  return len;
+}
+
+static int
+minimizerIsToken(const char* s, size_t at, size_t end, const char* tok)
+{
+  const size_t n = strlen(tok);
+  return end - at == n && memcmp(s + at, tok, n) == 0;
+}
+
+/* find the proof of the $p statement label in s from *at. Its steps are */
+/* s[*begin .. *end - 1], and *end is where its $. is */
+static int
+minimizerFindProof(const char* s, size_t len, size_t* at, const char* label,
+  size_t* begin, size_t* end)
+{
+  size_t tok = minimizerNextToken(s, len, at);
+  while (tok < len) {
+    if (!minimizerIsToken(s, tok, *at, label)) {
+      tok = minimizerNextToken(s, len, at);
+      continue;
+    }
+    tok = minimizerNextToken(s, len, at);
+    if (tok == len || !minimizerIsToken(s, tok, *at, "$p")) { continue; }
+    while (tok < len && !minimizerIsToken(s, tok, *at, "$=")) {
+      if (minimizerIsToken(s, tok, *at, "$.")) { return 0; }
+      tok = minimizerNextToken(s, len, at);
+    }
+    *begin = minimizerNextToken(s, len, at);
+    tok = *begin;
+    while (tok < len && !minimizerIsToken(s, tok, *at, "$.")) {
+      tok = minimizerNextToken(s, len, at);
+    }
+    *end = tok;
+    return tok < len;
+  }
+  return 0;
+}
+
+static int
+minimizerReadFile(const char* name, struct charArray* text)
+{
+  char buf[4096];
+  size_t n;
+  FILE* f = fopen(name, "rb");
+  if (!f) { return 0; }
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+    charArrayAppend(text, buf, n);
+  }
+  const int isRead = !ferror(f);
+  fclose(f);
+  return isRead;
+}
+
+int
+minimizerWrite(const struct minimizer* m, size_t file, const char* out)
+{
+  size_t i;
+  const struct verifier* vrf = m->vrf;
+  enum memtag tag = memorySetTag(memtag_minimizer);
+  struct charArray src;
+  charArrayInit(&src, 4096);
+  memorySetTag(tag);
+  if (!minimizerReadFile(vrf->files.vals[file].vals, &src)) {
+    charArrayClean(&src);
+    return 0;
+  }
+  FILE* fout = fopen(out, "wb");
+  if (!fout) {
+    charArrayClean(&src);
+    return 0;
+  }
+/* the proofs are in the order of their theorems in the file, so each is */
+/* looked for after the one before */
+  size_t pos = 0, at = 0;
+  int isWritten = 1;
+  for (i = 0; i < m->results.size && isWritten; i++) {
+    const struct minimizerResult* res = &m->results.vals[i];
+    const struct proofLoc* loc =
+      &vrf->locs.vals[vrf->symbols.vals[res->thm].frame];
+    if (loc->file != file) { continue; }
+    size_t begin, end;
+    if (!minimizerFindProof(src.vals, src.size, &at,
+      verifierGetSymName(vrf, res->thm), &begin, &end)) {
+      isWritten = 0;
+      break;
+    }
+    fwrite(src.vals + pos, 1, begin - pos, fout);
+    fwrite(m->text.vals + res->text, 1, res->len, fout);
+    fputc(' ', fout);
+    pos = end;
+  }
+  if (isWritten) { fwrite(src.vals + pos, 1, src.size - pos, fout); }
+  if (ferror(fout)) { isWritten = 0; }
+  if (fclose(fout) != 0) { isWritten = 0; }
+  charArrayClean(&src);
+  return isWritten;
+}
@@ -0,0 +1,149 @@
+#ifndef _HALMOSMINIMIZER_H_
+#define _HALMOSMINIMIZER_H_
+#include "array.h"
+#include "symstring.h"
+#include "timer.h"
+#include "trie.h"
+#include "verifier.h"
+#include <pthread.h>
+
+/* The minimizer shortens proofs by replacing subproofs with applications */
+/* of earlier assertions. A proof is taken as a graph of steps on syntax */
+/* trees, where a step can be replaced by an assertion whose conclusion */
+/* matches its statement and whose hypotheses are proved by earlier steps. */
+/* Candidates are found in a trie of the trees of the conclusions, where */
+/* a variable matches one subtree. Proofs are searched in parallel, and */
+/* each shorter proof found is checked by the verifier before it is kept. */
+/* This needs the grammar, and the proofs to have been skipped while */
+/* reading, as in lazy mode */
+
+/* a step of the graph of a proof: a hypothesis of the theorem, or an */
+/* assertion applied to the steps proving its hypotheses */
+struct minimizerStep {
+  size_t label;
+/* the statement proved, as its type code and the tree of its body */
+  size_t code;
+  size_t body;
+/* the steps of the hypotheses are kids.vals[first .. first + argc - 1] */
+  size_t first;
+  size_t argc;
+};
+typedef struct minimizerStep minimizerStep;
+DECLARE_ARRAY(minimizerStep)
+
+/* a proof to shorten */
+struct minimizerJob {
+  size_t thm;
+/* the proof read, the tree pushed by each of its steps, and the shorter */
+/* steps found, or none */
+  struct proof prf;
+  struct size_tArray trees;
+  struct proofStepArray best;
+};
+typedef struct minimizerJob minimizerJob;
+DECLARE_ARRAY(minimizerJob)
+
+/* a proof shortened and checked */
+struct minimizerResult {
+  size_t thm;
+  size_t before;
+  size_t after;
+/* the new proof in compressed form is text.vals[text .. text + len - 1] */
+  size_t text;
+  size_t len;
+};
+typedef struct minimizerResult minimizerResult;
+DECLARE_ARRAY(minimizerResult)
+
+struct minimizer;
+
+/* a thread searching proofs, with its own scratch space */
+struct minimizerWorker {
+  struct minimizer* m;
+  struct minimizerStepArray steps;
+  struct size_tArray kids;
+/* hashed set of steps by their statement. Slots hold the step + 1, or 0 */
+  struct size_tArray table;
+/* the $f statements of the proof, as pairs of variable and label */
+  struct size_tArray floats;
+/* the stack and the tagged steps while the graph is built */
+  struct size_tArray stack;
+  struct size_tArray tags;
+/* the substitution of the assertion tried, the steps proving its */
+/* essential hypotheses, and the variables of two disjoint variables */
+  struct size_tArray subVars;
+  struct size_tArray subTrees;
+  struct size_tArray hyps;
+  struct size_tArray args;
+  struct size_tArray dv1;
+  struct size_tArray dv2;
+/* scratch space of trees being substituted and steps being made */
+  struct size_tArray buf;
+/* for each step, when it was last reached, the times it was, and its tag */
+  struct size_tArray marks;
+  struct size_tArray refs;
+  struct size_tArray tagIds;
+  size_t stamp;
+  size_t tagCount;
+/* the number of steps matched with the hypotheses of the assertion tried */
+  size_t matches;
+/* a statement in preorder, where each subtree ends, and the candidates */
+/* found for it */
+  struct symstring str;
+  struct size_tArray ends;
+  struct size_tArray found;
+};
+
+struct minimizer {
+  struct verifier* vrf;
+/* the number of threads searching proofs */
+  size_t threads;
+/* the $p statements to minimize, in order */
+  struct size_tArray thms;
+/* the assertions, by the trees of their statements in preorder, where */
+/* the variables are wildcards */
+  struct trie index;
+/* the proofs being searched. jobs[next] is the next one to take */
+  struct minimizerJobArray jobs;
+  size_t next;
+  pthread_mutex_t lock;
+  struct minimizerResultArray results;
+  struct charArray text;
+/* the labels of a compressed proof being written */
+  struct symstring labels;
+/* the number of proofs searched, of shorter proofs the verifier rejected, */
+/* and the steps of the proofs shortened before and after */
+  size_t searched;
+  size_t rejected;
+  size_t before;
+  size_t after;
+  struct timer timer;
+};
+
+void
+minimizerInit(struct minimizer* m, struct verifier* vrf);
+
+void
+minimizerClean(struct minimizer* m);
+
+/* the number of threads used. The default is the number of processors, up */
+/* to 8 */
+void
+minimizerSetThreads(struct minimizer* m, size_t threads);
+
+/* minimize the proof of the $p statement symId */
+void
+minimizerAdd(struct minimizer* m, size_t symId);
+
+/* search shorter proofs for the $p statements added. The proofs which */
+/* were checked and verified are searched */
+void
+minimizerRun(struct minimizer* m);
+
+/* copy the source file with id file to out with its proofs shortened. */
+/* The proofs are found by their labels, so the comments and inclusions of */
+/* the file are kept. Returns 0 if it failed */
+int
+minimizerWrite(const struct minimizer* m, size_t file, const char* out);
+
+#endif
@@ -0,0 +1,209 @@
+/* syscall() and the perf_event_open interface are not C99 */
+#define _GNU_SOURCE
+#include "perf.h"
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+static const char* perfeventStrings[perfevent_size] = {
+  "cycles",
+  "instructions",
+  "cache misses",
+  "branch misses"
+};
+
+const char*
+perfeventString(enum perfevent ev)
+{
+  return perfeventStrings[ev];
+}
+
+void
+perfInit(struct perf* p)
+{
+  size_t i;
+  for (i = 0; i < perfevent_size; i++) {
+    p->fds[i] = -1;
+    p->slot[i] = -1;
+  }
+  p->open = 0;
+  p->err = 0;
+  p->isInherited = 0;
+}
+
+#ifdef __linux__
+static const uint64_t perfeventConfigs[perfevent_size] = {
+  PERF_COUNT_HW_CPU_CYCLES,
+  PERF_COUNT_HW_INSTRUCTIONS,
+  PERF_COUNT_HW_CACHE_MISSES,
+  PERF_COUNT_HW_BRANCH_MISSES
+};
+
+/* layout of a read() on the group leader */
+struct perfGroupRead {
+  uint64_t nr;
+  uint64_t enabled;
+  uint64_t running;
+  uint64_t values[perfevent_size];
+};
+
+static int
+perfOpenEvent(enum perfevent ev, int leader, int isInherited)
+{
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.config = perfeventConfigs[ev];
+  attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED
+    | PERF_FORMAT_TOTAL_TIME_RUNNING;
+/* start the group disabled and enable it once all events are in */
+  attr.disabled = (leader == -1);
+/* user space only, which unprivileged processes are usually allowed */
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+/* count the threads started after opening too, such as the thread pool */
+  attr.inherit = isInherited;
+  return (int) syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0);
+}
+
+int
+perfOpen(struct perf* p)
+{
+  size_t i;
+  p->isInherited = 1;
+  int leader = perfOpenEvent(perfevent_cycles, -1, 1);
+/* older kernels refuse to read a group of inherited events */
+  if (leader < 0 && errno == EINVAL) {
+    p->isInherited = 0;
+    leader = perfOpenEvent(perfevent_cycles, -1, 0);
+  }
+  if (leader < 0) {
+    p->err = errno;
+    return 0;
+  }
+  p->fds[perfevent_cycles] = leader;
+  p->slot[perfevent_cycles] = p->open++;
+/* the other events are optional. Virtual machines often lack some */
+  for (i = 0; i < perfevent_size; i++) {
+    if (i == perfevent_cycles) { continue; }
+    int fd = perfOpenEvent(i, leader, p->isInherited);
+    if (fd < 0) { continue; }
+    p->fds[i] = fd;
+    p->slot[i] = p->open++;
+  }
+  if (ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP) != 0
+    || ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP) != 0) {
+    int err = errno;
+    perfClose(p);
+    p->err = err;
+    return 0;
+  }
+  return 1;
+}
+
+static int
+perfRead(const struct perf* p, struct perfGroupRead* g)
+{
+  ssize_t len = read(p->fds[perfevent_cycles], g, sizeof(*g));
+  return len >= (ssize_t) (3 + p->open) * (ssize_t) sizeof(uint64_t);
+}
+#else
+int
+perfOpen(struct perf* p)
+{
+  p->err = ENOSYS;
+  return 0;
+}
+#endif
+
+void
+perfClose(struct perf* p)
+{
+  size_t i;
+  for (i = 0; i < perfevent_size; i++) {
+    if (p->fds[i] >= 0) { close(p->fds[i]); }
+  }
+  perfInit(p);
+}
+
+int
+perfIsOpen(const struct perf* p)
+{
+  return p->open > 0;
+}
+
+int
+perfIsCounted(const struct perf* p, enum perfevent ev)
+{
+  return p->slot[ev] >= 0;
+}
+
+void
+perfcountInit(struct perfcount* c)
+{
+  size_t i;
+  for (i = 0; i < perfevent_size; i++) {
+    c->values[i] = 0;
+    c->startValues[i] = 0;
+  }
+  c->enabled = 0;
+  c->running = 0;
+  c->count = 0;
+  c->startEnabled = 0;
+  c->startRunning = 0;
+}
+
+void
+perfStart(const struct perf* p, struct perfcount* c)
+{
+#ifdef __linux__
+  size_t i;
+  struct perfGroupRead g;
+  if (!perfIsOpen(p) || !perfRead(p, &g)) { return; }
+  for (i = 0; i < perfevent_size; i++) {
+    if (p->slot[i] >= 0) { c->startValues[i] = g.values[p->slot[i]]; }
+  }
+  c->startEnabled = g.enabled;
+  c->startRunning = g.running;
+  c->count++;
+#else
+  (void) p;
+  (void) c;
+#endif
+}
+
+void
+perfStop(const struct perf* p, struct perfcount* c)
+{
+#ifdef __linux__
+  size_t i;
+  struct perfGroupRead g;
+  if (!perfIsOpen(p) || !perfRead(p, &g)) { return; }
+  for (i = 0; i < perfevent_size; i++) {
+    if (p->slot[i] >= 0) {
+      c->values[i] += g.values[p->slot[i]] - c->startValues[i];
+    }
+  }
+  c->enabled += g.enabled - c->startEnabled;
+  c->running += g.running - c->startRunning;
+#else
+  (void) p;
+  (void) c;
+#endif
+}
+
+double
+perfcountGet(const struct perfcount* c, enum perfevent ev)
+{
+  double v = (double) c->values[ev];
+  if (c->running > 0 && c->running < c->enabled) {
+    v *= (double) c->enabled / (double) c->running;
+  }
+  return v;
+}
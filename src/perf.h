@@ -0,0 +1,80 @@
+#ifndef _HALMOSPERF_H_
+#define _HALMOSPERF_H_
+#include <stddef.h>
+#include <stdint.h>
+
+/* hardware events we count. On Linux they are read with perf_event_open. */
+/* Elsewhere, or when the kernel refuses, nothing is counted */
+enum perfevent {
+  perfevent_cycles,
+  perfevent_instructions,
+  perfevent_cacheMisses,
+  perfevent_branchMisses,
+  perfevent_size
+};
+
+const char* perfeventString(enum perfevent ev);
+
+/* the counters of the calling thread and the threads it starts later, */
+/* opened as one group so they are scheduled together and read with a */
+/* single system call */
+struct perf {
+/* file descriptor of each event, -1 if it could not be opened */
+  int fds[perfevent_size];
+/* position of each event in a group read, -1 if not opened */
+  int slot[perfevent_size];
+/* number of events in the group */
+  size_t open;
+/* errno from opening the group leader, 0 if it succeeded */
+  int err;
+/* 0 if the kernel only counts the calling thread */
+  int isInherited;
+};
+
+/* counts accumulated over a number of intervals */
+struct perfcount {
+  uint64_t values[perfevent_size];
+/* time the group was enabled and actually counting, in ns. If the kernel */
+/* had to multiplex the counters, running is less than enabled */
+  uint64_t enabled;
+  uint64_t running;
+/* number of intervals */
+  size_t count;
+/* values at the last start */
+  uint64_t startValues[perfevent_size];
+  uint64_t startEnabled;
+  uint64_t startRunning;
+};
+
+void
+perfInit(struct perf* p);
+
+/* open and enable the counters. Returns 0 if none are available, in which */
+/* case p->err says why and perfStart and perfStop do nothing */
+int
+perfOpen(struct perf* p);
+
+void
+perfClose(struct perf* p);
+
+int
+perfIsOpen(const struct perf* p);
+
+int
+perfIsCounted(const struct perf* p, enum perfevent ev);
+
+void
+perfcountInit(struct perfcount* c);
+
+void
+perfStart(const struct perf* p, struct perfcount* c);
+
+/* add the counts since the last perfStart() */
+void
+perfStop(const struct perf* p, struct perfcount* c);
+
+/* the count of an event, scaled up if the counters were multiplexed */
+double
+perfcountGet(const struct perfcount* c, enum perfevent ev);
+
+#endif
@@ -1,16 +1,41 @@
+/* stat(), sysconf(), realpath() and writev() are POSIX (XSI), not C99 */
+#define _XOPEN_SOURCE 700
 #include "array.h"
 #include "dbg.h"
+#include "hash.h"
 #include "logger.h"
 #include "preproc.h"
 #include "reader.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 static const char* whitespace = " \f\n\r\t";
+enum { preproc_max_threads = 8 };
+static const size_t preproc_set_size = 64;
+/* identifies cache entries. Bump the version when the format changes */
+static const char preproc_cache_magic[8] = "HPPC001";
+
+DEFINE_ARRAY(preprocEvent)
+DEFINE_ARRAY(preprocFileRef)
 
 void
 preprocInit(struct preproc* p)
 {
+  size_t i;
+  enum memtag tag = memorySetTag(memtag_reader);
   p->rs = xmalloc(sizeof(struct readerArray));
   readerArrayInit(p->rs, 1);
+  preprocFileRefArrayInit(&p->files, 1);
+  size_tArrayInit(&p->fileSet, preproc_set_size);
+  for (i = 0; i < preproc_set_size; i++) {
+    p->fileSet.vals[i] = 0;
+  }
+  p->fileSet.size = preproc_set_size;
+  memorySetTag(tag);
   /* add an empty reader, required for P_LOG */
   struct reader r;
   readerInitString(&r, "");
@@ -18,6 +43,23 @@ preprocInit(struct preproc* p)
   p->r = &p->rs->vals[0];
   p->err = error_none;
   p->errCount = 0;
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  p->threads = (cpus > 0) ? (size_t) cpus : 1;
+  if (p->threads > preproc_max_threads) { p->threads = preproc_max_threads; }
+  p->cacheDir = NULL;
+  p->next = 0;
+  p->active = 0;
+  pthread_mutex_init(&p->lock, NULL);
+  pthread_cond_init(&p->cond, NULL);
+}
+
+static void
+preprocFileClean(struct preprocFile* f)
+{
+  charArrayClean(&f->name);
+  charArrayClean(&f->out);
+  preprocEventArrayClean(&f->events);
+  charArrayClean(&f->strs);
 }
 
 void
@@ -28,7 +70,15 @@ preprocClean(struct preproc* p)
     readerClean(&p->rs->vals[i]);
   }
   readerArrayClean(p->rs);
-  free(p->rs);
+  xfree(p->rs);
+  for (i = 0; i < p->files.size; i++) {
+    preprocFileClean(p->files.vals[i]);
+    xfree(p->files.vals[i]);
+  }
+  preprocFileRefArrayClean(&p->files);
+  size_tArrayClean(&p->fileSet);
+  pthread_mutex_destroy(&p->lock);
+  pthread_cond_destroy(&p->cond);
 }
 
 void
@@ -38,146 +88,709 @@ preprocSetError(struct preproc* p, enum error err)
   p->errCount++;
 }
 
-int
-preprocIsFresh(const struct preproc* p, const char* filename)
+void
+preprocSetThreads(struct preproc* p, size_t threads)
+{
+  p->threads = (threads > 0) ? threads : 1;
+}
+
+void
+preprocSetCache(struct preproc* p, const char* dir)
+{
+  p->cacheDir = dir;
+  mkdir(dir, 0777);
+}
+
+size_t
+preprocCountCached(const struct preproc* p)
 {
   size_t i;
-  for (i = 0; i < p->rs->size; i++) {
-    if (strcmp(readerGetFilename(&p->rs->vals[i]), filename) == 0) {
-      return 0;
+  size_t n = 0;
+  for (i = 0; i < p->files.size; i++) {
+    n += p->files.vals[i]->isCached;
+  }
+  return n;
+}
+
+/* errors found while scanning are kept with the file and printed when it */
+/* is spliced, so they come out in the order of a sequential run */
+static void
+preprocFileLog(struct preprocFile* f, enum error err, const char* fmt, ...)
+{
+  struct preprocEvent e;
+  va_list args, copy;
+  va_start(args, fmt);
+  va_copy(copy, args);
+  int len = vsnprintf(NULL, 0, fmt, copy);
+  va_end(copy);
+  e.type = preprocEventType_error;
+  e.at = f->out.size;
+  e.str = f->strs.size;
+  e.fileId = 0;
+  e.err = err;
+  e.line = f->r->line;
+  e.offset = f->r->offset;
+  charArrayGrow(&f->strs, f->strs.size + len + 1);
+  vsnprintf(f->strs.vals + f->strs.size, len + 1, fmt, args);
+  f->strs.size += len + 1;
+  va_end(args);
+  preprocEventArrayAdd(&f->events, e);
+}
+
+#define PF_LOG_ERR(f, err, ...) preprocFileLog(f, err, __VA_ARGS__)
+
+static size_t
+preprocHashFile(int isStatted, uint64_t dev, uint64_t ino, const char* name)
+{
+  if (isStatted) {
+    return (size_t) ((ino * 0x9e3779b97f4a7c15ull) ^ dev);
+  }
+  return hashString(name, strlen(name));
+}
+
+static int
+preprocIsSameFile(const struct preprocFile* f, int isStatted, uint64_t dev,
+  uint64_t ino, const char* name)
+{
+  if (isStatted) {
+    return f->isStatted && f->dev == dev && f->ino == ino;
+  }
+  return !f->isStatted && strcmp(f->name.vals, name) == 0;
+}
+
+static void
+preprocSetPut(struct preproc* p, size_t fileId)
+{
+  const struct preprocFile* f = p->files.vals[fileId];
+  const size_t mask = p->fileSet.size - 1;
+  size_t i = preprocHashFile(f->isStatted, f->dev, f->ino, f->name.vals)
+    & mask;
+  while (p->fileSet.vals[i] != 0) {
+    i = (i + 1) & mask;
+  }
+  p->fileSet.vals[i] = fileId + 1;
+}
+
+size_t
+preprocAddFile(struct preproc* p, const char* name)
+{
+  size_t i;
+  struct stat st;
+  const int isStatted = (stat(name, &st) == 0);
+  const uint64_t dev = isStatted ? (uint64_t) st.st_dev : 0;
+  const uint64_t ino = isStatted ? (uint64_t) st.st_ino : 0;
+  pthread_mutex_lock(&p->lock);
+  const size_t mask = p->fileSet.size - 1;
+  i = preprocHashFile(isStatted, dev, ino, name) & mask;
+  while (p->fileSet.vals[i] != 0) {
+    const size_t fileId = p->fileSet.vals[i] - 1;
+    if (preprocIsSameFile(p->files.vals[fileId], isStatted, dev, ino, name)) {
+      pthread_mutex_unlock(&p->lock);
+      return fileId;
     }
+    i = (i + 1) & mask;
   }
-  return 1;
+/* a new file */
+  struct preprocFile* f = xmalloc(sizeof(struct preprocFile));
+  charArrayInit(&f->name, strlen(name) + 1);
+  charArrayAppend(&f->name, name, strlen(name) + 1);
+  f->isStatted = isStatted;
+  f->dev = dev;
+  f->ino = ino;
+  f->size = isStatted ? (uint64_t) st.st_size : 0;
+  f->mtime = isStatted ? (uint64_t) st.st_mtim.tv_sec * 1000000000u
+    + (uint64_t) st.st_mtim.tv_nsec : 0;
+  f->isFailed = 0;
+  f->isCached = 0;
+  charArrayInit(&f->out, 1);
+  preprocEventArrayInit(&f->events, 1);
+  charArrayInit(&f->strs, 1);
+  f->r = NULL;
+  timerInit(&f->timer);
+  f->splicedAs = NULL;
+  const size_t fileId = p->files.size;
+  preprocFileRefArrayAdd(&p->files, f);
+/* keep the load below one half */
+  if (2 * p->files.size > p->fileSet.size) {
+    const size_t size = 2 * p->fileSet.size;
+    size_tArrayResize(&p->fileSet, size);
+    p->fileSet.size = size;
+    for (i = 0; i < size; i++) {
+      p->fileSet.vals[i] = 0;
+    }
+    for (i = 0; i < p->files.size; i++) {
+      preprocSetPut(p, i);
+    }
+  } else {
+    preprocSetPut(p, fileId);
+  }
+/* wake a thread to scan it */
+  pthread_cond_signal(&p->cond);
+  pthread_mutex_unlock(&p->lock);
+  return fileId;
 }
 
-char*
-preprocParseSymbol(struct preproc* p, int* isEnd, int end)
+static char*
+preprocParseSymbol(struct preprocFile* f, int* isEnd, int end)
 {
-  readerSkip(p->r, whitespace);
-  char* tok = readerGetToken(p->r, whitespace);
+  readerSkip(f->r, whitespace);
+  char* tok = readerGetToken(f->r, whitespace);
   size_t len = strlen(tok);
   if (len == 2) {
     if ((tok[0] == '$') && (tok[1] == end)) {
       *isEnd = 1;
     }
   }
-  if (p->r->err && !isEnd) {
-    P_LOG_ERR(p, error_unterminatedFileInclusion, 
+  if (f->r->err && !isEnd) {
+    PF_LOG_ERR(f, error_unterminatedFileInclusion,
       "reached end of file before $]");
   }
   return tok;
 }
 
-void
-preprocParseComment(struct preproc* p, FILE* fOut)
+static void
+preprocParseComment(struct preprocFile* f)
 {
-  while (!p->r->err) {
-    readerFind(p->r, "$\n");
-    int c = readerGet(p->r);
-    if (p->r->err) { break; }
+  while (!f->r->err) {
+    readerFind(f->r, "$\n");
+    int c = readerGet(f->r);
+    if (f->r->err) { break; }
     if (c == '\n') {
 /* emit a newline to keep line number in sync */
-      fprintf(fOut, "\n");
+      charArrayAdd(&f->out, '\n');
       continue;
     }
 /* look at the char after $ */
-    c = readerGet(p->r);
-    if (p->r->err) { break; }
+    c = readerGet(f->r);
+    if (f->r->err) { break; }
     if (c == ')') { break; }
-    
+
     if (c == '(') {
-      P_LOG_ERR(p, error_nestedComment, "comments cannot be nested");
-      p->err = error_none;
-      preprocParseComment(p, fOut);
+      PF_LOG_ERR(f, error_nestedComment, "comments cannot be nested");
+      preprocParseComment(f);
       break;
     }
   }
-  if (p->r->err) {
-    P_LOG_ERR(p, error_unterminatedComment, "reached end of file before $)");
+  if (f->r->err) {
+    PF_LOG_ERR(f, error_unterminatedComment, "reached end of file before $)");
   }
 }
 
-void
-preprocParseInclude(struct preproc* p, FILE* fOut)
+static void
+preprocParseInclude(struct preproc* p, struct preprocFile* f)
 {
   int isEnd = 0;
-  char* tok = preprocParseSymbol(p, &isEnd, ']');
-  if (p->r->err) {
+  char* tok = preprocParseSymbol(f, &isEnd, ']');
+  if (f->r->err) {
     return;
   }
-/* if it is a new file, parse it */
-  if (preprocIsFresh(p, tok)) {
-    struct reader* r = p->r;
-    preprocParseFile(p, tok, fOut);
-    p->r = r;
-/* leave a special comment to indicate we are going back to the original */
-/* file */
-    fprintf(fOut, "$( %s %lu $)\n", p->r->filename.vals, p->r->line);
-  }
+/* note where the file goes. Whether it is new is decided by the splice */
+  struct preprocEvent e;
+  e.type = preprocEventType_include;
+  e.at = f->out.size;
+  e.str = f->strs.size;
+  e.fileId = preprocAddFile(p, tok);
+  e.err = error_none;
+  e.line = f->r->line;
+  e.offset = f->r->offset;
+  charArrayAppend(&f->strs, tok, strlen(tok) + 1);
+  preprocEventArrayAdd(&f->events, e);
 /* find $] */
-  tok = preprocParseSymbol(p, &isEnd, ']');
-  if (p->r->err) {
+  tok = preprocParseSymbol(f, &isEnd, ']');
+  if (f->r->err) {
     return;
   }
   if (!isEnd) {
-    P_LOG_ERR(p, error_expectedClosingBracket, "%s found instead of $]", tok);
-    while (!p->r->err) {
-      readerFind(p->r, "$");
-      tok = preprocParseSymbol(p, &isEnd, ']');
-      if (p->r->err) { break; }
+    PF_LOG_ERR(f, error_expectedClosingBracket, "%s found instead of $]", tok);
+    while (!f->r->err) {
+      readerFind(f->r, "$");
+      tok = preprocParseSymbol(f, &isEnd, ']');
+      if (f->r->err) { break; }
       if (isEnd) { break; }
     }
-    if (p->r->err) {
-      P_LOG_ERR(p, error_unterminatedFileInclusion, 
+    if (f->r->err) {
+      PF_LOG_ERR(f, error_unterminatedFileInclusion,
         "reached end of file before $]");
     }
   }
 }
 
-void
-preprocParseFile(struct preproc* p, const char* in, FILE* fOut)
+/* The cache has an entry for each file, named by the hash of its real */
+/* path. An entry holds the scanned output, strings and events of the */
+/* file, with its size, modification time and content hash. It is valid */
+/* if the size and time are unchanged, or if only the time changed but the */
+/* content hashes the same. Entries are written in the byte order of the */
+/* machine */
+
+/* hash the content of a file, reading it in blocks */
+static int
+preprocHashContent(const char* name, uint64_t* h)
+{
+  char buf[64 * 1024];
+  size_t n;
+  FILE* fIn = fopen(name, "rb");
+  if (!fIn) { return 0; }
+  *h = 0;
+  while ((n = fread(buf, 1, sizeof(buf), fIn)) > 0) {
+    *h = hash_wy64(buf, n, *h);
+  }
+  int isOk = !ferror(fIn);
+  fclose(fIn);
+  return isOk;
+}
+
+/* the path of the cache entry of f, and the real path of f. Returns 0 if */
+/* the real path can't be found */
+static int
+preprocCachePath(const struct preproc* p, const struct preprocFile* f,
+  struct charArray* path, struct charArray* real)
+{
+  char* r = realpath(f->name.vals, NULL);
+  if (!r) { return 0; }
+  charArrayAppend(real, r, strlen(r) + 1);
+  free(r);
+  const uint64_t h = hash_wy64(real->vals, real->size - 1, 0);
+  const size_t len = strlen(p->cacheDir) + 1 + 16 + 4 + 1;
+  charArrayGrow(path, len);
+  snprintf(path->vals, len, "%s/%016llx.ppc", p->cacheDir,
+    (unsigned long long) h);
+  path->size = strlen(path->vals) + 1;
+  return 1;
+}
+
+static int
+preprocReadU64(FILE* f, uint64_t* v)
+{
+  return fread(v, sizeof(*v), 1, f) == 1;
+}
+
+static int
+preprocReadChars(FILE* f, struct charArray* a)
+{
+  uint64_t n;
+  if (!preprocReadU64(f, &n)) { return 0; }
+  charArrayEmpty(a);
+  charArrayReserve(a, n + 1);
+  if (fread(a->vals, 1, n, f) != n) { return 0; }
+  a->size = n;
+  return 1;
+}
+
+static void
+preprocWriteU64(FILE* f, uint64_t v)
+{
+  fwrite(&v, sizeof(v), 1, f);
+}
+
+static void
+preprocWriteChars(FILE* f, const struct charArray* a)
+{
+  preprocWriteU64(f, a->size);
+  fwrite(a->vals, 1, a->size, f);
+}
+
+static void
+preprocCacheStore(const struct preproc* p, const struct preprocFile* f,
+  const char* path, const struct charArray* real, uint64_t hash)
+{
+  size_t i;
+/* write a temporary file and rename it, so that readers never see half */
+/* an entry */
+  const size_t len = strlen(path) + 32;
+  char* tmp = xmalloc(len);
+  snprintf(tmp, len, "%s.%ld.tmp", path, (long) getpid());
+  FILE* fOut = fopen(tmp, "wb");
+  if (!fOut) {
+    xfree(tmp);
+    return;
+  }
+  (void) p;
+  fwrite(preproc_cache_magic, 1, sizeof(preproc_cache_magic), fOut);
+  preprocWriteChars(fOut, real);
+  preprocWriteU64(fOut, f->size);
+  preprocWriteU64(fOut, f->mtime);
+  preprocWriteU64(fOut, hash);
+  preprocWriteChars(fOut, &f->out);
+  preprocWriteChars(fOut, &f->strs);
+  preprocWriteU64(fOut, f->events.size);
+  for (i = 0; i < f->events.size; i++) {
+    const struct preprocEvent* e = &f->events.vals[i];
+    preprocWriteU64(fOut, e->type);
+    preprocWriteU64(fOut, e->at);
+    preprocWriteU64(fOut, e->str);
+    preprocWriteU64(fOut, e->err);
+    preprocWriteU64(fOut, e->line);
+    preprocWriteU64(fOut, e->offset);
+  }
+  int isOk = !ferror(fOut);
+  isOk = (fclose(fOut) == 0) && isOk;
+  if (!isOk || rename(tmp, path) != 0) {
+    remove(tmp);
+  }
+  xfree(tmp);
+}
+
+/* fill f from its cache entry. Returns 0 if there is no valid entry, and */
+/* sets *hash to the content hash if it had to be computed */
+static int
+preprocCacheLoad(struct preproc* p, struct preprocFile* f, const char* path,
+  const struct charArray* real, uint64_t* hash, int* isHashed)
+{
+  size_t i;
+  char magic[sizeof(preproc_cache_magic)];
+  uint64_t size, mtime, h, n, v[6];
+  int isOk = 0;
+  FILE* fIn = fopen(path, "rb");
+  if (!fIn) { return 0; }
+  struct charArray name;
+  charArrayInit(&name, 1);
+  if (fread(magic, 1, sizeof(magic), fIn) != sizeof(magic)
+    || memcmp(magic, preproc_cache_magic, sizeof(magic)) != 0
+    || !preprocReadChars(fIn, &name) || name.size != real->size
+    || memcmp(name.vals, real->vals, name.size) != 0
+    || !preprocReadU64(fIn, &size) || !preprocReadU64(fIn, &mtime)
+    || !preprocReadU64(fIn, &h) || size != f->size) {
+    goto done;
+  }
+  if (mtime != f->mtime) {
+/* touched, but maybe not changed */
+    if (!preprocHashContent(f->name.vals, hash)) { goto done; }
+    *isHashed = 1;
+    if (*hash != h) { goto done; }
+  }
+  if (!preprocReadChars(fIn, &f->out) || !preprocReadChars(fIn, &f->strs)
+    || !preprocReadU64(fIn, &n)) {
+    goto done;
+  }
+  preprocEventArrayEmpty(&f->events);
+  for (i = 0; i < n; i++) {
+    struct preprocEvent e;
+    size_t j;
+    for (j = 0; j < 6; j++) {
+      if (!preprocReadU64(fIn, &v[j])) { goto done; }
+    }
+    e.type = v[0];
+    e.at = v[1];
+    e.str = v[2];
+    e.fileId = 0;
+    e.err = v[3];
+    e.line = v[4];
+    e.offset = v[5];
+/* don't trust a damaged entry */
+    if ((e.type != preprocEventType_include
+      && e.type != preprocEventType_error) || e.at > f->out.size
+      || e.str >= f->strs.size || e.err >= error_size
+      || (i > 0 && e.at < f->events.vals[i - 1].at)) {
+      goto done;
+    }
+    preprocEventArrayAdd(&f->events, e);
+  }
+  if (f->strs.size > 0 && f->strs.vals[f->strs.size - 1] != '\0') {
+    goto done;
+  }
+  isOk = 1;
+done:
+  fclose(fIn);
+  charArrayClean(&name);
+  if (!isOk) {
+    charArrayEmpty(&f->out);
+    charArrayEmpty(&f->strs);
+    preprocEventArrayEmpty(&f->events);
+    return 0;
+  }
+/* the included files still have to be found, and may have changed */
+  for (i = 0; i < f->events.size; i++) {
+    struct preprocEvent* e = &f->events.vals[i];
+    if (e->type == preprocEventType_include) {
+      e->fileId = preprocAddFile(p, f->strs.vals + e->str);
+    }
+  }
+/* remember the new time so the content is not hashed again */
+  if (mtime != f->mtime) {
+    preprocCacheStore(p, f, path, real, h);
+  }
+  return 1;
+}
+
+static void
+preprocScanFileText(struct preproc* p, struct preprocFile* f)
 {
-  FILE* fIn = fopen(in, "r");
+  struct charArray path, real;
+  uint64_t hash = 0;
+  int isHashed = 0;
+  int isCacheable = 0;
+  if (p->cacheDir) {
+    charArrayInit(&path, 1);
+    charArrayInit(&real, 1);
+    isCacheable = preprocCachePath(p, f, &path, &real);
+    if (isCacheable
+      && preprocCacheLoad(p, f, path.vals, &real, &hash, &isHashed)) {
+      f->isCached = 1;
+      charArrayClean(&path);
+      charArrayClean(&real);
+      return;
+    }
+  }
+  FILE* fIn = fopen(f->name.vals, "r");
   if (fIn == NULL) {
-    P_LOG_ERR(p, error_failedOpenFile, "failed to open input file %s", in);
+/* reported where the file is included */
+    f->isFailed = 1;
+    if (p->cacheDir) {
+      charArrayClean(&path);
+      charArrayClean(&real);
+    }
     return;
   }
-/* add the file to the list and begin reading it */
   struct reader r;
-  readerInitFile(&r, fIn, in);
-  readerArrayAdd(p->rs, r);
-  p->r = &r;
-/* leave a special comment for indicating file name and line. This is used */
-/* by the verifier when reporting errors */
-  fprintf(fOut, "$( %s 0 $)\n", in);
-  while (!p->r->err) {
-    int c = readerGet(p->r);
-    if (p->r->err) { break; }
+  readerInitFile(&r, fIn, f->name.vals);
+  f->r = &r;
+  while (!f->r->err) {
+/* text up to the next keyword is copied as is */
+    readerGetRun(f->r, '$', &f->out);
+    int c = readerGet(f->r);
+    if (f->r->err) { break; }
     if (c == '$') {
-      c = readerGet(p->r);
-      if (p->r->err) { break; }
+      c = readerGet(f->r);
+      if (f->r->err) { break; }
       if (c == '(') {
-        preprocParseComment(p, fOut);
+        preprocParseComment(f);
       } else if (c == '[') {
-        preprocParseInclude(p, fOut);
+        preprocParseInclude(p, f);
       } else {
-        fprintf(fOut, "$%c", c);
+        charArrayAdd(&f->out, '$');
+        charArrayAdd(&f->out, c);
       }
     } else {
-      fprintf(fOut, "%c", c);
+      charArrayAdd(&f->out, c);
     }
   }
+  f->r = NULL;
+  readerClean(&r);
   fclose(fIn);
+  if (p->cacheDir) {
+    if (isCacheable && (isHashed || preprocHashContent(f->name.vals, &hash))) {
+      preprocCacheStore(p, f, path.vals, &real, hash);
+    }
+    charArrayClean(&path);
+    charArrayClean(&real);
+  }
+}
+
+void
+preprocScanFile(struct preproc* p, struct preprocFile* f)
+{
+  timerStart(&f->timer);
+  preprocScanFileText(p, f);
+  timerStop(&f->timer);
+}
+
+/* take files from the queue until all are scanned */
+static void*
+preprocWork(void* arg)
+{
+  struct preproc* p = arg;
+/* with one thread this runs on the caller, whose tag is put back */
+  enum memtag tag = memorySetTag(memtag_reader);
+  pthread_mutex_lock(&p->lock);
+  while (1) {
+    while (p->next == p->files.size && p->active > 0) {
+      pthread_cond_wait(&p->cond, &p->lock);
+    }
+    if (p->next == p->files.size) { break; }
+    struct preprocFile* f = p->files.vals[p->next++];
+    p->active++;
+    pthread_mutex_unlock(&p->lock);
+    preprocScanFile(p, f);
+    pthread_mutex_lock(&p->lock);
+    p->active--;
+/* others may be waiting for new files or for the end */
+    pthread_cond_broadcast(&p->cond);
+  }
+  pthread_mutex_unlock(&p->lock);
+  memorySetTag(tag);
+  return NULL;
+}
+
+void
+preprocScanFiles(struct preproc* p)
+{
+  size_t i;
+  pthread_t threads[preproc_max_threads];
+  size_t n = p->threads - 1;
+  if (n > preproc_max_threads) { n = preproc_max_threads; }
+  p->next = 0;
+  p->active = 0;
+  if (n == 0) {
+    preprocWork(p);
+    return;
+  }
+  enum memtag tag = memorySetTag(memtag_reader);
+  memoryBeginThreads();
+  for (i = 0; i < n; i++) {
+    if (pthread_create(&threads[i], NULL, preprocWork, p) != 0) { break; }
+  }
+  n = i;
+/* this thread works too */
+  preprocWork(p);
+  for (i = 0; i < n; i++) {
+    pthread_join(threads[i], NULL);
+  }
+  memoryEndThreads();
+  memorySetTag(tag);
+}
+
+void
+preprocWriterInit(struct preprocWriter* w, int fd)
+{
+  w->fd = fd;
+  w->count = 0;
+  charArrayInit(&w->marks, 1024);
+  w->err = error_none;
+}
+
+void
+preprocWriterClean(struct preprocWriter* w)
+{
+  preprocWriterFlush(w);
+  charArrayClean(&w->marks);
+}
+
+void
+preprocWriterFlush(struct preprocWriter* w)
+{
+  size_t i;
+  struct iovec* iov = w->iov;
+  size_t count = w->count;
+/* the marks may have moved while they were added */
+  for (i = 0; i < count; i++) {
+    if (w->isMark[i]) { iov[i].iov_base = w->marks.vals + w->markAt[i]; }
+  }
+  while (count > 0 && !w->err) {
+    ssize_t n = writev(w->fd, iov, count);
+    if (n < 0) {
+      if (errno == EINTR) { continue; }
+      w->err = error_failedWriteFile;
+      break;
+    }
+/* skip what was written, which may end inside an entry */
+    while (count > 0 && (size_t) n >= iov->iov_len) {
+      n -= iov->iov_len;
+      iov++;
+      count--;
+    }
+    if (count > 0) {
+      iov->iov_base = (char*) iov->iov_base + n;
+      iov->iov_len -= n;
+    }
+  }
+  w->count = 0;
+  charArrayEmpty(&w->marks);
+}
+
+static void
+preprocWriterAddEntry(struct preprocWriter* w, const char* s, size_t len,
+  int isMark, size_t markAt)
+{
+  if (len == 0) { return; }
+  if (w->count == preproc_iov_size) { preprocWriterFlush(w); }
+  w->iov[w->count].iov_base = (char*) s;
+  w->iov[w->count].iov_len = len;
+  w->isMark[w->count] = isMark;
+  w->markAt[w->count] = markAt;
+  w->count++;
+}
+
+void
+preprocWriterAdd(struct preprocWriter* w, const char* s, size_t len)
+{
+  preprocWriterAddEntry(w, s, len, 0, 0);
+}
+
+void
+preprocWriterMark(struct preprocWriter* w, const char* name, size_t line)
+{
+  const char* format = "$( %s %lu $)\n";
+/* the length of the marker, without \0 */
+  int len = snprintf(NULL, 0, format, name, line);
+  if (len < 0) { return; }
+/* a flush empties marks, so it goes first */
+  if (w->count == preproc_iov_size) { preprocWriterFlush(w); }
+  const size_t at = w->marks.size;
+  charArrayGrow(&w->marks, at + len + 1);
+  snprintf(w->marks.vals + at, len + 1, format, name, line);
+  w->marks.size = at + len;
+  preprocWriterAddEntry(w, NULL, len, 1, at);
+}
+
+void
+preprocSplice(struct preproc* p, size_t fileId, const char* name,
+  struct charArray* isVisited, struct preprocWriter* w)
+{
+  size_t i;
+  struct preprocFile* f = p->files.vals[fileId];
+  size_t at = 0;
+  f->splicedAs = name;
+/* leave a special comment for indicating file name and line. This is used */
+/* by the verifier when reporting errors */
+  preprocWriterMark(w, name, 0);
+  for (i = 0; i < f->events.size; i++) {
+    const struct preprocEvent* e = &f->events.vals[i];
+    preprocWriterAdd(w, f->out.vals + at, e->at - at);
+    at = e->at;
+    const char* str = f->strs.vals + e->str;
+    if (e->type == preprocEventType_error) {
+      preprocSetError(p, e->err);
+      fprintf(stderr, "%s:%lu:%lu error [%s] %s\n", name, e->line, e->offset,
+        errorString(e->err), str);
+      continue;
+    }
+    const struct preprocFile* g = p->files.vals[e->fileId];
+    if (g->isFailed) {
+      preprocSetError(p, error_failedOpenFile);
+      fprintf(stderr, "%s:%lu:%lu error [%s] failed to open input file %s\n",
+        name, e->line, e->offset, errorString(error_failedOpenFile), str);
+    } else if (!isVisited->vals[e->fileId]) {
+      isVisited->vals[e->fileId] = 1;
+      preprocSplice(p, e->fileId, str, isVisited, w);
+    } else {
+      continue;
+    }
+/* leave a special comment to indicate we are going back to the original */
+/* file */
+    preprocWriterMark(w, name, e->line);
+  }
+  preprocWriterAdd(w, f->out.vals + at, f->out.size - at);
 }
 
 void
 preprocCompile(struct preproc* p, const char* in, const char* out)
 {
-  FILE* fOut = fopen(out, "w");
-  if (!fOut) {
+  size_t i;
+  int fd = open(out, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  if (fd < 0) {
     P_LOG_ERR(p, error_failedOpenFile, "failed to open output file %s", out);
     return;
   }
-  preprocParseFile(p, in, fOut);
-  fclose(fOut);
+  const size_t root = preprocAddFile(p, in);
+  preprocScanFiles(p);
+  if (p->files.vals[root]->isFailed) {
+    P_LOG_ERR(p, error_failedOpenFile, "failed to open input file %s", in);
+    close(fd);
+    return;
+  }
+  struct charArray isVisited;
+  charArrayInit(&isVisited, p->files.size);
+  for (i = 0; i < p->files.size; i++) {
+    charArrayAdd(&isVisited, 0);
+  }
+  isVisited.vals[root] = 1;
+  struct preprocWriter w;
+  preprocWriterInit(&w, fd);
+  preprocSplice(p, root, in, &isVisited, &w);
+  preprocWriterClean(&w);
+  charArrayClean(&isVisited);
+  if (w.err) {
+    P_LOG_ERR(p, w.err, "failed to write output file %s", out);
+  }
+  close(fd);
 }
@@ -1,13 +1,101 @@
 #ifndef _HALMOSPREPROC_H_
 #define _HALMOSPREPROC_H_
+#include "array.h"
 #include "error.h"
+#include "timer.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/uio.h>
 struct reader;
 struct readerArray;
+
+/* what the splice has to act on, at a position in the output of a file */
+enum preprocEventType {
+  preprocEventType_include,
+  preprocEventType_error
+};
+
+struct preprocEvent {
+  enum preprocEventType type;
+/* position in the output of the file */
+  size_t at;
+/* index in the strings of the file of the included name or the message */
+  size_t str;
+/* the included file */
+  size_t fileId;
+/* the error, and where it was found or where the file was included */
+  enum error err;
+  size_t line;
+  size_t offset;
+};
+typedef struct preprocEvent preprocEvent;
+DECLARE_ARRAY(preprocEvent)
+
+/* a file read and stripped of comments, with its includes not yet expanded */
+struct preprocFile {
+/* the name the file was found by first, used for opening it */
+  struct charArray name;
+/* device and inode, if the file exists. Files are the same if these are */
+  int isStatted;
+  uint64_t dev;
+  uint64_t ino;
+/* size and modification time in ns, for validating the cache */
+  uint64_t size;
+  uint64_t mtime;
+/* set if the file could not be opened */
+  int isFailed;
+/* set if the file was taken from the cache instead of being scanned */
+  int isCached;
+/* the text without comments, and where the includes and errors are */
+  struct charArray out;
+  struct preprocEventArray events;
+/* included names and error messages, each terminated by \0 */
+  struct charArray strs;
+/* the reader while the file is scanned */
+  struct reader* r;
+/* time spent reading and scanning the file, or loading it from the cache */
+  struct timer timer;
+/* the name the file was spliced by, or NULL if it was not written */
+  const char* splicedAs;
+};
+typedef struct preprocFile* preprocFileRef;
+DECLARE_ARRAY(preprocFileRef)
+
+/* output gathered for writev. The text of scanned files is written from */
+/* where it is, and only the markers between it are copied */
+enum { preproc_iov_size = 64 };
+struct preprocWriter {
+  int fd;
+  struct iovec iov[preproc_iov_size];
+/* for each entry, if it is a marker, its position in marks */
+  size_t markAt[preproc_iov_size];
+  char isMark[preproc_iov_size];
+  size_t count;
+  struct charArray marks;
+  enum error err;
+};
+
 struct preproc {
   struct readerArray* rs;
   struct reader* r;
   enum error err;
   size_t errCount;
+/* every file found in the include tree. The first is the input file */
+  struct preprocFileRefArray files;
+/* hashed set of files by device and inode, or by name if they don't */
+/* exist. Slots hold the file index + 1, or 0 if empty */
+  struct size_tArray fileSet;
+/* number of threads scanning files */
+  size_t threads;
+/* directory of the cache of scanned files, or NULL for no cache */
+  const char* cacheDir;
+/* the work queue. files[next] is the next file to scan, and active is */
+/* the number of files being scanned */
+  size_t next;
+  size_t active;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
 };
 
 void
@@ -16,14 +104,57 @@ preprocInit(struct preproc* p);
 void
 preprocClean(struct preproc* p);
 
+/* the number of threads used to read files. The default is the number of */
+/* processors, up to 8 */
+void
+preprocSetThreads(struct preproc* p, size_t threads);
+
+/* keep the scanned files in the directory dir and reuse them while the */
+/* files are unchanged. The directory is created if needed */
+void
+preprocSetCache(struct preproc* p, const char* dir);
+
+/* the number of files taken from the cache */
+size_t
+preprocCountCached(const struct preproc* p);
+
+/* return the id of the file with the given name, adding it to the list of */
+/* files to scan if it is new */
+size_t
+preprocAddFile(struct preproc* p, const char* name);
+
+/* read a file, strip its comments and find its includes */
+void
+preprocScanFile(struct preproc* p, struct preprocFile* f);
+
+/* scan all files of the include tree */
+void
+preprocScanFiles(struct preproc* p);
+
+void
+preprocWriterInit(struct preprocWriter* w, int fd);
+
+/* flush and clean the writer. The file descriptor is not closed */
+void
+preprocWriterClean(struct preprocWriter* w);
+
+/* write len bytes of s, which must not change until the next flush */
+void
+preprocWriterAdd(struct preprocWriter* w, const char* s, size_t len);
+
+/* write the marker telling the verifier where the following text is from */
 void
-preprocParseComment(struct preproc* p, FILE* fOut);
+preprocWriterMark(struct preprocWriter* w, const char* name, size_t line);
 
+/* write all that was added with one writev */
 void
-preprocParseInclude(struct preproc* p, FILE* fOut);
+preprocWriterFlush(struct preprocWriter* w);
 
+/* write file fileId as included by the given name, expanding its includes */
+/* depth-first. Files already written are skipped */
 void
-preprocParseFile(struct preproc* p, const char* in, FILE* fOut);
+preprocSplice(struct preproc* p, size_t fileId, const char* name,
+  struct charArray* isVisited, struct preprocWriter* w);
 
 void
 preprocCompile(struct preproc* p, const char* in, const char* out);
@@ -35,8 +35,10 @@ readerGetFile(struct reader* r)
 void
 readerInit(struct reader* r)
 {
+  enum memtag tag = memorySetTag(memtag_reader);
   charArrayInit(&r->tok, 256);
   charArrayInit(&r->filename, 256);
+  memorySetTag(tag);
   memset(r->buffer, 0, reader_bufferSize);
   r->f = NULL;
   r->bufferSize = 0;
@@ -49,6 +51,8 @@ readerInit(struct reader* r)
   r->mode = mode_none;
   //r->get = NULL;
   r->err = error_none;
+  r->timer = NULL;
+  r->tokHash = 0;
 }
 
 void
@@ -93,6 +97,23 @@ readerGetFilename(struct reader* r)
   return r->filename.vals;
 }
 
+/* read the next block of the file. At the end of the file the buffer is */
+/* empty, and buffer[0] is EOF for readerGet */
+static void
+readerFill(struct reader* r)
+{
+  r->buffer[0] = EOF;
+  if (r->timer) { timerStart(r->timer); }
+  r->bufferSize = fread((char*)r->buffer, sizeof(char), reader_bufferSize, 
+      r->f);
+  if (r->timer) { timerStop(r->timer); }
+  //if (r->bufferSize == 0) {
+    //r->err = error_endOfFile;
+    //return EOF;
+  //}
+  r->bufferPos = 0;
+}
+
 int
 readerGet(struct reader* r)
 {
@@ -103,14 +124,7 @@ readerGet(struct reader* r)
 /* read a character */
   if (r->bufferPos >= r->bufferSize) {
     if (r->err) { return EOF; }
-    r->buffer[0] = EOF;
-    r->bufferSize = fread((char*)r->buffer, sizeof(char), reader_bufferSize, 
-        r->f);
-    //if (r->bufferSize == 0) {
-      //r->err = error_endOfFile;
-      //return EOF;
-    //}
-    r->bufferPos = 0;
+    readerFill(r);
   }
   int c = r->buffer[r->bufferPos++];
   // int c = getc(r->stream.f);
@@ -146,20 +160,97 @@ readerGetToken(struct reader* r, const char* delimiters)
   while (1) {
     int c = readerGet(r);
     if (r->err != error_none) {
-      charArrayAdd(&r->tok, '\0');
       break;
     }
     if (strchr(delimiters, c)) {
-      charArrayAdd(&r->tok, '\0');
       r->last = c;
       break;
     }
     charArrayAdd(&r->tok, c);
     r->last = c;
   }
+/* hash the token while it is in cache and its length is known, so that */
+/* symbol lookups need neither strlen nor a second pass */
+  r->tokHash = hashString(r->tok.vals, r->tok.size);
+  charArrayAdd(&r->tok, '\0');
   return r->tok.vals;
 }
 
+size_t
+readerGetRun(struct reader* r, char stop, struct charArray* out)
+{
+  size_t n = 0;
+  if (r->didSkip) { return 0; }
+  while (!r->err) {
+    if (r->bufferPos >= r->bufferSize) {
+/* strings are all in the buffer */
+      if (r->mode != mode_file) { break; }
+      readerFill(r);
+      if (r->bufferSize == 0) { break; }
+    }
+    const char* start = (const char*)r->buffer + r->bufferPos;
+    size_t len = r->bufferSize - r->bufferPos;
+    const char* end = memchr(start, stop, len);
+    if (end) { len = end - start; }
+/* readerGet takes the byte EOF for the end, whatever follows it */
+    end = memchr(start, EOF, len);
+    if (end) { len = end - start; }
+    if (out) { charArrayAppend(out, start, len); }
+    n += len;
+    r->bufferPos += len;
+/* count lines and the offset in the last one */
+    const char* nl = memchr(start, '\n', len);
+    const char* last = NULL;
+    while (nl) {
+      r->line++;
+      last = nl;
+      nl = memchr(nl + 1, '\n', start + len - (nl + 1));
+    }
+    if (last) {
+      r->offset = start + len - (last + 1);
+    } else {
+      r->offset += len;
+    }
+/* stopped before the end of the buffer, at stop or EOF */
+    if (r->bufferPos < r->bufferSize) { break; }
+  }
+  return n;
+}
+
+size_t
+readerTell(const struct reader* r)
+{
+/* a character put back by readerPeek is not consumed */
+  size_t pos = r->bufferPos - (r->didSkip ? 1 : 0);
+  if (r->mode == mode_file) {
+    pos += (size_t) ftell(r->f) - r->bufferSize;
+  }
+  return pos;
+}
+
+void
+readerSeek(struct reader* r, size_t pos, size_t line, size_t offset)
+{
+/* positions in the buffer are still there */
+  const size_t start = (r->mode == mode_file)
+    ? (size_t) ftell(r->f) - r->bufferSize : 0;
+  if (r->mode == mode_file && (pos < start || pos >= start + r->bufferSize)) {
+    if (fseek(r->f, (long) pos, SEEK_SET) != 0) {
+      r->err = error_invalidFile;
+      return;
+    }
+/* the next readerGet refills the buffer */
+    r->bufferSize = 0;
+    r->bufferPos = 0;
+  } else {
+    r->bufferPos = pos - start;
+  }
+  r->didSkip = 0;
+  r->err = error_none;
+  r->line = line;
+  r->offset = offset;
+}
+
 void
 readerSkipExplicit(struct reader* r, const char* s, int skipOnMatch)
 {
@@ -2,6 +2,8 @@
 #define _HALMOSREADER_H_
 #include "array.h"
 #include "error.h"
+#include "hash.h"
+#include "timer.h"
 #include <stddef.h>
 #include <stdio.h>
 
@@ -23,6 +25,8 @@ struct reader {
 /* current position in the buffer */
   size_t bufferPos;
   struct charArray tok;
+/* hash of the last token from readerGetToken. Its length is tok.size - 1 */
+  hash_t tokHash;
   struct charArray filename;
   size_t line;
   size_t offset;
@@ -34,6 +38,8 @@ struct reader {
   int mode;
   //charGetter get;
   enum error err;
+/* if not NULL, time spent reading the file is added to this */
+  struct timer* timer;
 };
 
 void
@@ -51,6 +57,21 @@ readerGetFilename(struct reader* r);
 int
 readerGet(struct reader* r);
 
+/* append the characters up to the next stop character or the end of the */
+/* input to out, as runs copied from the buffer. Neither is consumed. */
+/* If out is NULL the characters are skipped. Returns the number of */
+/* characters appended or skipped */
+size_t
+readerGetRun(struct reader* r, char stop, struct charArray* out);
+
+/* the position of the next character from the beginning of the input */
+size_t
+readerTell(const struct reader* r);
+
+/* go back to a position from readerTell, at the given line and offset */
+void
+readerSeek(struct reader* r, size_t pos, size_t line, size_t offset);
+
 /* get the next char but put it back */
 int
 readerPeek(struct reader* r);
@@ -1,5 +1,6 @@
 #include "dbg.h"
 #include "symstring.h"
+#include <string.h>
 
 /* we want to write 'struct symstring' and 'struct symstringArray'. We */
 /* #defined symstring as size_tArray in the header, so undo this temporarily. */
@@ -33,6 +34,16 @@ DEFINE_ARRAY(symstring)
 //   size_tArrayAppend(a, b->vals, b->size);
 // }
 
+/* open a gap of size count at idx */
+static void
+symstringMakeRoom(struct symstring* a, size_t idx, size_t count)
+{
+  size_tArrayGrow(a, a->size + count);
+  memmove(&a->vals[idx + count], &a->vals[idx],
+    sizeof(size_t) * (a->size - idx));
+  a->size += count;
+}
+
 void
 symstringInsert(struct symstring* a, size_t idx, const struct symstring* b)
 {
@@ -41,13 +52,8 @@ symstringInsert(struct symstring* a, size_t idx, const struct symstring* b)
   if (b->size == 0) {
     return;
   }
-  struct size_tArray tmp;
-  size_tArrayInit(&tmp, a->size - idx);
-  size_tArrayAppend(&tmp, &a->vals[idx], a->size - idx);
-  a->size = idx;
-  symstringAppend(a, b);
-  size_tArrayAppend(a, tmp.vals, tmp.size);
-  size_tArrayClean(&tmp);
+  symstringMakeRoom(a, idx, b->size);
+  memcpy(&a->vals[idx], b->vals, sizeof(size_t) * b->size);
 }
 
 /* delete the item at idx */
@@ -56,10 +62,8 @@ symstringDelete(struct symstring* a, size_t idx)
 {
   DEBUG_ASSERT(a->size > idx,
     "invalid index: size is %lu but index was %lu", a->size, idx);
-  size_t i;
-  for (i = idx; i < a->size - 1; i++) {
-    a->vals[i] = a->vals[i + 1];
-  }
+  memmove(&a->vals[idx], &a->vals[idx + 1],
+    sizeof(size_t) * (a->size - idx - 1));
   a->size--;
 }
 
@@ -114,11 +118,23 @@ symstringIsIntersecting(const struct symstring* a, const struct symstring* b)
 void
 substitutionInit(struct substitution* sub)
 {
+  sub->arena = NULL;
   size_tArrayInit(&sub->vars, 1);
   symstringArrayInit(&sub->subs, 1);
 /* we don't initialize isMarked */
 }
 
+/* max is the expected number of variables */
+void
+substitutionInitArena(struct substitution* sub, size_t max,
+  struct arena* arena)
+{
+  if (max == 0) { max = 1; }
+  sub->arena = arena;
+  size_tArrayInitArena(&sub->vars, max, arena);
+  symstringArrayInitArena(&sub->subs, max, arena);
+}
+
 void
 substitutionClean(struct substitution* sub)
 {
@@ -162,14 +178,11 @@ substitutionSubstitute(struct substitution* sub, size_t varId,
       symstringInsert(str, i, &sub->subs.vals[varId]);
 /* insert markers */
       symstringDelete(&sub->isMarked, i);
+      symstringMakeRoom(&sub->isMarked, i, len);
       size_t j;
-      struct symstring tmp;
-      symstringInit(&tmp);
       for (j = 0; j < len; j++) {
-        symstringAdd(&tmp, 1);
+        sub->isMarked.vals[i + j] = 1;
       }
-      symstringInsert(&sub->isMarked, i, &tmp);
-      symstringClean(&tmp);
 /* skip over the string we inserted */
       i += len;
     } else {
@@ -184,7 +197,11 @@ substitutionApply(struct substitution* sub, struct symstring* str)
 {
   size_t i;
 /* initialize the marker */
-  symstringInit(&sub->isMarked);
+  if (sub->arena) {
+    symstringInitArena(&sub->isMarked, str->size * 2 + 1, sub->arena);
+  } else {
+    symstringInit(&sub->isMarked);
+  }
   substitutionUnmark(sub, str->size);
   for (i = 0; i < sub->vars.size; i++) {
     substitutionSubstitute(sub, i, str);
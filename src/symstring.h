@@ -13,6 +13,9 @@ static const size_t default_size = 64;
 
 #define symstringInit(symstr) size_tArrayInit((symstr), default_size)
 
+#define symstringInitArena(symstr, max, arena) \
+  size_tArrayInitArena((symstr), (max), (arena))
+
 #define symstringClean(symstr) size_tArrayClean((symstr))
 
 #define symstringAdd(symstr, symId) size_tArrayAdd((symstr), (symId))
@@ -52,6 +55,8 @@ void
 symstringSubstitute(struct symstring* a, size_t s, const struct symstring* b);
 
 struct substitution {
+/* if set, everything the substitution allocates comes from here */
+  struct arena* arena;
   struct size_tArray vars;
   struct symstringArray subs;
 /* used for simultaneous substitution */
@@ -61,6 +66,10 @@ struct substitution {
 void
 substitutionInit(struct substitution* sub);
 
+void
+substitutionInitArena(struct substitution* sub, size_t max,
+  struct arena* arena);
+
 void
 substitutionClean(struct substitution* sub);
 
@@ -2,6 +2,10 @@
 #include "hash.h"
 #include "symtab.h"
 #include "memory.h"
+#include <string.h>
+
+DEFINE_ARRAY(symmemoEntry)
+DEFINE_ARRAY(symcacheEntry)
 
 void
 symbolInit(struct symbol* sym)
@@ -13,6 +17,7 @@ symbolInit(struct symbol* sym)
   sym->scope = 0;
   sym->stmt = 0;
   sym->frame = 0;
+  sym->end = 0;
 }
 
 void
@@ -34,14 +39,14 @@ symnodeClean(struct symnode* n)
 {
   if (n->next != NULL) {
     symnodeClean(n->next);
-    free(n->next);
+    xfree(n->next);
     n->symId = 0;
     n->next = NULL;
   }
 }
 
 void
-symnodeInsert(struct symnode* n, uint32_t h, size_t symId)
+symnodeInsert(struct symnode* n, hash_t h, size_t symId)
 {
   DEBUG_ASSERT(symId != 0, "tried adding symId 0");
   if (n->symId == 0) {
@@ -70,19 +75,19 @@ symtreeClean(struct symtree* t)
 {
   if (t->less != NULL) {
     symtreeClean(t->less);
-    free(t->less);
+    xfree(t->less);
     t->less = NULL;
   }
   if (t->more != NULL) {
     symtreeClean(t->more);
-    free(t->more);
+    xfree(t->more);
     t->more = NULL;
   }
   symnodeClean(&t->node);
 }
 
 void
-symtreeInsert(struct symtree* t, uint32_t h, size_t symId)
+symtreeInsert(struct symtree* t, hash_t h, size_t symId)
 {
   DEBUG_ASSERT(symId != 0, "tried adding symId 0");
   if (t->node.symId == 0) {
@@ -111,7 +116,7 @@ symtreeInsert(struct symtree* t, uint32_t h, size_t symId)
 }
 
 struct symtree*
-symtreeFind(struct symtree* t, uint32_t h)
+symtreeFind(struct symtree* t, hash_t h)
 {
   if (h < t->node.h) {
     if (t->less == NULL) { return t; }
@@ -124,6 +129,131 @@ symtreeFind(struct symtree* t, uint32_t h)
   }
 }
 
+void
+symmemoInit(struct symmemo* m, size_t size)
+{
+  DEBUG_ASSERT(size > 0 && (size & (size - 1)) == 0,
+    "size %lu is not a power of 2", size);
+  size_t i;
+  symmemoEntryArrayInit(&m->entries, size);
+  for (i = 0; i < size; i++) {
+    m->entries.vals[i].gen = 0;
+  }
+  m->entries.size = size;
+  m->count = 0;
+/* entries of generation 0 are empty */
+  m->gen = 1;
+}
+
+void
+symmemoClean(struct symmemo* m)
+{
+  symmemoEntryArrayClean(&m->entries);
+}
+
+void
+symmemoReset(struct symmemo* m)
+{
+  m->gen++;
+  m->count = 0;
+}
+
+size_t
+symmemoFind(const struct symmemo* m, const struct symbolArray* symbols,
+  const char* sym, hash_t h)
+{
+  const size_t mask = m->entries.size - 1;
+  size_t i = h & mask;
+  while (m->entries.vals[i].gen == m->gen) {
+    const struct symmemoEntry* e = &m->entries.vals[i];
+    if (e->h == h && strcmp(symbols->vals[e->symId].sym.vals, sym) == 0) {
+      return e->symId;
+    }
+    i = (i + 1) & mask;
+  }
+  return 0;
+}
+
+static void
+symmemoPut(struct symmemo* m, hash_t h, size_t symId)
+{
+  const size_t mask = m->entries.size - 1;
+  size_t i = h & mask;
+  while (m->entries.vals[i].gen == m->gen) {
+    i = (i + 1) & mask;
+  }
+  m->entries.vals[i].h = h;
+  m->entries.vals[i].symId = symId;
+  m->entries.vals[i].gen = m->gen;
+  m->count++;
+}
+
+void
+symmemoAdd(struct symmemo* m, hash_t h, size_t symId)
+{
+  DEBUG_ASSERT(symId != 0, "tried adding symId 0");
+/* keep the load below one half, so probes stay short */
+  if (2 * (m->count + 1) > m->entries.size) {
+    size_t i;
+    const size_t size = m->entries.size;
+    const size_t gen = m->gen;
+    struct symmemoEntryArray old = m->entries;
+    symmemoInit(m, 2 * size);
+    m->gen = gen;
+    for (i = 0; i < size; i++) {
+      if (old.vals[i].gen == gen) {
+        symmemoPut(m, old.vals[i].h, old.vals[i].symId);
+      }
+    }
+    symmemoEntryArrayClean(&old);
+  }
+  symmemoPut(m, h, symId);
+}
+
+void
+symcacheInit(struct symcache* c, size_t size)
+{
+  DEBUG_ASSERT((size & (size - 1)) == 0, "size %lu is not a power of 2", size);
+  size_t i;
+  symcacheEntryArrayInit(&c->entries, size);
+  for (i = 0; i < size; i++) {
+    c->entries.vals[i].h = 0;
+    c->entries.vals[i].symId = 0;
+  }
+  c->entries.size = size;
+  c->lookups = 0;
+  c->hits = 0;
+}
+
+void
+symcacheClean(struct symcache* c)
+{
+  symcacheEntryArrayClean(&c->entries);
+}
+
+size_t
+symcacheFind(struct symcache* c, const struct symbolArray* symbols,
+  const char* sym, hash_t h)
+{
+  const struct symcacheEntry* e =
+    &c->entries.vals[h & (c->entries.size - 1)];
+  c->lookups++;
+  if (e->symId == 0 || e->h != h) { return 0; }
+  const struct symbol* s = &symbols->vals[e->symId];
+  if (!s->isActive || strcmp(s->sym.vals, sym) != 0) { return 0; }
+  c->hits++;
+  return e->symId;
+}
+
+void
+symcacheAdd(struct symcache* c, hash_t h, size_t symId)
+{
+  DEBUG_ASSERT(symId != 0, "tried adding symId 0");
+  struct symcacheEntry* e = &c->entries.vals[h & (c->entries.size - 1)];
+  e->h = h;
+  e->symId = symId;
+}
+
 // void
 // symtabInit(struct symtab* tab)
 // {
@@ -1,6 +1,7 @@
 #ifndef _HALMOSSYMTAB_H_
 #define _HALMOSSYMTAB_H_
 #include "array.h"
+#include "hash.h"
 #include <stdint.h>
 
 struct symbol;
@@ -35,6 +36,8 @@ struct symbol {
   size_t stmt;
 /* for $a and $p assertions */
   size_t frame;
+/* for $f and $e, the number of symbols when it went out of scope */
+  size_t end;
 /* index to verifier->files, which is an array of readers */
   size_t file; 
   size_t line; 
@@ -45,7 +48,7 @@ struct symnode;
 
 struct symnode {
 /* hash */
-  uint32_t h;
+  hash_t h;
 /* index to the symbol in the array. If p is 0, we are in an empty node */
   size_t symId;
 /* if there is a collision, point to the next node */
@@ -60,6 +63,43 @@ struct symtree {
   struct symtree* more;
 };
 
+/* remembers which symbol each label resolved to, so repeated labels skip */
+/* the tree. Bumping gen invalidates all entries at once */
+struct symmemoEntry {
+  hash_t h;
+  size_t symId;
+  size_t gen;
+};
+typedef struct symmemoEntry symmemoEntry;
+DECLARE_ARRAY(symmemoEntry)
+
+struct symmemo {
+/* open addressing with linear probing. The size is a power of 2 */
+  struct symmemoEntryArray entries;
+/* number of entries of the current generation */
+  size_t count;
+  size_t gen;
+};
+
+/* maps token hashes straight to symbols for the whole file. It is direct */
+/* mapped: a miss overwrites the slot. Entries are never invalidated. */
+/* Instead a hit is only trusted if the symbol is still active and has the */
+/* same name, which is enough because active names are unique */
+struct symcacheEntry {
+  hash_t h;
+  size_t symId;
+};
+typedef struct symcacheEntry symcacheEntry;
+DECLARE_ARRAY(symcacheEntry)
+
+struct symcache {
+/* the size is a power of 2 */
+  struct symcacheEntryArray entries;
+/* number of lookups and how many were found */
+  size_t lookups;
+  size_t hits;
+};
+
 // struct symtab {
 //   struct symtree t;
 //  we want the symbol table here, but keep it in verifier for now 
@@ -79,7 +119,7 @@ void
 symnodeClean(struct symnode* n);
 
 void
-symnodeInsert(struct symnode* n, uint32_t h, size_t symId);
+symnodeInsert(struct symnode* n, hash_t h, size_t symId);
 
 void
 symtreeInit(struct symtree* t);
@@ -89,12 +129,46 @@ symtreeClean(struct symtree* t);
 
 /* insert p with key h */
 void
-symtreeInsert(struct symtree* t, uint32_t h, size_t symId);
+symtreeInsert(struct symtree* t, hash_t h, size_t symId);
 
 /* find the first subtree with node of the given hash, or if none exists, */
 /* the last subtree searched */
 struct symtree*
-symtreeFind(struct symtree* t, uint32_t h);
+symtreeFind(struct symtree* t, hash_t h);
+
+/* size must be a power of 2 */
+void
+symmemoInit(struct symmemo* m, size_t size);
+
+void
+symmemoClean(struct symmemo* m);
+
+/* forget every entry */
+void
+symmemoReset(struct symmemo* m);
+
+/* return the symId remembered for sym with hash h, or 0 */
+size_t
+symmemoFind(const struct symmemo* m, const struct symbolArray* symbols,
+  const char* sym, hash_t h);
+
+void
+symmemoAdd(struct symmemo* m, hash_t h, size_t symId);
+
+/* size must be a power of 2 */
+void
+symcacheInit(struct symcache* c, size_t size);
+
+void
+symcacheClean(struct symcache* c);
+
+/* return the active symbol named sym with hash h if it is cached, or 0 */
+size_t
+symcacheFind(struct symcache* c, const struct symbolArray* symbols,
+  const char* sym, hash_t h);
+
+void
+symcacheAdd(struct symcache* c, hash_t h, size_t symId);
 
 // void
 // symtabInit(struct symtab* tab);
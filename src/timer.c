@@ -0,0 +1,54 @@
+/* clock_gettime() is POSIX, not C99 */
+#define _POSIX_C_SOURCE 200809L
+#include "timer.h"
+#include <time.h>
+
+static const char* phaseStrings[phase_size] = {
+  "read",
+  "preprocess",
+  "tokenize",
+  "parse",
+  "frame",
+  "unify",
+  "disjoint",
+  "substitution"
+};
+
+const char*
+phaseString(enum phase ph)
+{
+  return phaseStrings[ph];
+}
+
+static double
+timerNow(clockid_t clock)
+{
+  struct timespec ts;
+  if (clock_gettime(clock, &ts) != 0) { return 0.0; }
+  return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
+
+void
+timerInit(struct timer* t)
+{
+  t->wall = 0.0;
+  t->cpu = 0.0;
+  t->count = 0;
+  t->wallStart = 0.0;
+  t->cpuStart = 0.0;
+}
+
+void
+timerStart(struct timer* t)
+{
+  t->wallStart = timerNow(CLOCK_MONOTONIC);
+  t->cpuStart = timerNow(CLOCK_THREAD_CPUTIME_ID);
+  t->count++;
+}
+
+void
+timerStop(struct timer* t)
+{
+  t->wall += timerNow(CLOCK_MONOTONIC) - t->wallStart;
+  t->cpu += timerNow(CLOCK_THREAD_CPUTIME_ID) - t->cpuStart;
+}
@@ -0,0 +1,42 @@
+#ifndef _HALMOSTIMER_H_
+#define _HALMOSTIMER_H_
+#include <stddef.h>
+
+/* phases of processing we keep timers for */
+enum phase {
+  phase_read,
+  phase_preprocess,
+  phase_tokenize,
+  phase_parse,
+  phase_frame,
+  phase_unify,
+  phase_disjoint,
+  phase_substitution,
+  phase_size
+};
+
+const char* phaseString(enum phase ph);
+
+/* accumulates monotonic wall-clock time and cpu time of the calling thread */
+struct timer {
+/* total time in seconds */
+  double wall;
+  double cpu;
+/* number of times the timer was started */
+  size_t count;
+/* time at the last start */
+  double wallStart;
+  double cpuStart;
+};
+
+void
+timerInit(struct timer* t);
+
+void
+timerStart(struct timer* t);
+
+/* add the time since the last timerStart() */
+void
+timerStop(struct timer* t);
+
+#endif
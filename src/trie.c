@@ -0,0 +1,269 @@
+#include "hash.h"
+#include "memory.h"
+#include "trie.h"
+
+DEFINE_ARRAY(trieNode)
+DEFINE_ARRAY(trieEdge)
+DEFINE_ARRAY(trieValue)
+
+static const size_t trie_edges_size = 256;
+static const size_t trie_visited_size = 256;
+/* keys are cut after this many symbols, as if they ended with a wildcard. */
+/* The constants which tell statements apart come early, and whole */
+/* statements would make a node for most of their symbols */
+#ifndef TRIE_MAX_DEPTH
+#define TRIE_MAX_DEPTH 16
+#endif
+
+static void
+trieAddNode(struct trie* t)
+{
+  struct trieNode n;
+  n.head = 0;
+  n.wild = 0;
+  trieNodeArrayAdd(&t->nodes, n);
+}
+
+static void
+trieEmptySlots(struct size_tArray* a, size_t size)
+{
+  size_t i;
+  size_tArrayResize(a, size);
+  for (i = 0; i < size; i++) {
+    a->vals[i] = 0;
+  }
+  a->size = size;
+}
+
+void
+trieInit(struct trie* t)
+{
+  size_t i;
+  trieNodeArrayInit(&t->nodes, 256);
+  trieEdgeArrayInit(&t->edges, trie_edges_size);
+  for (i = 0; i < trie_edges_size; i++) {
+    t->edges.vals[i].to = 0;
+  }
+  t->edges.size = trie_edges_size;
+  t->edgeCount = 0;
+  trieValueArrayInit(&t->values, 256);
+  charArrayInit(&t->isWild, 256);
+  size_tArrayInit(&t->visited, 1);
+  trieEmptySlots(&t->visited, trie_visited_size);
+  size_tArrayInit(&t->used, trie_visited_size);
+/* the root */
+  trieAddNode(t);
+}
+
+void
+trieClean(struct trie* t)
+{
+  size_tArrayClean(&t->used);
+  size_tArrayClean(&t->visited);
+  charArrayClean(&t->isWild);
+  trieValueArrayClean(&t->values);
+  trieEdgeArrayClean(&t->edges);
+  trieNodeArrayClean(&t->nodes);
+}
+
+void
+trieSetWildcard(struct trie* t, size_t sym)
+{
+  while (t->isWild.size <= sym) {
+    charArrayAdd(&t->isWild, 0);
+  }
+  t->isWild.vals[sym] = 1;
+}
+
+static int
+trieIsWildcard(const struct trie* t, size_t sym)
+{
+  return sym < t->isWild.size && t->isWild.vals[sym];
+}
+
+static size_t
+trieHashEdge(size_t from, size_t sym)
+{
+  const size_t key[2] = {from, sym};
+  return (size_t) hash_wy64((const char*) key, sizeof(key), 0);
+}
+
+/* the slot of the edge from node through sym, or of the empty slot where */
+/* it would go */
+static struct trieEdge*
+trieFindEdge(const struct trie* t, size_t from, size_t sym)
+{
+  const size_t mask = t->edges.size - 1;
+  size_t i = trieHashEdge(from, sym) & mask;
+  while (t->edges.vals[i].to) {
+    const struct trieEdge* e = &t->edges.vals[i];
+    if (e->from == from && e->sym == sym) { break; }
+    i = (i + 1) & mask;
+  }
+  return &t->edges.vals[i];
+}
+
+/* double the size of the table and put the edges back */
+static void
+trieGrowEdges(struct trie* t)
+{
+  size_t i;
+  const size_t size = t->edges.size;
+  struct trieEdgeArray old = t->edges;
+  trieEdgeArrayInit(&t->edges, 2 * size);
+  for (i = 0; i < 2 * size; i++) {
+    t->edges.vals[i].to = 0;
+  }
+  t->edges.size = 2 * size;
+  for (i = 0; i < size; i++) {
+    const struct trieEdge* e = &old.vals[i];
+    if (e->to) { *trieFindEdge(t, e->from, e->sym) = *e; }
+  }
+  trieEdgeArrayClean(&old);
+}
+
+void
+trieAdd(struct trie* t, const size_t* key, size_t len, size_t value)
+{
+  size_t i;
+  size_t node = 0;
+  const int isCut = (len > TRIE_MAX_DEPTH);
+  if (isCut) { len = TRIE_MAX_DEPTH + 1; }
+  for (i = 0; i < len; i++) {
+    size_t next;
+    if (trieIsWildcard(t, key[i]) || i == TRIE_MAX_DEPTH) {
+      next = t->nodes.vals[node].wild;
+      if (!next) {
+        next = t->nodes.size;
+        t->nodes.vals[node].wild = next + 1;
+        trieAddNode(t);
+      } else {
+        next--;
+      }
+    } else {
+      if (2 * (t->edgeCount + 1) > t->edges.size) { trieGrowEdges(t); }
+      struct trieEdge* e = trieFindEdge(t, node, key[i]);
+      if (!e->to) {
+        e->from = node;
+        e->sym = key[i];
+        e->to = t->nodes.size;
+        t->edgeCount++;
+        trieAddNode(t);
+      }
+      next = e->to;
+    }
+    node = next;
+  }
+  struct trieValue v;
+  v.value = value;
+  v.next = t->nodes.vals[node].head;
+  trieValueArrayAdd(&t->values, v);
+  t->nodes.vals[node].head = t->values.size;
+}
+
+/* the slot of the pair in the visited set, or the empty slot where it */
+/* would go */
+static size_t
+trieFindPair(const struct trie* t, size_t pair)
+{
+  const size_t mask = t->visited.size - 1;
+  size_t i = trieHashEdge(pair, 0) & mask;
+  while (t->visited.vals[i] && t->visited.vals[i] != pair + 1) {
+    i = (i + 1) & mask;
+  }
+  return i;
+}
+
+/* add the pair to the visited set. Returns 0 if it was there */
+static int
+trieVisit(struct trie* t, size_t pair)
+{
+  size_t i;
+  if (2 * (t->used.size + 1) > t->visited.size) {
+/* double the set, turning the slots used into pairs and back */
+    for (i = 0; i < t->used.size; i++) {
+      t->used.vals[i] = t->visited.vals[t->used.vals[i]] - 1;
+    }
+    trieEmptySlots(&t->visited, 2 * t->visited.size);
+    for (i = 0; i < t->used.size; i++) {
+      const size_t slot = trieFindPair(t, t->used.vals[i]);
+      t->visited.vals[slot] = t->used.vals[i] + 1;
+      t->used.vals[i] = slot;
+    }
+  }
+  const size_t slot = trieFindPair(t, pair);
+  if (t->visited.vals[slot]) { return 0; }
+  t->visited.vals[slot] = pair + 1;
+  size_tArrayAdd(&t->used, slot);
+  return 1;
+}
+
+static void
+trieFindFrom(struct trie* t, size_t node, const size_t* str, size_t len,
+  size_t pos, struct size_tArray* found)
+{
+  size_t i;
+  if (!trieVisit(t, node * (len + 1) + pos)) { return; }
+  const struct trieNode* n = &t->nodes.vals[node];
+  if (pos == len) {
+    for (i = n->head; i; i = t->values.vals[i - 1].next) {
+      size_tArrayAdd(found, t->values.vals[i - 1].value);
+    }
+  } else {
+    const struct trieEdge* e = trieFindEdge(t, node, str[pos]);
+    if (e->to) { trieFindFrom(t, e->to, str, len, pos + 1, found); }
+  }
+/* a wildcard matches the symbols from here up to any position, or none */
+  if (n->wild) {
+    const size_t wild = n->wild - 1;
+    for (i = pos; i <= len; i++) {
+      trieFindFrom(t, wild, str, len, i, found);
+    }
+  }
+}
+
+void
+trieFind(struct trie* t, const size_t* str, size_t len,
+  struct size_tArray* found)
+{
+  size_t i;
+  trieFindFrom(t, 0, str, len, 0, found);
+  for (i = 0; i < t->used.size; i++) {
+    t->visited.vals[t->used.vals[i]] = 0;
+  }
+  t->used.size = 0;
+}
+
+static void
+trieFindSpansFrom(const struct trie* t, size_t node, size_t depth,
+  const size_t* str, const size_t* ends, size_t len, size_t pos,
+  struct size_tArray* found)
+{
+  size_t i;
+  const struct trieNode* n = &t->nodes.vals[node];
+  if (pos == len) {
+    for (i = n->head; i; i = t->values.vals[i - 1].next) {
+      size_tArrayAdd(found, t->values.vals[i - 1].value);
+    }
+  } else {
+    const struct trieEdge* e = trieFindEdge(t, node, str[pos]);
+    if (e->to) {
+      trieFindSpansFrom(t, e->to, depth + 1, str, ends, len, pos + 1, found);
+    }
+  }
+  if (!n->wild) { return; }
+/* keys are cut at the same depth, so a wildcard there ends one */
+  if (depth == TRIE_MAX_DEPTH) {
+    trieFindSpansFrom(t, n->wild - 1, depth + 1, str, ends, len, len, found);
+  } else if (pos < len) {
+    trieFindSpansFrom(t, n->wild - 1, depth + 1, str, ends, len, ends[pos],
+      found);
+  }
+}
+
+void
+trieFindSpans(const struct trie* t, const size_t* str, const size_t* ends,
+  size_t len, struct size_tArray* found)
+{
+  trieFindSpansFrom(t, 0, 0, str, ends, len, 0, found);
+}
@@ -0,0 +1,84 @@
+#ifndef _HALMOSTRIE_H_
+#define _HALMOSTRIE_H_
+#include "array.h"
+
+/* A trie of strings of symbol ids, where the symbols marked as wildcards */
+/* match any string of symbols, empty or not. It finds the keys which could */
+/* match a string, such as the conclusions of assertions which could be */
+/* unified with a statement. Keys with the same constants in the same */
+/* places share a path, so a search follows only the paths which match */
+
+struct trieNode {
+/* the values of the keys ending here, as a list in values, + 1, or 0 */
+  size_t head;
+/* the child through a wildcard + 1, or 0 */
+  size_t wild;
+};
+typedef struct trieNode trieNode;
+DECLARE_ARRAY(trieNode)
+
+/* the child of a node through a symbol. Node 0 is the root, so it is no */
+/* one's child and to is 0 in empty slots */
+struct trieEdge {
+  size_t from;
+  size_t sym;
+  size_t to;
+};
+typedef struct trieEdge trieEdge;
+DECLARE_ARRAY(trieEdge)
+
+struct trieValue {
+  size_t value;
+/* the next value of the node + 1, or 0 */
+  size_t next;
+};
+typedef struct trieValue trieValue;
+DECLARE_ARRAY(trieValue)
+
+struct trie {
+  struct trieNodeArray nodes;
+/* hashed set of edges, a power of two slots of which edgeCount are used */
+  struct trieEdgeArray edges;
+  size_t edgeCount;
+  struct trieValueArray values;
+/* for each symbol, whether it is a wildcard */
+  struct charArray isWild;
+/* scratch space of trieFind: the hashed set of (node, position) pairs */
+/* visited, holding their index + 1, and the slots used */
+  struct size_tArray visited;
+  struct size_tArray used;
+};
+
+void
+trieInit(struct trie* t);
+
+void
+trieClean(struct trie* t);
+
+/* mark sym as a wildcard in the keys added after */
+void
+trieSetWildcard(struct trie* t, size_t sym);
+
+/* add value under key[0 .. len - 1]. Long keys are cut after a few */
+/* symbols and end with a wildcard instead */
+void
+trieAdd(struct trie* t, const size_t* key, size_t len, size_t value);
+
+/* append to found the values of the keys which match str[0 .. len - 1], */
+/* once each, ignoring that a wildcard used twice in a key must match the */
+/* same string twice. The time taken is bounded by the number of nodes */
+/* reached for each position of str, not by the number of keys */
+void
+trieFind(struct trie* t, const size_t* str, size_t len,
+  struct size_tArray* found);
+
+/* the same for a string made of spans, such as a tree in preorder, where */
+/* the span at pos ends before ends[pos]. A wildcard matches the one span */
+/* where it is, and the wildcard ending a key which was cut matches the */
+/* rest. Each node is reached once at most, so nothing is changed and */
+/* threads may search at once while no keys are added */
+void
+trieFindSpans(const struct trie* t, const size_t* str, const size_t* ends,
+  size_t len, struct size_tArray* found);
+
+#endif
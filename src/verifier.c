@@ -1,6 +1,11 @@
+/* nice() is XSI, not C99 */
+#define _XOPEN_SOURCE 700
 #include "verifier.h"
 #include "hash.h"
 #include "logger.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 
 DEFINE_ARRAY(symbol)
 
@@ -23,25 +28,41 @@ symTypeString(enum symType type)
 
 const size_t symbol_none_id = 0;
 const size_t file_none_id = 0;
+static const size_t verifier_arena_block_size = 64 * 1024;
+/* initial size of the label memo. It grows for long proofs */
+static const size_t verifier_memo_size = 256;
+/* slots of the token cache. A database uses a few thousand distinct math */
+/* symbols */
+static const size_t verifier_cache_size = 4096;
+
+DEFINE_ARRAY(proofStep)
+DEFINE_ARRAY(fileStats)
+DEFINE_ARRAY(proofLoc)
 
 void
 proofInit(struct proof* prf)
 {
   symstringInit(&prf->dependencies);
-  symstringArrayInit(&prf->tags, 1);
+  proofStepArrayInit(&prf->steps, 64);
 }
 
 void
 proofClean(struct proof* prf)
 {
-  size_t i;
-  for (i = 0; i < prf->tags.size; i++) {
-    symstringClean(&prf->tags.vals[i]);
-  }
-  symstringArrayClean(&prf->tags);
+  proofStepArrayClean(&prf->steps);
   symstringClean(&prf->dependencies);
 }
 
+/* add the stats of a new file */
+static void
+verifierAddFileStats(struct verifier* vrf)
+{
+  struct fileStats stats;
+  stats.stmts = 0;
+  timerInit(&stats.proofs);
+  fileStatsArrayAdd(&vrf->stats, stats);
+}
+
 void
 verifierInit(struct verifier* vrf)
 {
@@ -53,6 +74,7 @@ verifierInit(struct verifier* vrf)
   charArrayAppend(&none.sym, "$none", 5 + 1);
   symbolArrayAdd(&vrf->symbols, none);
   symtreeInit(&vrf->tab);
+  vrf->r = NULL;
   // verifierAddSymbolExplicit(vrf, "$none", symType_none, 0, 0, 0, 0, 0, 0, 0, 0,
   //  hash_murmur3("$none", 5, 0));
   symstringArrayInit(&vrf->stmts, 1);
@@ -63,11 +85,17 @@ verifierInit(struct verifier* vrf)
   symstringInit(&vrf->hypotheses);
   symstringInit(&vrf->variables);
   symstringArrayInit(&vrf->stack, 1);
+  arenaInit(&vrf->arena, verifier_arena_block_size);
+  symmemoInit(&vrf->memo, verifier_memo_size);
+  symcacheInit(&vrf->cache, verifier_cache_size);
+  trieInit(&vrf->conclusions);
   charstringArrayInit(&vrf->files, 1);
 /* add 'none' file */
   charstringInit(&vrf->file_none);
   charArrayAppend(&vrf->file_none, "", 1);
   charstringArrayAdd(&vrf->files, vrf->file_none);
+  fileStatsArrayInit(&vrf->stats, 1);
+  verifierAddFileStats(vrf);
   vrf->rId = file_none_id;
   vrf->scope = 0;
   for (i = 0; i < symType_size; i++) {
@@ -77,20 +105,78 @@ verifierInit(struct verifier* vrf)
   vrf->errc = 0;
   vrf->verb = 1;
   vrf->hashc = 0;
+  vrf->isTimed = 0;
+  for (i = 0; i < phase_size; i++) {
+    timerInit(&vrf->timers[i]);
+  }
+  vrf->isFileTimed = 0;
+  vrf->isDeferred = 0;
+  proofLocArrayInit(&vrf->locs, 1);
+  vrf->loc.isDeferred = 0;
+  vrf->loc.state = proofState_unchecked;
+  vrf->loc.deps = 0;
+  vrf->loc.depc = 0;
+  vrf->loc.errc = 0;
+  vrf->lateThm = symbol_none_id;
+  size_tArrayInit(&vrf->deps, 1);
+  size_tArrayInit(&vrf->depStamps, 1);
+  vrf->isRdepsBuilt = 0;
+  size_tArrayInit(&vrf->rdepStarts, 1);
+  size_tArrayInit(&vrf->rdeps, 1);
+  charArrayInit(&vrf->only, 1);
+  vrf->proofc = 0;
+  vrf->isLazy = 0;
+  vrf->in = NULL;
+  vrf->fin = NULL;
+  vrf->isWorking = 0;
+  vrf->isStopping = 0;
+  vrf->isBusy = 0;
+  vrf->waiting = 0;
+  vrf->next = 0;
+  pthread_mutex_init(&vrf->lock, NULL);
+  pthread_cond_init(&vrf->cond, NULL);
+  vrf->gram = NULL;
+  vrf->isCounted = 0;
+  perfInit(&vrf->perf);
+  for (i = 0; i < phase_size; i++) {
+    perfcountInit(&vrf->counts[i]);
+  }
+  diagListInit(&vrf->diags);
 }
 
 void
 verifierClean(struct verifier* vrf)
 {
   size_t i;
+  verifierEndChecking(vrf, 0);
+  if (vrf->in) {
+    readerClean(vrf->in);
+    xfree(vrf->in);
+    fclose(vrf->fin);
+  }
+  pthread_cond_destroy(&vrf->cond);
+  pthread_mutex_destroy(&vrf->lock);
   for (i = 0; i < vrf->files.size; i++) {
     charstringClean(&vrf->files.vals[i]);
   }
   charstringArrayClean(&vrf->files);
+  fileStatsArrayClean(&vrf->stats);
+  diagListClean(&vrf->diags);
+  charArrayClean(&vrf->only);
+  size_tArrayClean(&vrf->rdeps);
+  size_tArrayClean(&vrf->rdepStarts);
+  size_tArrayClean(&vrf->depStamps);
+  size_tArrayClean(&vrf->deps);
+  proofLocArrayClean(&vrf->locs);
+  verifierSetGrammar(vrf, 0);
   for (i = 0; i < vrf->stack.size; i++) {
     symstringClean(&vrf->stack.vals[i]);
   }
   symstringArrayClean(&vrf->stack);
+  symmemoClean(&vrf->memo);
+  symcacheClean(&vrf->cache);
+  trieClean(&vrf->conclusions);
+  arenaClean(&vrf->arena);
   symstringClean(&vrf->variables);
   symstringClean(&vrf->hypotheses);
   size_tArrayClean(&vrf->disjointScope);
@@ -109,9 +195,28 @@ verifierClean(struct verifier* vrf)
     symbolClean(&vrf->symbols.vals[i]);
   }
   symbolArrayClean(&vrf->symbols);
+  perfClose(&vrf->perf);
   vrf->r = NULL;
 }
 
+/* the number of bytes of a database per symbol, statement and frame. These */
+/* are rough figures from set.mm, on the low side so we rarely reallocate */
+static const size_t verifier_bytes_per_symbol = 128;
+static const size_t verifier_bytes_per_stmt = 128;
+static const size_t verifier_bytes_per_frame = 512;
+
+void
+verifierReserve(struct verifier* vrf, size_t bytes)
+{
+  enum memtag tag = memorySetTag(memtag_symtab);
+  symbolArrayReserve(&vrf->symbols, bytes / verifier_bytes_per_symbol + 1);
+  memorySetTag(memtag_statement);
+  symstringArrayReserve(&vrf->stmts, bytes / verifier_bytes_per_stmt + 1);
+  memorySetTag(memtag_frame);
+  frameArrayReserve(&vrf->frames, bytes / verifier_bytes_per_frame + 1);
+  memorySetTag(tag);
+}
+
 void
 verifierEmptyStack(struct verifier* vrf)
 {
@@ -132,6 +237,17 @@ verifierSetError(struct verifier* vrf, enum error err)
 /* to do: add vrf->errorsum for more details on the error */
 }
 
+/* the reader hashes each token as it scans it. Reuse that hash when sym is */
+/* the current token, and hash other strings here */
+static hash_t
+verifierHashSym(const struct verifier* vrf, const char* sym)
+{
+  if (vrf->r && sym == vrf->r->tok.vals) {
+    return vrf->r->tokHash;
+  }
+  return hashString(sym, strlen(sym));
+}
+
 size_t
 verifierGetSymId(struct verifier* vrf, const char* sym)
 {
@@ -147,7 +263,14 @@ verifierGetSymId(struct verifier* vrf, const char* sym)
   //   }
   // }
 /* binary tree search */
-  uint32_t hash = hash_murmur3(sym, strlen(sym), 0);
+  return verifierGetSymIdExplicit(vrf, sym, verifierHashSym(vrf, sym));
+}
+
+size_t
+verifierGetSymIdExplicit(struct verifier* vrf, const char* sym, hash_t hash)
+{
+  size_t symId = symcacheFind(&vrf->cache, &vrf->symbols, sym, hash);
+  if (symId != symbol_none_id) { return symId; }
   struct symtree* t = symtreeFind(&vrf->tab, hash);
   if (t->node.h == hash) {
 /* this is either a match or a hash collision */
@@ -156,8 +279,11 @@ verifierGetSymId(struct verifier* vrf, const char* sym)
       const struct symbol* s = &vrf->symbols.vals[n->symId];
       if (s->isActive) {
         if (strcmp(s->sym.vals, sym) == 0) {
+          symcacheAdd(&vrf->cache, hash, n->symId);
           return n->symId;
         }
+/* same hash, different name */
+        vrf->hashc++;
       }
       n = n->next;
     }
@@ -189,6 +315,105 @@ verifierPrintSym(const struct verifier* vrf, struct charArray* msg,
   return msg->vals;
 }
 
+const char*
+verifierDiagSym(struct verifier* vrf, const struct symstring* str)
+{
+  return diagListAddSymstring(&vrf->diags, str->vals, str->size);
+}
+
+/* write len characters of s, escaped for a json string if isJson */
+static void
+verifierWriteDiagText(FILE* f, const char* s, size_t len, int isJson)
+{
+  size_t i;
+  if (!isJson) {
+    fwrite(s, 1, len, f);
+    return;
+  }
+  for (i = 0; i < len; i++) {
+    const unsigned char c = s[i];
+    if (c == '"' || c == '\\') {
+      fputc('\\', f);
+      fputc(c, f);
+    } else if (c < 0x20) {
+      fprintf(f, "\\u%04x", c);
+    } else {
+      fputc(c, f);
+    }
+  }
+}
+
+/* write the message of d, with its symbol strings in place */
+static void
+verifierWriteDiagMessage(const struct verifier* vrf, FILE* f,
+  const struct diag* d, int isJson)
+{
+  size_t i, n;
+  const char* msg = vrf->diags.text.vals + d->msg;
+  while (1) {
+    const size_t len = strcspn(msg, DIAG_SYMSTRING);
+    verifierWriteDiagText(f, msg, len, isJson);
+    msg += len;
+    if (!*msg || !msg[1]) { break; }
+    const size_t* ids = diagGetSymstring(&vrf->diags, d, msg[1] - 1, &n);
+    msg += 2;
+    for (i = 0; i < n; i++) {
+      const char* name = verifierGetSymName(vrf, ids[i]);
+      if (i > 0) { fputc(' ', f); }
+      verifierWriteDiagText(f, name, strlen(name), isJson);
+    }
+  }
+}
+
+void
+verifierPrintDiags(struct verifier* vrf, FILE* f, size_t limit,
+  int isUnique)
+{
+  size_t i;
+  const struct diagList* l = &vrf->diags;
+  diagListSort(&vrf->diags, isUnique);
+  const size_t n = (limit && limit < l->diags.size) ? limit : l->diags.size;
+  for (i = 0; i < n; i++) {
+    const struct diag* d = &l->diags.vals[i];
+    if (d->file != diag_none_file) {
+      fprintf(f, "%s:%lu:%lu ", vrf->files.vals[d->file].vals, d->line,
+        d->offset);
+    }
+    fprintf(f, "%s [%s] ", diagLevelString(d->level), errorString(d->err));
+    verifierWriteDiagMessage(vrf, f, d, 0);
+    fputc('\n', f);
+  }
+  if (n < l->diags.size) {
+    fprintf(f, "and %lu more diagnostics\n", l->diags.size - n);
+  }
+}
+
+void
+verifierWriteDiagsJson(struct verifier* vrf, FILE* f, size_t limit,
+  int isUnique)
+{
+  size_t i;
+  const struct diagList* l = &vrf->diags;
+  diagListSort(&vrf->diags, isUnique);
+  const size_t n = (limit && limit < l->diags.size) ? limit : l->diags.size;
+  fprintf(f, "[\n");
+  for (i = 0; i < n; i++) {
+    const struct diag* d = &l->diags.vals[i];
+    fprintf(f, "  {\"level\": \"%s\", \"error\": \"%s\", ",
+      diagLevelString(d->level), errorString(d->err));
+    if (d->file != diag_none_file) {
+      fprintf(f, "\"file\": \"");
+      const char* file = vrf->files.vals[d->file].vals;
+      verifierWriteDiagText(f, file, strlen(file), 1);
+      fprintf(f, "\", \"line\": %lu, \"offset\": %lu, ", d->line, d->offset);
+    }
+    fprintf(f, "\"message\": \"");
+    verifierWriteDiagMessage(vrf, f, d, 1);
+    fprintf(f, "\"}%s\n", (i + 1 < n) ? "," : "");
+  }
+  fprintf(f, "]\n");
+}
+
 const char*
 verifierPrintFrame(const struct verifier* vrf, struct charArray* msg,
   const struct frame* frm)
@@ -260,6 +485,7 @@ verifierPreprocAddFile(struct verifier* vrf, const char* filename)
   charArrayInit(&f, len);
   charArrayAppend(&f, filename, len);
   charstringArrayAdd(&vrf->files, f);
+  verifierAddFileStats(vrf);
   return vrf->files.size - 1;
 }
 
@@ -296,17 +522,19 @@ size_t
 verifierAddSymbolExplicit(struct verifier* vrf, const char* sym, 
   struct symtree* t, enum symType type, int isActive, int isTyped,
   size_t scope, size_t stmt, size_t frame, size_t file, size_t line,
-  size_t offset, uint32_t hash)
+  size_t offset, hash_t hash)
 {
   size_t symId = vrf->symbols.size;
 /* symIds begin at 1 because 0 is reserved for symbol_none_id. */
 /* symbol_none_id is used in symtree to represent empty nodes. Adding 0 */
 /* could cause a leak */
   DEBUG_ASSERT(symId != symbol_none_id, "tried adding symbol_none");
+  enum memtag tag = memorySetTag(memtag_symtab);
   struct symbol s;
   symbolInit(&s);
   size_t len = strlen(sym);
 /* append the sym and \0 */
+  charArrayReserve(&s.sym, len + 1);
   charArrayAppend(&s.sym, sym, len + 1);
   s.type = type;
   s.isActive = isActive;
@@ -320,6 +548,7 @@ verifierAddSymbolExplicit(struct verifier* vrf, const char* sym,
   symbolArrayAdd(&vrf->symbols, s);
   vrf->symCount[type]++;
   symtreeInsert(t, hash, symId);
+  memorySetTag(tag);
   return symId;
 }
 
@@ -340,7 +569,7 @@ verifierAddSymbol(struct verifier* vrf, const char* sym, enum symType type)
     }
   }
 /* determine if sym is a duplicate symbol */
-  uint32_t hash = hash_murmur3(sym, strlen(sym), 0);
+  hash_t hash = verifierHashSym(vrf, sym);
   struct symtree* t = symtreeFind(&vrf->tab, hash);
   DEBUG_ASSERT(t->node.symId < vrf->symbols.size, "invalid symId");
   const struct symbol* s = &vrf->symbols.vals[t->node.symId];
@@ -378,13 +607,39 @@ verifierAddConstant(struct verifier* vrf, const char* sym)
 size_t
 verifierAddVariable(struct verifier* vrf, const char* sym)
 {
-  return verifierAddSymbol(vrf, sym, symType_variable);
+  const size_t symId = verifierAddSymbol(vrf, sym, symType_variable);
+  if (symId != symbol_none_id) {
+    enum memtag tag = memorySetTag(memtag_symtab);
+    trieSetWildcard(&vrf->conclusions, symId);
+    memorySetTag(tag);
+  }
+  return symId;
+}
+
+/* index the statement of symId by its constants */
+static void
+verifierAddConclusion(struct verifier* vrf, size_t symId)
+{
+  if (symId == symbol_none_id) { return; }
+  const struct symstring* stmt = &vrf->stmts.vals[vrf->symbols.vals[symId].stmt];
+  enum memtag tag = memorySetTag(memtag_symtab);
+  trieAdd(&vrf->conclusions, stmt->vals, stmt->size, symId);
+  memorySetTag(tag);
+}
+
+void
+verifierFindConclusions(struct verifier* vrf, const struct symstring* str,
+  struct symstring* found)
+{
+  trieFind(&vrf->conclusions, str->vals, str->size, found);
 }
 
 size_t
 verifierAddStatement(struct verifier* vrf, struct symstring* stmt)
 {
+  enum memtag tag = memorySetTag(memtag_statement);
   symstringArrayAdd(&vrf->stmts, *stmt);
+  memorySetTag(tag);
   return vrf->stmts.size - 1;
 }
 
@@ -422,6 +677,9 @@ verifierAddFloating(struct verifier* vrf, const char* sym,
   if (stmt->size >= 2) {
     vrf->symbols.vals[stmt->vals[1]].isTyped = 1;
   }
+  if (vrf->gram && symId != symbol_none_id) {
+    grammarAddFloating(vrf->gram, vrf, symId);
+  }
   return symId;
 }
 
@@ -431,13 +689,23 @@ verifierAddEssential(struct verifier* vrf, const char* sym,
 {
   size_t symId = verifierAddSymbol(vrf, sym, symType_essential);
   vrf->symbols.vals[symId].stmt = verifierAddStatement(vrf, stmt);
+  if (vrf->gram && symId != symbol_none_id) {
+    grammarAddStatement(vrf->gram, vrf, symId);
+  }
   return symId;
 }
 
 size_t
 verifierAddFrame(struct verifier* vrf, struct frame* frm)
 {
+  enum memtag tag = memorySetTag(memtag_frame);
   frameArrayAdd(&vrf->frames, *frm);
+  proofLocArrayAdd(&vrf->locs, vrf->loc);
+  memorySetTag(tag);
+  vrf->loc.isDeferred = 0;
+  vrf->loc.state = proofState_unchecked;
+  vrf->loc.depc = 0;
+  vrf->loc.errc = 0;
   return vrf->frames.size - 1;
 }
 
@@ -451,6 +719,10 @@ verifierAddAssertion(struct verifier* vrf, const char* sym,
   frameInit(&frm);
   verifierMakeFrame(vrf, &frm, stmt);
   vrf->symbols.vals[symId].frame = verifierAddFrame(vrf, &frm);
+  verifierAddConclusion(vrf, symId);
+  if (vrf->gram && symId != symbol_none_id) {
+    grammarAddStatement(vrf->gram, vrf, symId);
+  }
   return symId;
 }
 
@@ -461,6 +733,10 @@ verifierAddProvable(struct verifier* vrf, const char* sym,
   size_t symId = verifierAddSymbol(vrf, sym, symType_provable);
   vrf->symbols.vals[symId].stmt = verifierAddStatement(vrf, stmt);
   vrf->symbols.vals[symId].frame = verifierAddFrame(vrf, frm);
+  verifierAddConclusion(vrf, symId);
+  if (vrf->gram && symId != symbol_none_id) {
+    grammarAddStatement(vrf->gram, vrf, symId);
+  }
   return symId;
 }
 
@@ -494,6 +770,7 @@ verifierDeactivateSymbols(struct verifier* vrf)
       vrf->symbols.vals[var].isTyped = 0;
     }
     sym->isActive = 0;
+    sym->end = vrf->symbols.size;
     hypotheses->size--;
   }
   struct symstring* variables = &vrf->variables;
@@ -529,6 +806,11 @@ verifierMakeFrame(struct verifier* vrf, struct frame* frm,
   const struct symstring* stmt)
 {
   size_t i;
+  verifierBeginPhase(vrf, phase_frame);
+  enum memtag tag = memorySetTag(memtag_frame);
+  size_tArrayReserve(&frm->disjoint1, vrf->disjoint1.size);
+  size_tArrayReserve(&frm->disjoint2, vrf->disjoint2.size);
+  size_tArrayReserve(&frm->stmts, vrf->hypotheses.size);
 /* add disjoints */
   for (i = 0; i < vrf->disjoint1.size; i++) {
     frameAddDisjoint(frm, vrf->disjoint1.vals[i], vrf->disjoint2.vals[i]);
@@ -558,6 +840,10 @@ verifierMakeFrame(struct verifier* vrf, struct frame* frm,
     }
   }
   symstringClean(&varset);
+/* frames are kept until the end, so don't waste the room we reserved */
+  size_tArrayShrink(&frm->stmts);
+  memorySetTag(tag);
+  verifierEndPhase(vrf, phase_frame);
 }
 
 /* From the metamath specification: */
@@ -592,9 +878,10 @@ verifierIsValidDisjointPairSubstitution(struct verifier* vrf,
   DEBUG_ASSERT(frameAreDisjoint(frm, varId1, varId2),
     "%s and %s are not disjoint", verifierGetSymName(vrf, varId1),
     verifierGetSymName(vrf, varId2));
+  struct arenaMark mark = arenaGetMark(&vrf->arena);
   struct symstring s1, s2;
-  symstringInit(&s1);
-  symstringInit(&s2);
+  symstringInitArena(&s1, sub->subs.vals[v1].size + 1, &vrf->arena);
+  symstringInitArena(&s2, sub->subs.vals[v2].size + 1, &vrf->arena);
 /* check the substitution has no common variables */
   verifierGetVariables(vrf, &s1, &sub->subs.vals[v1]);
   verifierGetVariables(vrf, &s2, &sub->subs.vals[v2]);
@@ -630,9 +917,7 @@ verifierIsValidDisjointPairSubstitution(struct verifier* vrf,
       charArrayClean(&msg);
     }
   }
-/* clean up */
-  symstringClean(&s2);
-  symstringClean(&s1);
+  arenaRelease(&vrf->arena, mark);
   return !(vrf->err);
 }
 
@@ -666,10 +951,12 @@ verifierPushSymbol(struct verifier* vrf, size_t symId)
   const struct symbol* sym = &vrf->symbols.vals[symId];
   DEBUG_ASSERT(sym->stmt < vrf->stmts.size, "invalid statement");
   const struct symstring* stmt = &vrf->stmts.vals[sym->stmt];
+  enum memtag tag = memorySetTag(memtag_stack);
   struct symstring entry;
-  symstringInit(&entry);
+  symstringInitArena(&entry, stmt->size, &vrf->arena);
   symstringAppend(&entry, stmt);
   symstringArrayAdd(&vrf->stack, entry);
+  memorySetTag(tag);
 }
 
 /* pop the top of the stack. The caller is responsible for cleaning the */
@@ -683,6 +970,7 @@ verifierPop(struct verifier* vrf)
 /* to do: ... in proof of what? */
     H_LOG_ERR(vrf, error_stackUnderflow, 1,
       "stack is empty");
+    size_tArrayInitArena(&str, 0, &vrf->arena);
     return str;
   }
   str = vrf->stack.vals[vrf->stack.size - 1];
@@ -696,31 +984,57 @@ verifierUnify(struct verifier* vrf, struct substitution* sub,
  const struct symstring* a, const struct symstring* floating)
 {
   if (floating->size != 2) {
-    struct charArray ca;
-    charArrayInit(&ca, 1);
     H_LOG_ERR(vrf, error_invalidFloatingStatement, 1,
      "cannot unify with an invalid floating statement %s",
-     verifierPrintSym(vrf, &ca, floating));
+     verifierDiagSym(vrf, floating));
     return;
   }
   DEBUG_ASSERT(a->size >= 1, "cannot unify empty string");
   if (a->vals[0] != floating->vals[0]) {
-    struct charArray ca1, ca2;
-    charArrayInit(&ca1, 1);
-    charArrayInit(&ca2, 1);
     H_LOG_ERR(vrf, error_mismatchedType, 1,
-      "cannot unify %s with %s", verifierPrintSym(vrf, &ca1, a),
-      verifierPrintSym(vrf, &ca2, floating));
-    charArrayClean(&ca1);
-    charArrayClean(&ca2);
+      "cannot unify %s with %s", verifierDiagSym(vrf, a),
+      verifierDiagSym(vrf, floating));
   }
   struct symstring str;
-  symstringInit(&str);
+  if (sub->arena) {
+    symstringInitArena(&str, a->size, sub->arena);
+  } else {
+    symstringInit(&str);
+  }
 /* get rid of the first constant symbol (the type symbol) */
   size_tArrayAppend(&str, &a->vals[1], a->size - 1);
   substitutionAdd(sub, floating->vals[1], &str);
 }
 
+/* the mark where the top argc entries of the stack begin, if they are the */
+/* last allocations in the arena, one after the other. The result of an */
+/* assertion then overwrites its arguments, so the arena only holds the */
+/* live stack. Otherwise the mark is the top of the arena */
+static struct arenaMark
+verifierGetArgsMark(struct verifier* vrf, size_t argc)
+{
+  struct arenaMark top = arenaGetMark(&vrf->arena);
+  struct arenaMark mark;
+  size_t i;
+  if (argc == 0 || argc > vrf->stack.size) { return top; }
+  const struct symstring* args = &vrf->stack.vals[vrf->stack.size - argc];
+  if (args[0].arena != &vrf->arena
+    || !arenaGetMarkAt(&vrf->arena, args[0].vals, &mark)) {
+    return top;
+  }
+  const char* p = (const char*) args[0].vals;
+  for (i = 0; i < argc; i++) {
+    if (args[i].arena != &vrf->arena || (const char*) args[i].vals != p) {
+      return top;
+    }
+    p += arenaAllocSize(sizeof(size_t) * args[i].max);
+  }
+  if ((size_t) (p - (const char*) args[0].vals) != top.used - mark.used) {
+    return top;
+  }
+  return mark;
+}
+
 /* use an assertion or a theorem. Pop the appropriate number of entries, */
 /* type-check, do unification and push the result */
 /* ctx is the frame of the theorem being proved */
@@ -736,10 +1050,12 @@ verifierApplyAssertion(struct verifier* vrf, const struct frame* ctx,
 /* frame of the assertion or theorem being applied */
   const struct frame* frm = &vrf->frames.vals[sym->frame];
   const size_t argc = frm->stmts.size;
+/* everything allocated after this is scratch, except the result */
+  struct arenaMark mark = verifierGetArgsMark(vrf, argc);
 /* we pop into this array. The last one out is the first argument to the */
 /* assertion. */
   struct symstringArray args;
-  symstringArrayInit(&args, argc);
+  symstringArrayInitArena(&args, argc + 1, &vrf->arena);
   for (i = 0; i < argc; i++) {
 /* note: popping and adding to the array causes the order of arguments to be */
 /* reversed */
@@ -751,18 +1067,19 @@ verifierApplyAssertion(struct verifier* vrf, const struct frame* ctx,
 /* hypotheses of the assertion */
 /* note: frm->stmts are in reverse order */
   struct symstringArray pats;
-  symstringArrayInit(&pats, 1);
+  symstringArrayInitArena(&pats, argc + 1, &vrf->arena);
   for (i = 0; i < argc; i++) {
-    struct symstring str;
-    symstringInit(&str);
     size_t frmSymId = frm->stmts.vals[i];
     size_t stmtId = vrf->symbols.vals[frmSymId].stmt;
+    struct symstring str;
+    symstringInitArena(&str, vrf->stmts.vals[stmtId].size, &vrf->arena);
     symstringAppend(&str, &vrf->stmts.vals[stmtId]);
     symstringArrayAdd(&pats, str);
   }
 /* create the substitution by unifying $f statements */
   struct substitution sub;
-  substitutionInit(&sub);
+  substitutionInitArena(&sub, argc, &vrf->arena);
+  verifierBeginPhase(vrf, phase_unify);
   for (i = 0; i < args.size; i++) {
     if (!verifierIsType(vrf, frm->stmts.vals[argc - 1 - i],
       symType_floating)) {
@@ -772,9 +1089,12 @@ verifierApplyAssertion(struct verifier* vrf, const struct frame* ctx,
     verifierUnify(vrf, &sub, &args.vals[args.size - 1 - i],
      &pats.vals[argc - 1 - i]);
   }
+  verifierEndPhase(vrf, phase_unify);
 /* check that the disjoint-variable restrictions are satisfied. If invalid, */
 /* vrf->err will be set */
+  verifierBeginPhase(vrf, phase_disjoint);
   verifierIsValidSubstitution(vrf, ctx, frm, &sub);
+  verifierEndPhase(vrf, phase_disjoint);
 /* apply the substitution to $e hypotheses and check if they match the args */
   for (i = 0; i < args.size; i++) {
     if (vrf->err) { break; }
@@ -782,36 +1102,40 @@ verifierApplyAssertion(struct verifier* vrf, const struct frame* ctx,
       symType_essential)) {
       continue;
     }
+    verifierBeginPhase(vrf, phase_substitution);
     substitutionApply(&sub, &pats.vals[argc - 1 - i]);
+    verifierEndPhase(vrf, phase_substitution);
     if (!symstringIsEqual(&args.vals[args.size - 1 - i],
       &pats.vals[argc - 1 - i])) {
-      struct charArray ca1, ca2;
-      charArrayInit(&ca1, 1);
-      charArrayInit(&ca2, 1);
       H_LOG_ERR(vrf, error_mismatchedEssentialHypothesis, 1,
         "the argument %s does not match hypothesis %s",
-        verifierPrintSym(vrf, &ca1, &args.vals[args.size - 1 - i]),
-        verifierPrintSym(vrf, &ca2, &pats.vals[argc - 1 - i]));
-      charArrayClean(&ca1);
-      charArrayClean(&ca2);
+        verifierDiagSym(vrf, &args.vals[args.size - 1 - i]),
+        verifierDiagSym(vrf, &pats.vals[argc - 1 - i]));
     }
   }
-/* build the result to push */
+/* build the result */
+  const struct symstring* stmt = &vrf->stmts.vals[sym->stmt];
   struct symstring res;
-  symstringInit(&res);
-  symstringAppend(&res, &vrf->stmts.vals[sym->stmt]);
+  symstringInitArena(&res, stmt->size * 2, &vrf->arena);
+  symstringAppend(&res, stmt);
+  verifierBeginPhase(vrf, phase_substitution);
   substitutionApply(&sub, &res);
-  symstringArrayAdd(&vrf->stack, res);
-/* clean up */
-  substitutionClean(&sub);
-  for (i = 0; i < pats.size; i++) {
-    symstringClean(&pats.vals[i]);
-  }
-  symstringArrayClean(&pats);
+  verifierEndPhase(vrf, phase_substitution);
+/* the popped arguments may be on the heap if they were not pushed by the */
+/* verifier. This does nothing for arguments in the arena */
   for (i = 0; i < args.size; i++) {
     symstringClean(&args.vals[i]);
   }
-  symstringArrayClean(&args);
+/* drop the scratch memory and the arguments if they were on top, and move */
+/* the result down to where it began. The regions may overlap */
+  arenaRelease(&vrf->arena, mark);
+  struct symstring entry;
+  symstringInitArena(&entry, res.size, &vrf->arena);
+  memmove(entry.vals, res.vals, sizeof(size_t) * res.size);
+  entry.size = res.size;
+  enum memtag tag = memorySetTag(memtag_stack);
+  symstringArrayAdd(&vrf->stack, entry);
+  memorySetTag(tag);
 }
 
 /* apply the label with symId to the current proof. If it is $f or $e, */
@@ -850,16 +1174,11 @@ verifierCheckProof(struct verifier* vrf, const struct symstring* thm)
   if (vrf->stack.size == 0) {
     H_LOG_ERR(vrf, error_incorrectProof, 1, "the proof is empty");
   } else if (!symstringIsEqual(&vrf->stack.vals[0], thm)) {
-    struct charArray res, theorem;
-    charArrayInit(&res, 1);
-    charArrayInit(&theorem, 1);
     H_LOG_ERR(vrf, error_incorrectProof, 1,
       "%s was derived but the proof requires %s",
-      verifierPrintSym(vrf, &res, &vrf->stack.vals[0]),
-      verifierPrintSym(vrf, &theorem, thm));
-    charArrayClean(&res);
-    charArrayClean(&theorem);
+      verifierDiagSym(vrf, &vrf->stack.vals[0]), verifierDiagSym(vrf, thm));
   }
+  if (vrf->gram) { grammarCheckProof(vrf->gram, vrf, thm); }
 }
 
 /* check all variables in the statement are typed */
@@ -888,14 +1207,17 @@ verifierParseSymbol(struct verifier* vrf, int* isEndOfStatement, char end)
   char* tok;
   vrf->err = error_none;
   *isEndOfStatement = 0;
+  verifierBeginPhase(vrf, phase_tokenize);
   readerSkip(vrf->r, whitespace);
 /* check for end of file */
   if (vrf->r->err == error_endOfString || vrf->r->err == error_endOfFile) {
+    verifierEndPhase(vrf, phase_tokenize);
     H_LOG_ERR(vrf, error_unterminatedStatement, 1,
       "reached end of file before end of statement");
     return NULL;
   }
   tok = readerGetToken(vrf->r, whitespace);
+  verifierEndPhase(vrf, phase_tokenize);
 /* check for end of statement */
   if (tok[0] == '$') {
     size_t len = strlen(tok);
@@ -920,6 +1242,20 @@ verifierParseSymbol(struct verifier* vrf, int* isEndOfStatement, char end)
   return tok;
 }
 
+size_t
+verifierParseSymId(struct verifier* vrf, int* isEndOfStatement, char end)
+{
+  const char* tok = verifierParseSymbol(vrf, isEndOfStatement, end);
+  if (vrf->err || *isEndOfStatement) { return symbol_none_id; }
+  DEBUG_ASSERT(tok, "tok is NULL");
+/* the reader hashed the token while scanning it */
+  size_t symId = verifierGetSymIdExplicit(vrf, tok, vrf->r->tokHash);
+  if (symId == symbol_none_id) {
+    H_LOG_ERR(vrf, error_undefinedSymbol, 1, "%s was not defined", tok);
+  }
+  return symId;
+}
+
 /* Parse the comment of the form '$( filename line $)' written by the */
 /* preprocessor to indicate change of file */
 void
@@ -965,20 +1301,17 @@ verifierParseStatementContent(struct verifier* vrf, struct symstring* stmt,
   char end)
 {
   vrf->err = error_none;
-  char* tok;
   int isEndOfStatement;
   size_t symId;
+  enum memtag tag = memorySetTag(memtag_statement);
   while (1) {
-    tok = verifierParseSymbol(vrf, &isEndOfStatement, end);
-    if (vrf->err) { break; }
-    DEBUG_ASSERT(tok, "tok is NULL");
+    symId = verifierParseSymId(vrf, &isEndOfStatement, end);
     if (isEndOfStatement) { break; }
-    symId = verifierGetSymId(vrf, tok);
-    if (symId == symbol_none_id) {
-      H_LOG_ERR(vrf, error_undefinedSymbol, 1, "%s was not defined", tok);
-    }
+/* undefined symbols are added as symbol_none_id, and parsing goes on */
+    if (vrf->err && vrf->err != error_undefinedSymbol) { break; }
     symstringAdd(stmt, symId);
   }
+  memorySetTag(tag);
 }
 
 void
@@ -1086,6 +1419,45 @@ verifierParseAssertion(struct verifier* vrf, struct symstring* stmt)
   verifierIsTyped(vrf, stmt);
 }
 
+/* find the label as it was at the $p statement thm: added before it, and */
+/* still in scope if it is a hypothesis */
+static size_t
+verifierGetLabelIdAt(struct verifier* vrf, const char* sym, hash_t hash,
+  size_t thm)
+{
+/* symbols still active were in scope at thm if they were added before it */
+  size_t symId = symcacheFind(&vrf->cache, &vrf->symbols, sym, hash);
+  if (symId != symbol_none_id && symId < thm) { return symId; }
+  symId = symbol_none_id;
+  const struct symtree* t = symtreeFind(&vrf->tab, hash);
+  if (t->node.h != hash) { return symbol_none_id; }
+  const struct symnode* n;
+  for (n = &t->node; n != NULL; n = n->next) {
+    if (n->symId >= thm || n->symId < symId) { continue; }
+    const struct symbol* s = &vrf->symbols.vals[n->symId];
+    if (strcmp(s->sym.vals, sym) != 0) { continue; }
+    if ((s->type == symType_floating || s->type == symType_essential)
+      && !s->isActive && s->end <= thm) {
+      continue;
+    }
+    symId = n->symId;
+  }
+  if (symId != symbol_none_id && vrf->symbols.vals[symId].isActive) {
+    symcacheAdd(&vrf->cache, hash, symId);
+  }
+  return symId;
+}
+
+/* resolve a label of the proof being read */
+static size_t
+verifierGetLabelId(struct verifier* vrf, const char* sym, hash_t hash)
+{
+  if (vrf->lateThm == symbol_none_id) {
+    return verifierGetSymIdExplicit(vrf, sym, hash);
+  }
+  return verifierGetLabelIdAt(vrf, sym, hash, vrf->lateThm);
+}
+
 /* ctx is the frame of the theorem being proved */
 void
 verifierParseProofSymbol(struct verifier* vrf, const struct frame* ctx,
@@ -1105,16 +1477,115 @@ verifierParseProofSymbol(struct verifier* vrf, const struct frame* ctx,
   verifierApplySymbolToProof(vrf, ctx, symId);
 }
 
+void
+verifierRunProof(struct verifier* vrf, const struct frame* ctx,
+  const struct proofStepArray* steps)
+{
+  size_t i;
+/* results of the tagged steps. They live in the arena like the stack, so */
+/* there is nothing to clean up */
+  struct symstringArray tags;
+  symstringArrayInitArena(&tags, 16, &vrf->arena);
+  if (vrf->gram) { grammarRunProof(vrf->gram, vrf, ctx, steps); }
+/* add the assertions applied to the row of the proof */
+  const size_t stamp = vrf->proofc + 1;
+  while (vrf->depStamps.size < vrf->symbols.size) {
+    size_tArrayAdd(&vrf->depStamps, 0);
+  }
+  for (i = 0; i < steps->size; i++) {
+    const struct proofStep* step = &steps->vals[i];
+    if (step->isTagRef || vrf->depStamps.vals[step->id] == stamp) { continue; }
+    const enum symType type = vrf->symbols.vals[step->id].type;
+    if (type == symType_assertion || type == symType_provable) {
+      vrf->depStamps.vals[step->id] = stamp;
+      size_tArrayAdd(&vrf->deps, step->id);
+    }
+  }
+/* errors are reported where the step failing was read, and the reader */
+/* is put back after */
+  struct reader* r = vrf->r;
+  const size_t line = r ? r->line : 0;
+  const size_t offset = r ? r->offset : 0;
+  for (i = 0; i < steps->size; i++) {
+    const struct proofStep* step = &steps->vals[i];
+    vrf->err = error_none;
+    if (step->line != 0) {
+      r->line = step->line;
+      r->offset = step->offset;
+    }
+    if (step->isTagRef) {
+      DEBUG_ASSERT(step->id < tags.size, "invalid tag %lu", step->id);
+      const struct symstring* tagged = &tags.vals[step->id];
+      enum memtag tag = memorySetTag(memtag_stack);
+      struct symstring entry;
+      symstringInitArena(&entry, tagged->size, &vrf->arena);
+      symstringAppend(&entry, tagged);
+      symstringArrayAdd(&vrf->stack, entry);
+      memorySetTag(tag);
+    } else {
+      verifierApplySymbolToProof(vrf, ctx, step->id);
+    }
+    if (vrf->err) { break; }
+    if (step->isTagged) {
+      const struct symstring* top = &vrf->stack.vals[vrf->stack.size - 1];
+      enum memtag tag = memorySetTag(memtag_stack);
+      struct symstring entry;
+      symstringInitArena(&entry, top->size, &vrf->arena);
+      symstringAppend(&entry, top);
+      symstringArrayAdd(&tags, entry);
+      memorySetTag(tag);
+    }
+  }
+  if (r) {
+    r->line = line;
+    r->offset = offset;
+  }
+}
+
+void
+verifierParseProofSteps(struct verifier* vrf, struct proofStepArray* steps)
+{
+  int isEndOfProof = 0;
+  struct proofStep step;
+  step.isTagRef = 0;
+  step.isTagged = 0;
+  symmemoReset(&vrf->memo);
+  while (1) {
+    const char* tok = verifierParseSymbol(vrf, &isEndOfProof, '.');
+    if (vrf->err || isEndOfProof) { break; }
+    const hash_t hash = verifierHashSym(vrf, tok);
+    size_t symId = symmemoFind(&vrf->memo, &vrf->symbols, tok, hash);
+    if (symId == symbol_none_id) {
+      symId = verifierGetLabelId(vrf, tok, hash);
+      if (symId == symbol_none_id) {
+        H_LOG_ERR(vrf, error_undefinedSymbol, 1, "%s was not defined", tok);
+        break;
+      }
+      symmemoAdd(&vrf->memo, hash, symId);
+    }
+    step.id = symId;
+    step.line = vrf->r->line;
+    step.offset = vrf->r->offset;
+    proofStepArrayAdd(steps, step);
+  }
+}
+
 /* thm is the theorem to prove */
 void
 verifierParseProof(struct verifier* vrf, const struct frame* ctx)
 {
   vrf->err = error_none;
-  int isEndOfProof = 0;
   verifierEmptyStack(vrf);
-  while (!vrf->err && !isEndOfProof) {
-    verifierParseProofSymbol(vrf, ctx, &isEndOfProof);
-  }
+  enum memtag tag = memorySetTag(memtag_stack);
+  struct proof prf;
+  proofInit(&prf);
+  memorySetTag(tag);
+  verifierParseProofSteps(vrf, &prf.steps);
+/* run the steps read before an error, like we used to do step by step */
+  enum error err = vrf->err;
+  verifierRunProof(vrf, ctx, &prf.steps);
+  if (err) { vrf->err = err; }
+  proofClean(&prf);
 }
 
 /* collect the dependencies. We are past the left parenthesis */
@@ -1131,7 +1602,7 @@ verifierParseCompressedProofHeader(struct verifier* vrf, struct proof* prf)
       break;
     }
 /* we have a label for adding to dependencies */
-    size_t symId = verifierGetSymId(vrf, tok);
+    size_t symId = verifierGetLabelId(vrf, tok, verifierHashSym(vrf, tok));
     if (symId == symbol_none_id) {
       H_LOG_ERR(vrf, error_undefinedSymbol, 1, "%s was not defined", tok);
       continue;
@@ -1190,25 +1661,26 @@ verifierParseCompressedProofNumber(struct verifier* vrf, int* isEndOfProof,
   }
 }
 
-/* ctx is the frame of the theorem being proved */
-void
-verifierParseCompressedProof(struct verifier* vrf, const struct frame* ctx)
+/* decode the steps of a compressed proof after its header into prf */
+static void
+verifierParseCompressedProofSteps(struct verifier* vrf,
+  const struct frame* ctx, struct proof* prf)
 {
-  verifierEmptyStack(vrf);
-  struct proof prf;
-  proofInit(&prf);
-  verifierParseCompressedProofHeader(vrf, &prf);
   int isEndOfProof = 0;
+/* the number of tagged steps so far */
+  size_t k = 0;
+/* set if a step could not be decoded. The steps before it are still run */
+  int isInvalid = 0;
   while (1) {
-    int isTagged = 0;
-    int isTagRef = 0;
+    struct proofStep step;
+    step.isTagRef = 0;
     size_t i =
-      verifierParseCompressedProofNumber(vrf, &isEndOfProof, &isTagged);
+      verifierParseCompressedProofNumber(vrf, &isEndOfProof, &step.isTagged);
     if (isEndOfProof) { break; }
-    size_t symId = symbol_none_id;
-    size_t k = prf.tags.size;
+    if (vrf->err == error_unterminatedCompressedProof) { break; }
+    if (isInvalid) { continue; }
     size_t m = ctx->stmts.size;
-    size_t n = prf.dependencies.size;
+    size_t n = prf->dependencies.size;
 /* decode the number. Let m be the number of mandatory hypotheses and let n */
 /* be the number of labels in the header. If 1 <= i <= m, i refers to */
 /* the i-th mandatory hypothesis. If m + 1 <= i <= m + n, i refers to the */
@@ -1216,34 +1688,121 @@ verifierParseCompressedProof(struct verifier* vrf, const struct frame* ctx)
 /* i - (m + n) th tagged step of the proof. */
     if ((1 <= i) && (i <= m)) {
 /* the frame is stored in reverse order */
-      symId = ctx->stmts.vals[m - i];
+      step.id = ctx->stmts.vals[m - i];
     } else if ((m + 1 <= i) && (i <= m + n)) {
-      symId = prf.dependencies.vals[i - (m + 1)];
+      step.id = prf->dependencies.vals[i - (m + 1)];
     } else if ((m + n + 1 <= i) && (i <= m + n + k)) {
 /* we have a tag reference */
-      isTagRef = 1;
+      step.id = i - (m + n + 1);
+      step.isTagRef = 1;
     } else {
       H_LOG_ERR(vrf, error_invalidTagReferenceInCompressedProof, 1,
         "the compressed proof contains an invalid reference");
+      isInvalid = 1;
+      continue;
     }
-    if (symId != symbol_none_id) {
-      verifierApplySymbolToProof(vrf, ctx, symId);
-    } else if (isTagRef) {
-/* push the symstring to the stack */
-      struct symstring tag;
-      symstringInit(&tag);
-      symstringAppend(&tag, &prf.tags.vals[i - (m + n + 1)]);
-      symstringArrayAdd(&vrf->stack, tag);
+    if (step.isTagged) { k++; }
+    step.line = vrf->r->line;
+    step.offset = vrf->r->offset;
+    proofStepArrayAdd(&prf->steps, step);
+  }
+}
+
+/* ctx is the frame of the theorem being proved */
+void
+verifierParseCompressedProof(struct verifier* vrf, const struct frame* ctx)
+{
+  verifierEmptyStack(vrf);
+  enum memtag old = memorySetTag(memtag_stack);
+  struct proof prf;
+  proofInit(&prf);
+  memorySetTag(old);
+  verifierParseCompressedProofHeader(vrf, &prf);
+  verifierParseCompressedProofSteps(vrf, ctx, &prf);
+  enum error err = vrf->err;
+  verifierRunProof(vrf, ctx, &prf.steps);
+  if (err) { vrf->err = err; }
+  proofClean(&prf);
+}
+
+/* the state is read by verifierGetProofState without taking the verifier */
+static void
+verifierSetProofState(struct verifier* vrf, struct proofLoc* loc,
+  enum proofState state)
+{
+  pthread_mutex_lock(&vrf->lock);
+  loc->state = state;
+  pthread_mutex_unlock(&vrf->lock);
+}
+
+/* read the proof of thm from after the $= and check it, setting the state */
+/* and the row of assertions applied in loc */
+static void
+verifierParseProofOf(struct verifier* vrf, const struct symstring* thm,
+  const struct frame* ctx, struct proofLoc* loc)
+{
+  const size_t errc = vrf->errc;
+  const size_t deps = vrf->deps.size;
+  struct timer* t = &vrf->stats.vals[vrf->rId].proofs;
+  if (vrf->isFileTimed) { timerStart(t); }
+/* check if we have a compressed proof */
+  readerSkip(vrf->r, whitespace);
+  if (readerPeek(vrf->r) == '(') {
+/* get rid of the ( */
+    readerGet(vrf->r);
+    verifierParseCompressedProof(vrf, ctx);
+  } else {
+    verifierParseProof(vrf, ctx);
+  }
+  verifierCheckProof(vrf, thm);
+  if (vrf->isFileTimed) { timerStop(t); }
+/* the stack and all scratch memory of the proof are in the arena */
+  verifierEmptyStack(vrf);
+  arenaReset(&vrf->arena);
+  vrf->proofc++;
+  verifierSetProofState(vrf, loc,
+    (vrf->errc == errc) ? proofState_verified : proofState_failed);
+  loc->deps = deps;
+  loc->depc = vrf->deps.size - deps;
+  loc->errc = vrf->errc - errc;
+  vrf->isRdepsBuilt = 0;
+}
+
+void
+verifierSkipProof(struct verifier* vrf)
+{
+  struct reader* r = vrf->r;
+  int isDollar = 0;
+  while (1) {
+/* jump to the next $ without looking at the steps in between */
+    if (!isDollar) { readerGetRun(r, '$', NULL); }
+    const int c = readerGet(r);
+    if (r->err) {
+      H_LOG_ERR(vrf, error_unterminatedStatement, 1,
+        "reached end of file before $.");
+      return;
     }
-    if (isTagged) {
-/* add the current result to the tagged list */
-      struct symstring tag;
-      symstringInit(&tag);
-      symstringAppend(&tag, &vrf->stack.vals[vrf->stack.size - 1]);
-      symstringArrayAdd(&prf.tags, tag);
+    if (isDollar && c == '.') {
+      r->last = c;
+      return;
     }
+    isDollar = (c == '$');
   }
-  proofClean(&prf);
+}
+
+/* record in loc where the proof after the $= is, and skip it */
+static void
+verifierLocateProof(struct verifier* vrf, struct proofLoc* loc)
+{
+  readerSkip(vrf->r, whitespace);
+  loc->isDeferred = 1;
+  loc->pos = readerTell(vrf->r);
+  loc->file = vrf->rId;
+  loc->line = vrf->r->line;
+/* the character put back by readerSkip was counted */
+  loc->offset = vrf->r->offset - (vrf->r->didSkip ? 1 : 0);
+  verifierSkipProof(vrf);
+  loc->end = readerTell(vrf->r) - 2;
 }
 
 void
@@ -1253,16 +1812,816 @@ verifierParseProvable(struct verifier* vrf, struct symstring* stmt,
   verifierParseStatementContent(vrf, stmt, '=');
   verifierIsTyped(vrf, stmt);
   verifierMakeFrame(vrf, ctx, stmt);
-/* check if we have a compressed proof */
+  if (!vrf->isDeferred) {
+    verifierParseProofOf(vrf, stmt, ctx, &vrf->loc);
+    return;
+  }
+/* remember where the proof is, for verifierCheckLate */
+  verifierLocateProof(vrf, &vrf->loc);
+}
+
+/* wait for the verifier to be free and take it. Queries go before the */
+/* background worker */
+static void
+verifierAcquire(struct verifier* vrf, int isBackground)
+{
+  pthread_mutex_lock(&vrf->lock);
+  if (!isBackground) { vrf->waiting++; }
+  while (vrf->isBusy || (isBackground && vrf->waiting > 0)) {
+    pthread_cond_wait(&vrf->cond, &vrf->lock);
+  }
+  if (!isBackground) { vrf->waiting--; }
+  vrf->isBusy = 1;
+  pthread_mutex_unlock(&vrf->lock);
+}
+
+static void
+verifierRelease(struct verifier* vrf)
+{
+  pthread_mutex_lock(&vrf->lock);
+  vrf->isBusy = 0;
+  pthread_cond_broadcast(&vrf->cond);
+  pthread_mutex_unlock(&vrf->lock);
+}
+
+/* verifierCheckLate for the caller which has the verifier */
+static enum proofState
+verifierCheckDeferred(struct verifier* vrf, size_t symId)
+{
+  DEBUG_ASSERT(verifierIsType(vrf, symId, symType_provable),
+    "%s is not a $p statement", verifierGetSymName(vrf, symId));
+  const struct symbol* sym = &vrf->symbols.vals[symId];
+  struct proofLoc* loc = &vrf->locs.vals[sym->frame];
+  if (!loc->isDeferred || loc->state != proofState_unchecked) {
+    return loc->state;
+  }
+  const size_t rId = vrf->rId;
+  vrf->rId = loc->file;
+  readerSeek(vrf->r, loc->pos, loc->line, loc->offset);
+  vrf->lateThm = symId;
+/* the diagnostics are keyed by the theorem, for verifierRecheck */
+  vrf->diags.key = symId;
+  verifierParseProofOf(vrf, &vrf->stmts.vals[sym->stmt],
+    &vrf->frames.vals[sym->frame], loc);
+  vrf->diags.key = symbol_none_id;
+  vrf->lateThm = symbol_none_id;
+  vrf->rId = rId;
+  return loc->state;
+}
+
+int
+verifierReadProof(struct verifier* vrf, size_t symId, struct proof* prf)
+{
+  DEBUG_ASSERT(verifierIsType(vrf, symId, symType_provable),
+    "%s is not a $p statement", verifierGetSymName(vrf, symId));
+  const struct symbol* sym = &vrf->symbols.vals[symId];
+  const struct proofLoc* loc = &vrf->locs.vals[sym->frame];
+  if (!loc->isDeferred || !vrf->r) { return 0; }
+  verifierAcquire(vrf, 0);
+  const size_t errc = vrf->errc;
+  const size_t rId = vrf->rId;
+  vrf->rId = loc->file;
+  readerSeek(vrf->r, loc->pos, loc->line, loc->offset);
+  vrf->lateThm = symId;
+  vrf->err = error_none;
   readerSkip(vrf->r, whitespace);
   if (readerPeek(vrf->r) == '(') {
-/* get rid of the ( */
     readerGet(vrf->r);
-    verifierParseCompressedProof(vrf, ctx);
+    verifierParseCompressedProofHeader(vrf, prf);
+    verifierParseCompressedProofSteps(vrf, &vrf->frames.vals[sym->frame],
+      prf);
   } else {
-    verifierParseProof(vrf, ctx);
+    verifierParseProofSteps(vrf, &prf->steps);
+  }
+  vrf->lateThm = symbol_none_id;
+  vrf->rId = rId;
+  verifierRelease(vrf);
+  return vrf->errc == errc;
+}
+
+int
+verifierIsProof(struct verifier* vrf, size_t symId,
+  const struct proofStepArray* steps)
+{
+  size_t i;
+  DEBUG_ASSERT(verifierIsType(vrf, symId, symType_provable),
+    "%s is not a $p statement", verifierGetSymName(vrf, symId));
+  const struct symbol* sym = &vrf->symbols.vals[symId];
+  verifierAcquire(vrf, 0);
+  const size_t errc = vrf->errc;
+  const size_t diags = vrf->diags.diags.size;
+  const size_t deps = vrf->deps.size;
+/* the tree check would count the proof */
+  struct grammar* g = vrf->gram;
+  vrf->gram = NULL;
+  verifierEmptyStack(vrf);
+  verifierRunProof(vrf, &vrf->frames.vals[sym->frame], steps);
+  verifierCheckProof(vrf, &vrf->stmts.vals[sym->stmt]);
+  const int isProof = (vrf->errc == errc);
+  verifierEmptyStack(vrf);
+  arenaReset(&vrf->arena);
+  vrf->gram = g;
+/* forget the errors and the row of the steps. The stamps are cleared, */
+/* as the next proof checked has the same */
+  vrf->errc = errc;
+  vrf->err = error_none;
+  diagListDrop(&vrf->diags, diags);
+  vrf->deps.size = deps;
+  for (i = 0; i < steps->size; i++) {
+    const struct proofStep* step = &steps->vals[i];
+    if (!step->isTagRef) { vrf->depStamps.vals[step->id] = 0; }
+  }
+  verifierRelease(vrf);
+  return isProof;
+}
+
+enum proofState
+verifierCheckLate(struct verifier* vrf, size_t symId)
+{
+  verifierAcquire(vrf, 0);
+  const enum proofState state = verifierCheckDeferred(vrf, symId);
+  verifierRelease(vrf);
+  return state;
+}
+
+void
+verifierCheckRange(struct verifier* vrf, size_t first, size_t last)
+{
+  size_t i;
+  verifierAcquire(vrf, 0);
+  for (i = first; i <= last && i < vrf->symbols.size; i++) {
+    if (verifierIsType(vrf, i, symType_provable)) {
+      verifierCheckDeferred(vrf, i);
+    }
+  }
+  verifierRelease(vrf);
+}
+
+enum proofState
+verifierGetProofState(struct verifier* vrf, size_t symId)
+{
+  DEBUG_ASSERT(verifierIsType(vrf, symId, symType_provable),
+    "%s is not a $p statement", verifierGetSymName(vrf, symId));
+  pthread_mutex_lock(&vrf->lock);
+  const enum proofState state =
+    vrf->locs.vals[vrf->symbols.vals[symId].frame].state;
+  pthread_mutex_unlock(&vrf->lock);
+  return state;
+}
+
+size_t
+verifierCountProofs(struct verifier* vrf, enum proofState state)
+{
+  size_t i;
+  size_t count = 0;
+  for (i = 0; i < vrf->symbols.size; i++) {
+    if (verifierIsType(vrf, i, symType_provable)
+      && verifierGetProofState(vrf, i) == state) {
+      count++;
+    }
+  }
+  return count;
+}
+
+/* verifierGetDeps for the caller which has the verifier */
+static const size_t*
+verifierFindDeps(struct verifier* vrf, size_t symId, size_t* n)
+{
+  DEBUG_ASSERT(verifierIsType(vrf, symId, symType_provable),
+    "%s is not a $p statement", verifierGetSymName(vrf, symId));
+  const struct proofLoc* loc = &vrf->locs.vals[vrf->symbols.vals[symId].frame];
+  if (loc->state == proofState_unchecked) {
+    *n = 0;
+    return NULL;
+  }
+  *n = loc->depc;
+  return vrf->deps.vals + loc->deps;
+}
+
+/* count the users of each symbol, then put them in place in order */
+static void
+verifierBuildRdeps(struct verifier* vrf)
+{
+  size_t i, j;
+  const size_t size = vrf->symbols.size;
+  struct size_tArray* starts = &vrf->rdepStarts;
+  starts->size = 0;
+  for (i = 0; i <= size; i++) {
+    size_tArrayAdd(starts, 0);
+  }
+  for (i = 0; i < size; i++) {
+    if (!verifierIsType(vrf, i, symType_provable)) { continue; }
+    const struct proofLoc* loc = &vrf->locs.vals[vrf->symbols.vals[i].frame];
+    if (loc->state == proofState_unchecked) { continue; }
+    for (j = 0; j < loc->depc; j++) {
+      starts->vals[vrf->deps.vals[loc->deps + j] + 1]++;
+    }
+  }
+  for (i = 0; i < size; i++) {
+    starts->vals[i + 1] += starts->vals[i];
+  }
+  vrf->rdeps.size = 0;
+  for (i = 0; i < starts->vals[size]; i++) {
+    size_tArrayAdd(&vrf->rdeps, 0);
+  }
+/* starts[k] moves to the end of row k while it is filled, and is shifted */
+/* back afterwards */
+  for (i = 0; i < size; i++) {
+    if (!verifierIsType(vrf, i, symType_provable)) { continue; }
+    const struct proofLoc* loc = &vrf->locs.vals[vrf->symbols.vals[i].frame];
+    if (loc->state == proofState_unchecked) { continue; }
+    for (j = 0; j < loc->depc; j++) {
+      vrf->rdeps.vals[starts->vals[vrf->deps.vals[loc->deps + j]]++] = i;
+    }
+  }
+  for (i = size; i > 0; i--) {
+    starts->vals[i] = starts->vals[i - 1];
+  }
+  starts->vals[0] = 0;
+  vrf->isRdepsBuilt = 1;
+}
+
+/* verifierGetRdeps for the caller which has the verifier */
+static const size_t*
+verifierFindRdeps(struct verifier* vrf, size_t symId, size_t* n)
+{
+  if (!vrf->isRdepsBuilt || vrf->rdepStarts.size != vrf->symbols.size + 1) {
+    verifierBuildRdeps(vrf);
+  }
+  const size_t first = vrf->rdepStarts.vals[symId];
+  *n = vrf->rdepStarts.vals[symId + 1] - first;
+  return vrf->rdeps.vals + first;
+}
+
+/* the worker adds rows to deps, which can move them */
+const size_t*
+verifierGetDeps(struct verifier* vrf, size_t symId, size_t* n)
+{
+  if (vrf->isWorking) {
+    *n = 0;
+    return NULL;
+  }
+  return verifierFindDeps(vrf, symId, n);
+}
+
+const size_t*
+verifierGetRdeps(struct verifier* vrf, size_t symId, size_t* n)
+{
+  if (vrf->isWorking) {
+    *n = 0;
+    return NULL;
+  }
+  return verifierFindRdeps(vrf, symId, n);
+}
+
+/* scratch space to canonicalize assertions. For each symbol, the token */
+/* of a variable renamed, or 0, and for each type code, the variables of */
+/* that type renamed so far */
+struct verifierCanon {
+  struct size_tArray tokens;
+  struct size_tArray counts;
+  struct size_tArray pairs;
+};
+
+/* order pairs of size_t */
+static int
+verifierComparePairs(const void* a, const void* b)
+{
+  const size_t* x = a;
+  const size_t* y = b;
+  if (x[0] != y[0]) { return (x[0] < y[0]) ? -1 : 1; }
+  if (x[1] != y[1]) { return (x[1] < y[1]) ? -1 : 1; }
+  return 0;
+}
+
+/* append the tokens of the statement to str, renaming its variables */
+static void
+verifierCanonStatement(const struct verifier* vrf, struct verifierCanon* c,
+  const struct symstring* stmt, const struct size_tArray* types,
+  struct size_tArray* str)
+{
+  size_t i;
+  const size_t size = vrf->symbols.size;
+  for (i = 0; i < stmt->size; i++) {
+    const size_t sym = stmt->vals[i];
+    if (vrf->symbols.vals[sym].type != symType_variable) {
+      size_tArrayAdd(str, sym);
+      continue;
+    }
+/* the k-th variable of type code t is the token size * (k + 1) + t, which */
+/* is not a symbol */
+    if (c->tokens.vals[sym] == 0) {
+      const size_t type = types->vals[sym];
+      c->tokens.vals[sym] = size * (c->counts.vals[type] + 1) + type;
+      c->counts.vals[type]++;
+    }
+    size_tArrayAdd(str, c->tokens.vals[sym]);
+  }
+/* symbol_none_id ends each statement */
+  size_tArrayAdd(str, symbol_none_id);
+}
+
+/* put in str the canonical form of the $a or $p statement symId: its */
+/* essential hypotheses in order and its statement, with the variables */
+/* renamed in order of first occurrence within each type code, then its */
+/* disjoint variable restrictions between them, sorted. types holds the */
+/* type code of each variable of the frame, and is left unchanged */
+static void
+verifierCanonicalize(const struct verifier* vrf, struct verifierCanon* c,
+  size_t symId, struct size_tArray* types, struct size_tArray* str)
+{
+  size_t i;
+  const struct symbol* sym = &vrf->symbols.vals[symId];
+  const struct frame* frm = &vrf->frames.vals[sym->frame];
+  str->size = 0;
+/* the frame is in reverse order */
+  for (i = frm->stmts.size; i > 0; i--) {
+    const struct symbol* hyp = &vrf->symbols.vals[frm->stmts.vals[i - 1]];
+    const struct symstring* stmt = &vrf->stmts.vals[hyp->stmt];
+    if (hyp->type == symType_floating) {
+      types->vals[stmt->vals[1]] = stmt->vals[0];
+    }
+  }
+  for (i = frm->stmts.size; i > 0; i--) {
+    const struct symbol* hyp = &vrf->symbols.vals[frm->stmts.vals[i - 1]];
+    if (hyp->type == symType_essential) {
+      verifierCanonStatement(vrf, c, &vrf->stmts.vals[hyp->stmt], types, str);
+    }
+  }
+  verifierCanonStatement(vrf, c, &vrf->stmts.vals[sym->stmt], types, str);
+/* the restrictions in scope between variables of the assertion */
+  c->pairs.size = 0;
+  for (i = 0; i < frm->disjoint1.size; i++) {
+    const size_t t1 = c->tokens.vals[frm->disjoint1.vals[i]];
+    const size_t t2 = c->tokens.vals[frm->disjoint2.vals[i]];
+    if (t1 == 0 || t2 == 0) { continue; }
+    size_tArrayAdd(&c->pairs, (t1 < t2) ? t1 : t2);
+    size_tArrayAdd(&c->pairs, (t1 < t2) ? t2 : t1);
+  }
+  qsort(c->pairs.vals, c->pairs.size / 2, 2 * sizeof(size_t),
+    verifierComparePairs);
+  for (i = 0; i < c->pairs.size; i += 2) {
+    if (i > 0 && c->pairs.vals[i] == c->pairs.vals[i - 2]
+      && c->pairs.vals[i + 1] == c->pairs.vals[i - 1]) {
+      continue;
+    }
+    size_tArrayAppend(str, c->pairs.vals + i, 2);
+  }
+/* reset the scratch space through the $f statements of the frame */
+  for (i = 0; i < frm->stmts.size; i++) {
+    const struct symbol* hyp = &vrf->symbols.vals[frm->stmts.vals[i]];
+    if (hyp->type != symType_floating) { continue; }
+    const struct symstring* stmt = &vrf->stmts.vals[hyp->stmt];
+    c->tokens.vals[stmt->vals[1]] = 0;
+    c->counts.vals[stmt->vals[0]] = 0;
+  }
+}
+
+/* hash the canonical form of every assertion and sort them by hash, then */
+/* split the runs of equal hashes into groups of equal forms */
+size_t
+verifierFindDuplicates(struct verifier* vrf, struct size_tArray* found)
+{
+  size_t i, j, k;
+  const size_t size = vrf->symbols.size;
+  struct verifierCanon c;
+  struct size_tArray types, str, other, hashes, groups;
+  size_tArrayInit(&c.tokens, size);
+  size_tArrayInit(&c.counts, size);
+  size_tArrayInit(&types, size);
+  for (i = 0; i < size; i++) {
+    size_tArrayAdd(&c.tokens, 0);
+    size_tArrayAdd(&c.counts, 0);
+    size_tArrayAdd(&types, 0);
+  }
+  size_tArrayInit(&c.pairs, 16);
+  size_tArrayInit(&str, 64);
+  size_tArrayInit(&other, 64);
+/* pairs of hash and symId */
+  size_tArrayInit(&hashes, 2 * vrf->symCount[symType_assertion]
+    + 2 * vrf->symCount[symType_provable] + 2);
+  for (i = 0; i < size; i++) {
+    if (!verifierIsType(vrf, i, symType_assertion)
+      && !verifierIsType(vrf, i, symType_provable)) {
+      continue;
+    }
+    verifierCanonicalize(vrf, &c, i, &types, &str);
+    size_tArrayAdd(&hashes, (size_t) hash_wy64((const char*) str.vals,
+      str.size * sizeof(size_t), 0));
+    size_tArrayAdd(&hashes, i);
+  }
+  const size_t count = hashes.size / 2;
+  qsort(hashes.vals, count, 2 * sizeof(size_t), verifierComparePairs);
+/* pairs of the first assertion of the group and the assertion. Those */
+/* grouped are taken out of the run by setting their symId to none */
+  size_tArrayInit(&groups, 16);
+  for (i = 0; i < count; i = j) {
+    for (j = i + 1; j < count && hashes.vals[2 * j] == hashes.vals[2 * i];
+      j++) {}
+    if (j - i < 2) { continue; }
+    for (k = i; k < j; k++) {
+      const size_t first = hashes.vals[2 * k + 1];
+      if (first == symbol_none_id) { continue; }
+      verifierCanonicalize(vrf, &c, first, &types, &str);
+      size_t n;
+      const size_t start = groups.size;
+      for (n = k + 1; n < j; n++) {
+        const size_t symId = hashes.vals[2 * n + 1];
+        if (symId == symbol_none_id) { continue; }
+        verifierCanonicalize(vrf, &c, symId, &types, &other);
+        if (other.size != str.size || memcmp(other.vals, str.vals,
+          str.size * sizeof(size_t)) != 0) {
+          continue;
+        }
+        size_tArrayAdd(&groups, first);
+        size_tArrayAdd(&groups, symId);
+        hashes.vals[2 * n + 1] = symbol_none_id;
+      }
+      if (groups.size > start) {
+        size_tArrayAdd(&groups, first);
+        size_tArrayAdd(&groups, first);
+      }
+    }
+  }
+/* the groups in order of their first assertion, each ended by */
+/* symbol_none_id */
+  qsort(groups.vals, groups.size / 2, 2 * sizeof(size_t),
+    verifierComparePairs);
+  size_t groupc = 0;
+  for (i = 0; i < groups.size; i += 2) {
+    if (i == 0 || groups.vals[i] != groups.vals[i - 2]) {
+      if (i > 0) { size_tArrayAdd(found, symbol_none_id); }
+      groupc++;
+    }
+    size_tArrayAdd(found, groups.vals[i + 1]);
+  }
+  if (groups.size > 0) { size_tArrayAdd(found, symbol_none_id); }
+  size_tArrayClean(&groups);
+  size_tArrayClean(&hashes);
+  size_tArrayClean(&other);
+  size_tArrayClean(&str);
+  size_tArrayClean(&c.pairs);
+  size_tArrayClean(&types);
+  size_tArrayClean(&c.counts);
+  size_tArrayClean(&c.tokens);
+  return groupc;
+}
+
+/* verifierGetCone for the caller which has the verifier */
+static void
+verifierAddCone(struct verifier* vrf, size_t symId, struct symstring* cone)
+{
+  size_t i, j, n;
+  struct charArray isIn;
+  charArrayInit(&isIn, vrf->symbols.size);
+  for (i = 0; i < vrf->symbols.size; i++) {
+    charArrayAdd(&isIn, 0);
+  }
+  for (i = 0; i < cone->size; i++) {
+    isIn.vals[cone->vals[i]] = 1;
+  }
+/* breadth first from symId, then from each $p statement added */
+  size_t next = cone->size;
+  size_t from = symId;
+  while (1) {
+    const size_t* rdeps = verifierFindRdeps(vrf, from, &n);
+    for (j = 0; j < n; j++) {
+      if (isIn.vals[rdeps[j]]) { continue; }
+      isIn.vals[rdeps[j]] = 1;
+      symstringAdd(cone, rdeps[j]);
+    }
+    if (next == cone->size) { break; }
+    from = cone->vals[next++];
+  }
+  charArrayClean(&isIn);
+}
+
+void
+verifierGetCone(struct verifier* vrf, size_t symId, struct symstring* cone)
+{
+  verifierAcquire(vrf, 0);
+  verifierAddCone(vrf, symId, cone);
+  verifierRelease(vrf);
+}
+
+/* find the proofs again from the start of the input of vrf->r, after it */
+/* changed. The $p statements are found by their labels, and those which */
+/* are gone are failed */
+static void
+verifierRelocateProofs(struct verifier* vrf)
+{
+  size_t i;
+  struct reader* r = vrf->r;
+  const size_t rId = vrf->rId;
+  vrf->rId = file_none_id;
+  struct charArray isFound;
+  charArrayInit(&isFound, vrf->symbols.size);
+  for (i = 0; i < vrf->symbols.size; i++) {
+    charArrayAdd(&isFound, 0);
+  }
+/* the token before the keyword, which is the label of a $p statement */
+  struct charArray label;
+  charArrayInit(&label, 16);
+  charArrayAdd(&label, '\0');
+  while (1) {
+    readerSkip(r, whitespace);
+    const char* tok = readerGetToken(r, whitespace);
+    if (r->err) { break; }
+    if (strcmp(tok, "$(") == 0) {
+      verifierParsePreprocFile(vrf);
+      continue;
+    }
+    if (strcmp(tok, "$p") != 0) {
+      label.size = 0;
+      charArrayAppend(&label, tok, strlen(tok) + 1);
+      continue;
+    }
+    const size_t symId = verifierGetLabelIdAt(vrf, label.vals,
+      hashString(label.vals, label.size - 1), vrf->symbols.size);
+    while (1) {
+      readerSkip(r, whitespace);
+      tok = readerGetToken(r, whitespace);
+      if (r->err || strcmp(tok, "$=") == 0) { break; }
+    }
+    if (r->err) { break; }
+    if (symId == symbol_none_id
+      || !verifierIsType(vrf, symId, symType_provable)) {
+      verifierSkipProof(vrf);
+      continue;
+    }
+    struct proofLoc* loc = &vrf->locs.vals[vrf->symbols.vals[symId].frame];
+    verifierLocateProof(vrf, loc);
+    isFound.vals[symId] = 1;
+  }
+  for (i = 0; i < vrf->symbols.size; i++) {
+    if (!verifierIsType(vrf, i, symType_provable) || isFound.vals[i]) {
+      continue;
+    }
+    struct proofLoc* loc = &vrf->locs.vals[vrf->symbols.vals[i].frame];
+    if (!loc->isDeferred) { continue; }
+    loc->isDeferred = 0;
+    vrf->errc -= loc->errc;
+    diagListRemove(&vrf->diags, i);
+    vrf->diags.key = i;
+    G_LOG_ERR(vrf, error_undefinedSymbol, "the proof of %s is gone",
+      verifierGetSymName(vrf, i));
+    vrf->diags.key = symbol_none_id;
+    loc->errc = 1;
+    loc->depc = 0;
+    verifierSetProofState(vrf, loc, proofState_failed);
+  }
+  vrf->isRdepsBuilt = 0;
+  charArrayClean(&label);
+  charArrayClean(&isFound);
+  vrf->rId = rId;
+}
+
+/* the next token of r outside comments, or NULL at the end. The steps of */
+/* a proof are skipped, so $= is followed by the $. ending it */
+static const char*
+verifierGetStatementToken(struct reader* r)
+{
+  int isComment = 0;
+  int isProof = 0;
+  while (1) {
+    readerSkip(r, whitespace);
+    const char* tok = readerGetToken(r, whitespace);
+    if (r->err) { return NULL; }
+    if (isComment) {
+      if (strcmp(tok, "$)") == 0) { isComment = 0; }
+    } else if (strcmp(tok, "$(") == 0) {
+      isComment = 1;
+    } else if (strcmp(tok, "$=") == 0) {
+      isProof = 1;
+    } else if (!isProof || strcmp(tok, "$.") == 0) {
+      return tok;
+    }
+  }
+}
+
+/* compare the input read before with r, from their starts, outside the */
+/* proofs. Returns 0 if they differ, with *line the line in r where */
+static int
+verifierIsSameOutsideProofs(struct reader* old, struct reader* r,
+  size_t* line)
+{
+  struct charArray tok;
+  charArrayInit(&tok, 16);
+  readerSeek(old, 0, 1, 0);
+  readerSeek(r, 0, 1, 0);
+  int isSame = 1;
+  while (1) {
+    const char* a = verifierGetStatementToken(old);
+    tok.size = 0;
+    if (a) { charArrayAppend(&tok, a, strlen(a) + 1); }
+    const char* b = verifierGetStatementToken(r);
+    if (!a || !b) {
+      isSame = !a && !b;
+      break;
+    }
+    if (strcmp(tok.vals, b) != 0) {
+      isSame = 0;
+      break;
+    }
+  }
+  *line = r->line;
+  charArrayClean(&tok);
+  return isSame;
+}
+
+/* a row of deps which does not fit where the old one was is added at the */
+/* end. Once the rows left behind make up more than half of deps, the rows */
+/* in use are copied together */
+static void
+verifierCompactDeps(struct verifier* vrf)
+{
+  size_t i, used = 0;
+  for (i = 0; i < vrf->locs.size; i++) {
+    used += vrf->locs.vals[i].depc;
+  }
+  if (vrf->deps.size <= 2 * used) { return; }
+  struct size_tArray deps;
+  size_tArrayInit(&deps, used + 1);
+  for (i = 0; i < vrf->locs.size; i++) {
+    struct proofLoc* loc = &vrf->locs.vals[i];
+    const size_t at = deps.size;
+    size_tArrayAppend(&deps, vrf->deps.vals + loc->deps, loc->depc);
+    loc->deps = at;
+  }
+  size_tArrayClean(&vrf->deps);
+  vrf->deps = deps;
+}
+
+size_t
+verifierRecheck(struct verifier* vrf, size_t symId, struct reader* r)
+{
+  size_t i;
+  size_t failed = 0;
+  struct symstring cone;
+  symstringInit(&cone);
+  verifierAcquire(vrf, 0);
+  if (r) {
+/* the statements and frames are those read first, so they must not have */
+/* changed */
+    size_t line = 0;
+    if (!vrf->r || !verifierIsSameOutsideProofs(vrf->r, r, &line)) {
+      G_LOG_ERR(vrf, error_changedStatement, "the input changed outside "
+        "the proofs at line %lu, so it must be read again", line);
+      verifierRelease(vrf);
+      symstringClean(&cone);
+      return 0;
+    }
+    readerSeek(r, 0, 1, 0);
+    vrf->r = r;
+    verifierRelocateProofs(vrf);
+  }
+  if (verifierIsType(vrf, symId, symType_provable)) {
+    symstringAdd(&cone, symId);
+  }
+  verifierAddCone(vrf, symId, &cone);
+  for (i = 0; i < cone.size; i++) {
+    const size_t thm = cone.vals[i];
+    struct proofLoc* loc = &vrf->locs.vals[vrf->symbols.vals[thm].frame];
+    if (!loc->isDeferred) { continue; }
+/* forget what the last check found */
+    const size_t deps = loc->deps;
+    const size_t depc = loc->depc;
+    vrf->errc -= loc->errc;
+    diagListRemove(&vrf->diags, thm);
+    verifierSetProofState(vrf, loc, proofState_unchecked);
+    if (verifierCheckDeferred(vrf, thm) == proofState_failed) {
+      failed++;
+    }
+/* the new row goes in place of the old one if it fits */
+    if (loc->depc <= depc) {
+      memmove(vrf->deps.vals + deps, vrf->deps.vals + loc->deps,
+        loc->depc * sizeof(size_t));
+      vrf->deps.size = loc->deps;
+      loc->deps = deps;
+    }
+  }
+  verifierCompactDeps(vrf);
+  verifierRelease(vrf);
+  symstringClean(&cone);
+  return failed;
+}
+
+size_t
+verifierFindLabel(struct verifier* vrf, const char* label)
+{
+/* the cache is shared with the worker */
+  verifierAcquire(vrf, 0);
+  const size_t symId = verifierGetLabelIdAt(vrf, label,
+    hashString(label, strlen(label)), vrf->symbols.size);
+  verifierRelease(vrf);
+  return symId;
+}
+
+/* check the proofs skipped one at a time, from the first */
+static void*
+verifierWork(void* arg)
+{
+  struct verifier* vrf = arg;
+/* on Linux this lowers the priority of this thread only */
+  if (nice(19) == -1) {}
+  while (1) {
+    verifierAcquire(vrf, 1);
+    while (vrf->next < vrf->symbols.size
+      && !verifierIsType(vrf, vrf->next, symType_provable)) {
+      vrf->next++;
+    }
+    pthread_mutex_lock(&vrf->lock);
+    const int isStopping = vrf->isStopping;
+    pthread_mutex_unlock(&vrf->lock);
+    if (isStopping || vrf->next == vrf->symbols.size) {
+      verifierRelease(vrf);
+      break;
+    }
+    verifierCheckDeferred(vrf, vrf->next++);
+    verifierRelease(vrf);
+  }
+  return NULL;
+}
+
+void
+verifierBeginChecking(struct verifier* vrf)
+{
+  if (vrf->isWorking || !vrf->r) { return; }
+  vrf->isStopping = 0;
+  vrf->next = 0;
+  memoryBeginThreads();
+  if (pthread_create(&vrf->worker, NULL, verifierWork, vrf) != 0) {
+    memoryEndThreads();
+    return;
   }
-  verifierCheckProof(vrf, stmt);
+  vrf->isWorking = 1;
+}
+
+void
+verifierEndChecking(struct verifier* vrf, int isFinishing)
+{
+  if (!vrf->isWorking) { return; }
+  if (!isFinishing) {
+    pthread_mutex_lock(&vrf->lock);
+    vrf->isStopping = 1;
+    pthread_mutex_unlock(&vrf->lock);
+  }
+  pthread_join(vrf->worker, NULL);
+  memoryEndThreads();
+  vrf->isWorking = 0;
+}
+
+void
+verifierCheckOnly(struct verifier* vrf)
+{
+  size_t i;
+  const char* only = vrf->only.vals;
+/* set for the $p statements already queued */
+  struct charArray isQueued;
+  charArrayInit(&isQueued, vrf->symbols.size);
+  for (i = 0; i < vrf->symbols.size; i++) {
+    charArrayAdd(&isQueued, 0);
+  }
+  struct symstring todo;
+  symstringInit(&todo);
+  while (*only) {
+    const size_t len = strcspn(only, ",");
+    struct charArray label;
+    charArrayInit(&label, len + 1);
+    charArrayAppend(&label, only, len);
+    charArrayAdd(&label, '\0');
+    const size_t symId = verifierFindLabel(vrf, label.vals);
+    if (symId == symbol_none_id
+      || !verifierIsType(vrf, symId, symType_provable)) {
+      G_LOG_ERR(vrf, error_undefinedSymbol, "%s is not a $p statement",
+        label.vals);
+    } else if (!isQueued.vals[symId]) {
+      isQueued.vals[symId] = 1;
+      symstringAdd(&todo, symId);
+    }
+    charArrayClean(&label);
+    only += len;
+    if (*only == ',') { only++; }
+  }
+/* check the proofs, queueing the theorems they use */
+  verifierAcquire(vrf, 0);
+  for (i = 0; i < todo.size; i++) {
+    verifierCheckDeferred(vrf, todo.vals[i]);
+    size_t j, n;
+    const size_t* deps = verifierFindDeps(vrf, todo.vals[i], &n);
+    for (j = 0; j < n; j++) {
+      const size_t symId = deps[j];
+      if (!verifierIsType(vrf, symId, symType_provable)
+        || isQueued.vals[symId]) {
+        continue;
+      }
+      isQueued.vals[symId] = 1;
+      symstringAdd(&todo, symId);
+    }
+  }
+  verifierRelease(vrf);
+  symstringClean(&todo);
+  charArrayClean(&isQueued);
 }
 
 /* parse $c, $v, or $d statements, or a ${ block. */
@@ -1280,10 +2639,13 @@ verifierParseUnlabelledStatement(struct verifier* vrf, int* isEndOfScope,
 /* filename */
     verifierParsePreprocFile(vrf);
   } else if (tok[1] == 'c') {
+    vrf->stats.vals[vrf->rId].stmts++;
     verifierParseConstants(vrf);
   } else if (tok[1] == 'v') {
+    vrf->stats.vals[vrf->rId].stmts++;
     verifierParseVariables(vrf);
   } else if (tok[1] == 'd') {
+    vrf->stats.vals[vrf->rId].stmts++;
     struct symstring stmt;
     symstringInit(&stmt);
     verifierParseDisjoints(vrf, &stmt);
@@ -1325,6 +2687,7 @@ verifierParseLabelledStatement(struct verifier* vrf, const char* tok)
     return;
   }
   enum symType type = symType_none;
+  enum memtag tag = memorySetTag(memtag_statement);
   if (keyword[1] == 'f') {
     type = symType_floating;
     struct symstring stmt;
@@ -1353,9 +2716,12 @@ verifierParseLabelledStatement(struct verifier* vrf, const char* tok)
     verifierParseProvable(vrf, &stmt, &ctx);
     verifierAddProvable(vrf, tok, &stmt, &ctx);
   }
+  memorySetTag(tag);
   if (type == symType_none) {
     H_LOG_ERR(vrf, error_unexpectedKeyword, 1,
       "expected $f, $e, $a, or $p instead of %s", keyword);
+  } else {
+    vrf->stats.vals[vrf->rId].stmts++;
   }
 }
 
@@ -1427,6 +2793,72 @@ verifierSetVerbosity(struct verifier* vrf, size_t verb)
   vrf->verb = verb;
 }
 
+void
+verifierSetTiming(struct verifier* vrf, int isTimed)
+{
+  vrf->isTimed = isTimed;
+}
+
+void
+verifierSetFileTiming(struct verifier* vrf, int isFileTimed)
+{
+  vrf->isFileTimed = isFileTimed;
+}
+
+void
+verifierSetOnly(struct verifier* vrf, const char* labels)
+{
+  charArrayEmpty(&vrf->only);
+  charArrayAppend(&vrf->only, labels, strlen(labels) + 1);
+  vrf->isDeferred = 1;
+}
+
+void
+verifierSetLazy(struct verifier* vrf, int isLazy)
+{
+  vrf->isLazy = isLazy;
+  vrf->isDeferred = isLazy || vrf->only.size > 0;
+}
+
+void
+verifierSetGrammar(struct verifier* vrf, int isGrammar)
+{
+  if (isGrammar && !vrf->gram) {
+    enum memtag tag = memorySetTag(memtag_grammar);
+    vrf->gram = xmalloc(sizeof(struct grammar));
+    memorySetTag(tag);
+    grammarInit(vrf->gram);
+  } else if (!isGrammar && vrf->gram) {
+    grammarClean(vrf->gram);
+    xfree(vrf->gram);
+    vrf->gram = NULL;
+  }
+}
+
+int
+verifierSetCounting(struct verifier* vrf, int isCounted)
+{
+  if (isCounted && !perfIsOpen(&vrf->perf)) {
+    isCounted = perfOpen(&vrf->perf);
+  }
+  vrf->isCounted = isCounted;
+  return isCounted;
+}
+
+void
+verifierBeginPhase(struct verifier* vrf, enum phase ph)
+{
+  if (vrf->isTimed) { timerStart(&vrf->timers[ph]); }
+  if (vrf->isCounted) { perfStart(&vrf->perf, &vrf->counts[ph]); }
+}
+
+void
+verifierEndPhase(struct verifier* vrf, enum phase ph)
+{
+  if (vrf->isCounted) { perfStop(&vrf->perf, &vrf->counts[ph]); }
+  if (vrf->isTimed) { timerStop(&vrf->timers[ph]); }
+}
+
 /* to do: have an output file, for compressed proofs */
 void
 verifierCompile(struct verifier* vrf, const char* in)
@@ -1436,10 +2868,34 @@ verifierCompile(struct verifier* vrf, const char* in)
     G_LOG_ERR(vrf, error_failedFileOpen, "failed to open input file %s", in);
     return;
   }
-  struct reader r;
-  readerInitFile(&r, fin, in);
-  verifierBeginReadingFile(vrf, &r);
+/* size the tables from the length of the file */
+  if (fseek(fin, 0, SEEK_END) == 0) {
+    long len = ftell(fin);
+    if (len > 0) {
+      verifierReserve(vrf, len);
+    }
+    rewind(fin);
+  }
+  enum memtag tag = memorySetTag(memtag_reader);
+  struct reader* r = xmalloc(sizeof(struct reader));
+  memorySetTag(tag);
+  readerInitFile(r, fin, in);
+  if (vrf->isTimed) {
+    r->timer = &vrf->timers[phase_read];
+  }
+  verifierBeginReadingFile(vrf, r);
+  verifierBeginPhase(vrf, phase_parse);
   verifierParseBlock(vrf);
-  readerClean(&r);
+  if (vrf->only.size > 0) { verifierCheckOnly(vrf); }
+  verifierEndPhase(vrf, phase_parse);
+/* the proofs skipped in lazy mode are read from the input when checked */
+  if (vrf->isLazy) {
+    vrf->in = r;
+    vrf->fin = fin;
+    return;
+  }
+  readerClean(r);
+  xfree(r);
   fclose(fin);
+  vrf->r = NULL;
 }
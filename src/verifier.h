@@ -2,18 +2,40 @@
 #define _HALMOSVERIFIER_H_
 #include "array.h"
 #include "charstring.h"
+#include "diag.h"
 #include "error.h"
 #include "frame.h"
+#include "grammar.h"
+#include "perf.h"
 #include "reader.h"
 #include "symstring.h"
 #include "symtab.h"
+#include "timer.h"
+#include "trie.h"
+#include <pthread.h>
+#include <stdio.h>
+
+/* a step of a proof, as run by verifierRunProof. id is a symId, or if */
+/* isTagRef is set, an index to the steps tagged so far. If isTagged is */
+/* set, the result of the step is saved for later reference. line and */
+/* offset are where the step was read, for reporting errors, or 0 */
+struct proofStep {
+  size_t id;
+  int isTagRef;
+  int isTagged;
+  size_t line;
+  size_t offset;
+};
+typedef struct proofStep proofStep;
+DECLARE_ARRAY(proofStep)
 
-/* data for processing compressed proofs */
+/* data for processing proofs */
 struct proof {
-/* labels used in the proof which are not in the mandatory hypothesis */
+/* labels used in a compressed proof which are not in the mandatory */
+/* hypothesis */
   struct symstring dependencies;
-/* tagged proof steps */
-  struct symstringArray tags;
+/* the decoded steps of the proof */
+  struct proofStepArray steps;
 };
 
 void
@@ -22,6 +44,45 @@ proofInit(struct proof* prf);
 void
 proofClean(struct proof* prf);
 
+/* what was found in a file */
+struct fileStats {
+/* number of $c, $v, $d, $f, $e, $a, and $p statements */
+  size_t stmts;
+/* time spent reading and checking proofs, if the verifier is timing files */
+  struct timer proofs;
+};
+typedef struct fileStats fileStats;
+DECLARE_ARRAY(fileStats)
+
+enum proofState {
+  proofState_unchecked,
+  proofState_verified,
+  proofState_failed
+};
+
+/* where the proof of a $p statement is, so that it can be checked after */
+/* the database was read */
+struct proofLoc {
+/* set if the proof was skipped while reading */
+  int isDeferred;
+  enum proofState state;
+/* the assertions the proof applies, as the last check found them, are */
+/* deps.vals[deps .. deps + depc - 1] */
+  size_t deps;
+  size_t depc;
+/* the errors the last check found */
+  size_t errc;
+/* position in the input, and the file, line and offset for reporting. */
+/* The proof ends with the $. at end */
+  size_t pos;
+  size_t end;
+  size_t file;
+  size_t line;
+  size_t offset;
+};
+typedef struct proofLoc proofLoc;
+DECLARE_ARRAY(proofLoc)
+
 extern const size_t symbol_none_id;
 extern const size_t file_none_id;
 
@@ -43,12 +104,23 @@ struct verifier {
   struct symstring variables;
 /* reverse polish notation stack for verifying proofs */
   struct symstringArray stack;
+/* scratch memory for checking a proof. The entries on the stack live here. */
+/* It is reset at the end of each $p statement */
+  struct arena arena;
+/* labels already resolved in the current proof */
+  struct symmemo memo;
+/* symbols already resolved in the file, by token hash */
+  struct symcache cache;
+/* the statements of the $a and $p statements, by their constants */
+  struct trie conclusions;
 /* the file currently being verified */
   struct reader* r;
 /* a special file with id 0 */
   struct charstring file_none;
 /* a list of filenames */
   struct charstringArray files;
+/* for each file in files, what was found in it */
+  struct fileStatsArray stats;
 /* id of the current file */
   size_t rId;
 /* nesting level */
@@ -63,7 +135,59 @@ struct verifier {
   size_t verb;
 /* number of hash collisions encountered */
   size_t hashc;
-/* to do: have a dynamic array of errors */
+/* if set, time is accumulated in timers for each phase */
+  int isTimed;
+  struct timer timers[phase_size];
+/* if set, the time spent on proofs is accumulated for each file */
+  int isFileTimed;
+/* if set, proofs are skipped while reading and only located */
+  int isDeferred;
+/* for each frame, where the proof is. The proof being read is in loc */
+  struct proofLocArray locs;
+  struct proofLoc loc;
+/* if not symbol_none_id, the $p statement whose proof is checked after */
+/* the database was read. Labels are resolved as they were at it */
+  size_t lateThm;
+/* the rows of assertions applied by the proofs checked */
+  struct size_tArray deps;
+/* for each symbol, the number of the last proof which applied it + 1, so */
+/* each assertion is added once to a row */
+  struct size_tArray depStamps;
+/* the reverse of deps in CSR form, built when it is asked for. The $p */
+/* statements applying symbol i are rdeps[rdepStarts[i] .. */
+/* rdepStarts[i + 1] - 1], in order */
+  int isRdepsBuilt;
+  struct size_tArray rdepStarts;
+  struct size_tArray rdeps;
+/* comma-separated labels given to verifierSetOnly */
+  struct charArray only;
+/* number of proofs checked */
+  size_t proofc;
+/* if set, the input is kept open after reading, so that the proofs */
+/* skipped can be checked on demand */
+  int isLazy;
+  struct reader* in;
+  FILE* fin;
+/* the thread checking skipped proofs in the background. It takes turns */
+/* with the queries, and lets them go first. busy is set while one has the */
+/* verifier, and waiting counts the queries waiting for it */
+  pthread_t worker;
+  int isWorking;
+  int isStopping;
+  int isBusy;
+  size_t waiting;
+/* the next symbol the worker looks at */
+  size_t next;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+/* if not NULL, proofs are also checked on syntax trees */
+  struct grammar* gram;
+/* if set, hardware events are counted for each phase */
+  int isCounted;
+  struct perf perf;
+  struct perfcount counts[phase_size];
+/* the diagnostics found, printed at the end */
+  struct diagList diags;
 };
 
 void
@@ -72,18 +196,63 @@ verifierInit(struct verifier* vrf);
 void
 verifierClean(struct verifier* vrf);
 
+/* reserve room in the tables for a database of the given size in bytes */
+void
+verifierReserve(struct verifier* vrf, size_t bytes);
+
 void
 verifierEmptyStack(struct verifier* vrf);
 
 size_t
 verifierGetSymId(struct verifier* vrf, const char* sym);
 
+/* set the error and count it */
+void
+verifierSetError(struct verifier* vrf, enum error err);
+
+/* the name of the symbol */
+const char*
+verifierGetSymName(const struct verifier* vrf, size_t symId);
+
+/* append the names of the symbols of str to msg, separated by spaces */
+const char*
+verifierPrintSym(const struct verifier* vrf, struct charArray* msg,
+  const struct symstring* str);
+
+/* keep str for the diagnostic being logged, and return what stands for */
+/* it in the message */
+const char*
+verifierDiagSym(struct verifier* vrf, const struct symstring* str);
+
+/* sort the diagnostics, dropping copies if isUnique, and print the first */
+/* limit of them, or all if limit is 0 */
+void
+verifierPrintDiags(struct verifier* vrf, FILE* f, size_t limit,
+  int isUnique);
+
+/* the same, as a json array */
+void
+verifierWriteDiagsJson(struct verifier* vrf, FILE* f, size_t limit,
+  int isUnique);
+
+int
+verifierIsType(const struct verifier* vrf, size_t symId, enum symType type);
+
+/* the id of the file with the given name, or file_none_id */
+size_t
+verifierGetFileId(const struct verifier* vrf, const char* file);
+
+/* the same, with the hash of sym already computed */
+size_t
+verifierGetSymIdExplicit(struct verifier* vrf, const char* sym,
+  hash_t hash);
+
 /* return the symId of the symbol added */
 size_t
 verifierAddSymbolExplicit(struct verifier* vrf, const char* sym,
   struct symtree* t, enum symType type, int isActive, int isTyped,
   size_t scope, size_t stmt, size_t frame, size_t file, size_t line,
-  size_t offset, uint32_t hash);
+  size_t offset, hash_t hash);
 
 size_t
 verifierAddSymbol(struct verifier* vrf, const char* sym, enum symType type);
@@ -94,6 +263,13 @@ verifierAddConstant(struct verifier* vrf, const char* sym);
 size_t
 verifierAddVariable(struct verifier* vrf, const char* sym);
 
+/* append to found the $a and $p statements whose statements could be */
+/* unified with str. They are candidates: a variable used twice may not */
+/* match the same symbols twice, and their type is not checked */
+void
+verifierFindConclusions(struct verifier* vrf, const struct symstring* str,
+  struct symstring* found);
+
 /* return the id of the statement */
 size_t
 verifierAddStatement(struct verifier* vrf, struct symstring* stmt);
@@ -157,6 +333,12 @@ verifierCheckProof(struct verifier* vrf, const struct symstring* thm);
 char*
 verifierParseSymbol(struct verifier* vrf, int* isEndOfStatement, char end);
 
+/* parse a symbol and resolve it to its id through the token cache. */
+/* Returns symbol_none_id at the end of the statement, on errors, and for */
+/* undefined symbols, which are reported */
+size_t
+verifierParseSymId(struct verifier* vrf, int* isEndOfStatement, char end);
+
 void
 verifierParseStatementContent(struct verifier* vrf, struct symstring* stmt,
   char end);
@@ -184,6 +366,15 @@ void
 verifierParseProofSymbol(struct verifier* vrf, const struct frame* ctx,
   int* isEndOfProof);
 
+/* run the steps of a proof on the stack */
+void
+verifierRunProof(struct verifier* vrf, const struct frame* ctx,
+  const struct proofStepArray* steps);
+
+/* read the labels of an uncompressed proof up to $. into steps */
+void
+verifierParseProofSteps(struct verifier* vrf, struct proofStepArray* steps);
+
 void
 verifierParseProof(struct verifier* vrf, const struct frame* ctx);
 
@@ -191,6 +382,97 @@ void
 verifierParseProvable(struct verifier* vrf, struct symstring* stmt,
   struct frame* frm);
 
+/* skip a proof up to $. without reading its steps */
+void
+verifierSkipProof(struct verifier* vrf);
+
+/* read the steps of the proof of the $p statement symId, which was */
+/* skipped while reading with vrf->r, into prf. Returns 0 if it could not */
+/* be read */
+int
+verifierReadProof(struct verifier* vrf, size_t symId, struct proof* prf);
+
+/* whether the steps prove the $p statement symId. They are checked as its */
+/* proof would be, but nothing is reported or recorded */
+int
+verifierIsProof(struct verifier* vrf, size_t symId,
+  const struct proofStepArray* steps);
+
+/* check the proof of the $p statement symId, which was skipped while */
+/* reading with vrf->r, unless it was checked already. Returns the state */
+/* of the proof */
+enum proofState
+verifierCheckLate(struct verifier* vrf, size_t symId);
+
+/* check the proofs skipped of the $p statements from first to last */
+void
+verifierCheckRange(struct verifier* vrf, size_t first, size_t last);
+
+enum proofState
+verifierGetProofState(struct verifier* vrf, size_t symId);
+
+/* the number of $p statements whose proofs are in the state */
+size_t
+verifierCountProofs(struct verifier* vrf, enum proofState state);
+
+/* the assertions applied by the proof of the $p statement symId, or NULL */
+/* if it was not checked. Their number is put in n. The array is valid */
+/* until the next proof is checked. While proofs are checked in the */
+/* background, NULL is returned: call verifierEndChecking first */
+const size_t*
+verifierGetDeps(struct verifier* vrf, size_t symId, size_t* n);
+
+/* the $p statements whose checked proofs apply symId, in order. Their */
+/* number is put in n, and the array is valid until the next proof is */
+/* checked. As verifierGetDeps, NULL while proofs are checked in the */
+/* background */
+const size_t*
+verifierGetRdeps(struct verifier* vrf, size_t symId, size_t* n);
+
+/* append to found the groups of $a and $p statements which are the same */
+/* up to renaming their variables: their essential hypotheses in order, */
+/* statements and disjoint variable restrictions between their variables. */
+/* Each group is in order and ended by symbol_none_id, and the groups are */
+/* in order of their first statement. Returns the number of groups */
+size_t
+verifierFindDuplicates(struct verifier* vrf, struct size_tArray* found);
+
+/* add to cone the $p statements whose proofs apply symId, directly or */
+/* through other $p statements */
+void
+verifierGetCone(struct verifier* vrf, size_t symId, struct symstring* cone);
+
+/* check again the proof of symId, if it is a $p statement, and the */
+/* proofs of its cone, after it changed. Their earlier errors and rows of */
+/* assertions applied are replaced. If r is not NULL, it reads the input */
+/* as changed, where the proofs are found again by their labels, and the */
+/* verifier reads from it from then on. The statements and frames are */
+/* those read first, so if r differs outside the proofs, nothing is */
+/* checked and an error of type error_changedStatement says the database */
+/* must be read again. This needs the proofs to have been skipped while */
+/* reading, as in lazy mode. Returns the number of proofs which failed */
+size_t
+verifierRecheck(struct verifier* vrf, size_t symId, struct reader* r);
+
+/* the id of the label, in scope or not, or symbol_none_id */
+size_t
+verifierFindLabel(struct verifier* vrf, const char* label);
+
+/* start checking the proofs skipped in the background, once the database */
+/* was read */
+void
+verifierBeginChecking(struct verifier* vrf);
+
+/* stop the background checks, after the remaining proofs if isFinishing */
+/* is set, or after the current one */
+void
+verifierEndChecking(struct verifier* vrf, int isFinishing);
+
+/* check the proofs of the labels given to verifierSetOnly and of the $p */
+/* statements they use, once the database was read */
+void
+verifierCheckOnly(struct verifier* vrf);
+
 void
 verifierParseUnlabelledStatement(struct verifier* vrf, int* isEndOfScope,
  const char* tok);
@@ -210,6 +492,37 @@ verifierBeginReadingFile(struct verifier* vrf, struct reader* r);
 void
 verifierSetVerbosity(struct verifier* vrf, size_t verb);
 
+void
+verifierSetTiming(struct verifier* vrf, int isTimed);
+
+void
+verifierSetFileTiming(struct verifier* vrf, int isFileTimed);
+
+/* parse statements into syntax trees and check proofs on them too, */
+/* reporting where the two checks disagree */
+void
+verifierSetGrammar(struct verifier* vrf, int isGrammar);
+
+/* check only the proofs of the comma-separated labels and the proofs they */
+/* use, directly or not. Other proofs are skipped */
+void
+verifierSetOnly(struct verifier* vrf, const char* labels);
+
+/* read statements and frames only, and check proofs on demand */
+void
+verifierSetLazy(struct verifier* vrf, int isLazy);
+
+/* open hardware counters for the phases. Returns 0 if they are not */
+/* available, in which case vrf->perf.err says why */
+int
+verifierSetCounting(struct verifier* vrf, int isCounted);
+
+void
+verifierBeginPhase(struct verifier* vrf, enum phase ph);
+
+void
+verifierEndPhase(struct verifier* vrf, enum phase ph);
+
 void
 verifierCompile(struct verifier* vrf, const char* in);
 
@@ -0,0 +1,102 @@
+#include "unittest.h"
+#include "arena.h"
+#include "array.h"
+
+static int Test_arenaAlloc(void)
+{
+  struct arena a;
+  arenaInit(&a, 64);
+  char* p = arenaAlloc(&a, 10);
+  char* q = arenaAlloc(&a, 10);
+  ut_assert(p != q, "allocations overlap");
+  ut_assert((size_t) (q - p) % sizeof(double) == 0, "misaligned allocation");
+/* larger than a block */
+  char* r = arenaAlloc(&a, 1000);
+  r[999] = 1;
+  ut_assert(a.blocks == 2, "blocks == %lu, expected 2", a.blocks);
+  arenaReset(&a);
+  ut_assert(a.used == 0, "used == %lu, expected 0", a.used);
+  ut_assert(arenaAlloc(&a, 10) == p, "reset did not reuse the first block");
+  arenaClean(&a);
+  return 0;
+}
+
+static int Test_arenaRealloc(void)
+{
+  struct arena a;
+  arenaInit(&a, 256);
+  int* p = arenaAlloc(&a, sizeof(int) * 2);
+  p[0] = 1;
+  p[1] = 2;
+/* the last allocation grows in place */
+  int* q = arenaRealloc(&a, p, sizeof(int) * 2, sizeof(int) * 8);
+  ut_assert(p == q, "realloc of the last allocation moved it");
+  arenaAlloc(&a, 8);
+  q = arenaRealloc(&a, p, sizeof(int) * 8, sizeof(int) * 16);
+  ut_assert(p != q, "realloc overwrote a later allocation");
+  ut_assert(q[0] == 1 && q[1] == 2, "realloc lost the contents");
+  arenaClean(&a);
+  return 0;
+}
+
+static int Test_arenaAllocEmpty(void)
+{
+  struct arena a;
+  arenaInit(&a, 256);
+  int* p = arenaAlloc(&a, 0);
+  int* q = arenaAlloc(&a, sizeof(int));
+  ut_assert(p != q, "an empty allocation shares its address");
+  *q = 7;
+/* q is the last allocation, so p is copied past it */
+  p = arenaRealloc(&a, p, 0, sizeof(int) * 4);
+  p[0] = 1;
+  p[1] = 2;
+  ut_assert(*q == 7, "growing an empty allocation overwrote the next one");
+  arenaClean(&a);
+  return 0;
+}
+
+static int Test_arenaRelease(void)
+{
+  struct arena a;
+  arenaInit(&a, 64);
+  arenaAlloc(&a, 16);
+  struct arenaMark mark = arenaGetMark(&a);
+  char* p = arenaAlloc(&a, 16);
+  arenaAlloc(&a, 100);
+  arenaRelease(&a, mark);
+  ut_assert(a.used == 16, "used == %lu, expected 16", a.used);
+  ut_assert(arenaAlloc(&a, 16) == p, "release did not free the memory");
+  arenaClean(&a);
+  return 0;
+}
+
+static int Test_arenaArray(void)
+{
+  struct arena a;
+  struct intArray arr;
+  size_t i;
+  arenaInit(&a, 64);
+  intArrayInitArena(&arr, 1, &a);
+  for (i = 0; i < 100; i++) {
+    intArrayAdd(&arr, i);
+  }
+  ut_assert(arr.size == 100, "size == %lu, expected 100", arr.size);
+  ut_assert(arr.vals[99] == 99, "vals == %d, expected 99", arr.vals[99]);
+/* this does not free anything */
+  intArrayClean(&arr);
+  arenaClean(&a);
+  return 0;
+}
+
+static int all()
+{
+  ut_run(Test_arenaAlloc);
+  ut_run(Test_arenaRealloc);
+  ut_run(Test_arenaAllocEmpty);
+  ut_run(Test_arenaRelease);
+  ut_run(Test_arenaArray);
+  return 0;
+}
+
+RUN(all)
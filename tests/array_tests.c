@@ -44,11 +44,56 @@ static int Test_arrayAppend(void)
   return 0;
 }
 
+static int Test_arrayZeroCapacity(void)
+{
+  int vals[] = {1, 3, 5};
+  struct intArray a;
+  intArrayInit(&a, 0);
+  intArrayAdd(&a, 7);
+  ut_assert(a.vals[0] == 7, "vals == %d, expected 7", a.vals[0]);
+  ut_assert(a.max >= 1, "max == %lu, expected at least 1", a.max);
+  intArrayClean(&a);
+  intArrayInit(&a, 0);
+  intArrayAppend(&a, vals, 3);
+  ut_assert(a.vals[2] == 5, "vals == %d, expected 5", a.vals[2]);
+  ut_assert(a.size == 3, "size == %lu, expected 3", a.size);
+  intArrayClean(&a);
+  return 0;
+}
+
+static int Test_arrayReserve(void)
+{
+  struct intArray a;
+  intArrayInit(&a, 1);
+  intArrayReserve(&a, 100);
+  ut_assert(a.max == 100, "max == %lu, expected 100", a.max);
+  intArrayReserve(&a, 10);
+  ut_assert(a.max == 100, "max == %lu, expected 100", a.max);
+  intArrayAdd(&a, 3);
+  intArrayAdd(&a, 4);
+  intArrayShrink(&a);
+  ut_assert(a.max == 2, "max == %lu, expected 2", a.max);
+  ut_assert(a.vals[1] == 4, "vals == %d, expected 4", a.vals[1]);
+  intArrayClean(&a);
+  return 0;
+}
+
+static int Test_arrayGrowth(void)
+{
+  ut_assert(arrayGrowth(0, 1) == 1, "an empty array must grow");
+  ut_assert(arrayGrowth(4, 5) >= 5, "growth is smaller than needed");
+  ut_assert(arrayGrowth(4, 100) == 100, "growth should be what is needed");
+  return 0;
+}
+
 static int all()
 {
   ut_run(Test_arrayAdd);
   ut_run(Test_arrayEmpty);
   ut_run(Test_arrayAppend);
+  ut_run(Test_arrayZeroCapacity);
+  ut_run(Test_arrayReserve);
+  ut_run(Test_arrayGrowth);
   return 0;
 }
 
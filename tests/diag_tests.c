@@ -0,0 +1,129 @@
+#include "unittest.h"
+#include "diag.h"
+#include <string.h>
+
+static int
+test_diagListAdd(void)
+{
+  struct diagList l;
+  diagListInit(&l);
+  const size_t a[2] = {3, 4};
+  const size_t b[1] = {5};
+  size_t n;
+/* the placeholders tell the strings apart in any order of evaluation */
+  const char* pb = diagListAddSymstring(&l, b, 1);
+  const char* pa = diagListAddSymstring(&l, a, 2);
+  diagListAdd(&l, error_incorrectProof, diagLevel_error, 0, 2, 7,
+    "%s then %s", pa, pb);
+  diagListAdd(&l, error_stackUnderflow, diagLevel_warning, 1, 1, 0,
+    "%lu %s", 42lu, "long message which does not fit in the text yet");
+  ut_assert(l.diags.size == 2, "%lu diagnostics", l.diags.size);
+  const struct diag* d = &l.diags.vals[0];
+  const char* msg = l.text.vals + d->msg;
+  ut_assert(msg[0] == DIAG_SYMSTRING[0] && msg[1] == 2, "first placeholder");
+  const size_t* ids = diagGetSymstring(&l, d, msg[1] - 1, &n);
+  ut_assert(n == 2 && ids[0] == 3 && ids[1] == 4, "wrong symbol string");
+  ids = diagGetSymstring(&l, d, 0, &n);
+  ut_assert(n == 1 && ids[0] == 5, "wrong symbol string");
+  ut_assert(diagGetSymstring(&l, d, 2, &n) == NULL && n == 0,
+    "found a third symbol string");
+  d = &l.diags.vals[1];
+  ut_assert(d->syms == d->symsEnd, "symbol strings in the second message");
+  ut_assert(strcmp(l.text.vals + d->msg,
+    "42 long message which does not fit in the text yet") == 0,
+    "message is %s", l.text.vals + d->msg);
+/* longer than the room left, so text is grown and the message formatted */
+/* again */
+  char longMsg[600];
+  memset(longMsg, 'x', sizeof(longMsg) - 1);
+  longMsg[sizeof(longMsg) - 1] = '\0';
+  diagListAdd(&l, error_stackUnderflow, diagLevel_warning, 1, 2, 0,
+    "%s!", longMsg);
+  d = &l.diags.vals[2];
+  ut_assert(strlen(l.text.vals + d->msg) == sizeof(longMsg)
+    && strncmp(l.text.vals + d->msg, longMsg, sizeof(longMsg) - 1) == 0,
+    "long message is %s", l.text.vals + d->msg);
+  ut_assert(l.text.size == d->msg + sizeof(longMsg) + 1, "text size %lu",
+    l.text.size);
+  diagListClean(&l);
+  return 0;
+}
+
+static int
+test_diagListSort(void)
+{
+  enum { diag_count = 6 };
+  const size_t files[diag_count] = {1, 0, 1, 0, 0, 0};
+  const size_t lines[diag_count] = {1, 5, 0, 5, 2, 5};
+  const char* msgs[diag_count] = {"a", "b", "c", "d", "e", "b"};
+/* by file, line, then in the order found, with the copy of b dropped */
+  const char* sorted = "ebdca";
+  size_t i;
+  struct diagList l;
+  diagListInit(&l);
+  for (i = 0; i < diag_count; i++) {
+    diagListAdd(&l, error_incorrectProof, diagLevel_error, files[i],
+      lines[i], 0, "%s", msgs[i]);
+  }
+  diagListSort(&l, 0);
+  ut_assert(l.diags.size == diag_count, "dropped diagnostics");
+  diagListSort(&l, 1);
+  ut_assert(l.diags.size == strlen(sorted), "%lu diagnostics left",
+    l.diags.size);
+  for (i = 0; i < l.diags.size; i++) {
+    const char* msg = l.text.vals + l.diags.vals[i].msg;
+    ut_assert(msg[0] == sorted[i], "%s at %lu, expected %c", msg, i,
+      sorted[i]);
+  }
+  diagListClean(&l);
+  return 0;
+}
+
+static int
+test_diagListRemove(void)
+{
+  enum { diag_count = 5 };
+  const size_t keys[diag_count] = {0, 7, 3, 7, 0};
+  const char* msgs[diag_count] = {"a", "b", "c", "d", "e"};
+  const char* kept = "ace";
+  size_t i;
+  struct diagList l;
+  diagListInit(&l);
+  for (i = 0; i < diag_count; i++) {
+    l.key = keys[i];
+    diagListAdd(&l, error_incorrectProof, diagLevel_error, 0, i, 0, "%s",
+      msgs[i]);
+  }
+  diagListRemove(&l, 7);
+  ut_assert(l.diags.size == strlen(kept), "%lu diagnostics left",
+    l.diags.size);
+  for (i = 0; i < l.diags.size; i++) {
+    const char* msg = l.text.vals + l.diags.vals[i].msg;
+    ut_assert(msg[0] == kept[i], "%s at %lu, expected %c", msg, i, kept[i]);
+  }
+/* the text of the diagnostics removed goes too */
+  ut_assert(l.text.size == 2 * strlen(kept), "%lu characters of text",
+    l.text.size);
+/* the symbol string of a diagnostic being recorded is kept */
+  const size_t ids[1] = {9};
+  const char* p = diagListAddSymstring(&l, ids, 1);
+  diagListRemove(&l, 3);
+  diagListAdd(&l, error_incorrectProof, diagLevel_error, 0, 9, 0, "%s", p);
+  size_t n;
+  const size_t* sym = diagGetSymstring(&l, &l.diags.vals[l.diags.size - 1],
+    0, &n);
+  ut_assert(n == 1 && sym[0] == 9, "lost the pending symbol string");
+  diagListClean(&l);
+  return 0;
+}
+
+static int
+all(void)
+{
+  ut_run(test_diagListAdd);
+  ut_run(test_diagListSort);
+  ut_run(test_diagListRemove);
+  return 0;
+}
+
+RUN(all)
@@ -0,0 +1,34 @@
+#include "benchmark.h"
+#include "frame.h"
+
+struct frameData {
+  struct frame frm;
+  size_t i;
+};
+
+/* look up a pair in a frame with 45 restrictions, as in $d x y z ... */
+static void
+bench_frameAreDisjoint(void* arg)
+{
+  struct frameData* d = arg;
+  d->i = (d->i + 1) % 10;
+  bench_sink += frameAreDisjoint(&d->frm, d->i, 9 - d->i);
+}
+
+static void
+all(void)
+{
+  size_t i, j;
+  struct frameData d;
+  frameInit(&d.frm);
+  for (i = 0; i < 10; i++) {
+    for (j = i + 1; j < 10; j++) {
+      frameAddDisjoint(&d.frm, i, j);
+    }
+  }
+  d.i = 0;
+  bench_run(bench_frameAreDisjoint, &d);
+  frameClean(&d.frm);
+}
+
+BENCH(all)
@@ -0,0 +1,204 @@
+#include "unittest.h"
+#include "grammar.h"
+#include "reader.h"
+#include "verifier.h"
+#include <string.h>
+
+static const char* db =
+  "$c ( ) -> wff |- $.\n"
+  "$v ph ps $.\n"
+  "wph $f wff ph $.\n"
+  "wps $f wff ps $.\n"
+  "wi $a wff ( ph -> ps ) $.\n"
+  "${ min $e |- ph $. maj $e |- ( ph -> ps ) $. mp $a |- ps $. $}\n"
+  "ax-1 $a |- ( ph -> ( ps -> ph ) ) $.\n"
+  "th1 $p |- ( ph -> ( ph -> ph ) ) $= wph wph ax-1 $.\n"
+  "${ th2.1 $e |- ph $.\n"
+  "  th2 $p |- ( ps -> ph ) $= wph wps wph wi th2.1 wph wps ax-1 mp $. $}\n"
+  "th3 $p |- ( ps -> ( ps -> ps ) ) $= wps wps ax-1 $.\n";
+
+static void
+compile(struct verifier* vrf, struct reader* r)
+{
+  verifierInit(vrf);
+  verifierSetGrammar(vrf, 1);
+  readerInitString(r, db);
+  verifierBeginReadingFile(vrf, r);
+  verifierParseBlock(vrf);
+}
+
+/* the variables are no longer active once the database is read */
+static size_t
+symId(const struct verifier* vrf, const char* name)
+{
+  size_t i;
+  for (i = 0; i < vrf->symbols.size; i++) {
+    if (strcmp(vrf->symbols.vals[i].sym.vals, name) == 0) { return i; }
+  }
+  return symbol_none_id;
+}
+
+/* parse a statement of symbol names */
+static size_t
+parse(struct verifier* vrf, const char** names, size_t n)
+{
+  size_t i;
+  struct symstring str;
+  symstringInit(&str);
+  for (i = 0; i < n; i++) {
+    symstringAdd(&str, symId(vrf, names[i]));
+  }
+  size_t tree = grammarParse(vrf->gram, vrf, &str);
+  symstringClean(&str);
+  return tree;
+}
+
+static int
+test_grammarMakeNode(void)
+{
+  size_t i;
+  struct grammar g;
+  grammarInit(&g);
+  size_t kids[2] = {0, 0};
+  kids[0] = grammarMakeNode(&g, 1, NULL, 0);
+  kids[1] = grammarMakeNode(&g, 2, NULL, 0);
+  ut_assert(kids[0] != grammar_none_id && kids[0] != kids[1],
+    "leaves %lu and %lu", kids[0], kids[1]);
+  const size_t a = grammarMakeNode(&g, 3, kids, 2);
+  ut_assert(grammarMakeNode(&g, 3, kids, 2) == a, "the same node made twice");
+  ut_assert(grammarMakeNode(&g, 4, kids, 2) != a, "different rules are equal");
+/* nodes are still found after the table grows */
+  for (i = 0; i < 5000; i++) {
+    grammarMakeNode(&g, 100 + i, kids, 1);
+  }
+  ut_assert(grammarMakeNode(&g, 3, kids, 2) == a, "node lost in growth");
+  ut_assert(grammarMakeNode(&g, 100, kids, 1) == grammarMakeNode(&g, 100,
+    kids, 1), "new nodes made twice");
+  grammarClean(&g);
+  return 0;
+}
+
+static int
+test_grammarParse(void)
+{
+  size_t i;
+  struct verifier vrf;
+  struct reader r;
+  compile(&vrf, &r);
+  ut_assert(vrf.errc == 0, "%lu errors", vrf.errc);
+  const struct grammar* g = vrf.gram;
+  ut_assert(g->parsed == g->stmtCount, "parsed %lu of %lu", g->parsed,
+    g->stmtCount);
+/* every statement is its tree flattened */
+  for (i = 0; i < vrf.stmts.size; i++) {
+    const size_t tree = g->stmtTrees.vals[i];
+    ut_assert(tree != grammar_none_id, "statement %lu not parsed", i);
+    struct symstring str;
+    symstringInit(&str);
+    grammarFlatten(g, &vrf, &str, tree);
+    ut_assert(symstringIsEqual(&str, &vrf.stmts.vals[i]),
+      "statement %lu flattened differently", i);
+    symstringClean(&str);
+  }
+/* the same statement is the same node */
+  const char* s1[] = {"|-", "(", "ph", "->", "ph", ")"};
+  const char* s2[] = {"|-", "(", "ph", "->", "ps", ")"};
+  const char* s3[] = {"|-", "(", "ph", "->", ")"};
+  const size_t t1 = parse(&vrf, s1, 6);
+  ut_assert(t1 != grammar_none_id, "not parsed");
+  ut_assert(parse(&vrf, s1, 6) == t1, "parsed to another node");
+  ut_assert(parse(&vrf, s2, 6) != t1, "different statements are equal");
+  ut_assert(parse(&vrf, s3, 5) == grammar_none_id, "invalid statement parsed");
+  readerClean(&r);
+  verifierClean(&vrf);
+  return 0;
+}
+
+static int
+test_grammarSubstitute(void)
+{
+  struct verifier vrf;
+  struct reader r;
+  compile(&vrf, &r);
+  struct grammar* g = vrf.gram;
+  const char* s1[] = {"|-", "(", "ph", "->", "ps", ")"};
+  const char* s2[] = {"wff", "(", "ps", "->", "ps", ")"};
+  const char* s3[] = {"|-", "(", "(", "ps", "->", "ps", ")", "->", "ps", ")"};
+  const size_t t1 = parse(&vrf, s1, 6);
+  const size_t t2 = parse(&vrf, s2, 6);
+/* ph := ( ps -> ps ) */
+  g->subVars.size = 0;
+  g->subTrees.size = 0;
+  size_tArrayAdd(&g->subVars, symId(&vrf, "ph"));
+  size_tArrayAdd(&g->subTrees, g->args.vals[g->nodes.vals[t2].first]);
+  const size_t t3 = grammarSubstitute(g, &vrf, t1);
+  ut_assert(t3 == parse(&vrf, s3, 10), "wrong substitution");
+  readerClean(&r);
+  verifierClean(&vrf);
+  return 0;
+}
+
+static int
+test_grammarCheckProof(void)
+{
+  struct verifier vrf;
+  struct reader r;
+  compile(&vrf, &r);
+  const struct grammar* g = vrf.gram;
+  ut_assert(g->checked == 3, "checked %lu proofs, expected 3", g->checked);
+  ut_assert(g->skipped == 0, "skipped %lu proofs", g->skipped);
+  ut_assert(g->mismatches == 0, "%lu mismatches", g->mismatches);
+  readerClean(&r);
+  verifierClean(&vrf);
+  return 0;
+}
+
+static int
+test_grammarSetApps(void)
+{
+  struct verifier vrf;
+  struct reader r;
+  verifierInit(&vrf);
+  verifierSetGrammar(&vrf, 1);
+  grammarSetApps(vrf.gram, 100);
+  const struct grammar* g = vrf.gram;
+  ut_assert(g->apps.size == 128, "%lu slots, expected 128", g->apps.size);
+/* th4, bad and th5 apply ax-1 as th1 does. The last two fail because */
+/* the statement derived is not theirs */
+  struct charArray text;
+  charArrayInit(&text, 1024);
+  const char* more =
+    "th4 $p |- ( ph -> ( ph -> ph ) ) $= wph wph ax-1 $.\n"
+    "bad $p |- ph $= wph wph ax-1 $.\n"
+    "th5 $p |- ph $= wph wph ax-1 $.\n";
+  charArrayAppend(&text, db, strlen(db));
+  charArrayAppend(&text, more, strlen(more));
+  charArrayAdd(&text, '\0');
+  readerInitString(&r, text.vals);
+  verifierBeginReadingFile(&vrf, &r);
+  verifierParseBlock(&vrf);
+  ut_assert(vrf.errc == 2, "%lu errors, expected 2", vrf.errc);
+  ut_assert(g->mismatches == 0, "%lu mismatches", g->mismatches);
+/* the syntax axioms are not remembered */
+  ut_assert(g->appLookups == 7, "looked up %lu applications, expected 7",
+    g->appLookups);
+  ut_assert(g->appHits == 3, "found %lu applications, expected 3",
+    g->appHits);
+  readerClean(&r);
+  charArrayClean(&text);
+  verifierClean(&vrf);
+  return 0;
+}
+
+static int
+all(void)
+{
+  ut_run(test_grammarMakeNode);
+  ut_run(test_grammarParse);
+  ut_run(test_grammarSubstitute);
+  ut_run(test_grammarCheckProof);
+  ut_run(test_grammarSetApps);
+  return 0;
+}
+
+RUN(all)
@@ -1,5 +1,7 @@
 #include "unittest.h"
 #include "halmos.h"
+#include <stdio.h>
+#include <string.h>
 
 #define test_file(filename, count) \
 static int test_ ## filename(void) \
@@ -20,6 +22,55 @@ test_file(bugged_1, 1)
 // test_file(miu, 0)
 // test_file(hol, 0)
 
+static int
+test_halmosWriteIncludeGraph(void)
+{
+  struct halmos h;
+  char* argv[] = {"tests/include_graph.dot"};
+  char buf[4096];
+  halmosInit(&h);
+  h.flags[halmosflag_include_graph] = 1;
+  h.flagsArgv[halmosflag_include_graph] = argv;
+  halmosCompile(&h, "tests/mm/symbol_import.mm");
+  halmosClean(&h);
+  FILE* f = fopen(argv[0], "r");
+  ut_assert(f, "no graph written");
+  size_t n = fread(buf, 1, sizeof(buf) - 1, f);
+  buf[n] = '\0';
+  fclose(f);
+  remove(argv[0]);
+  ut_assert(strncmp(buf, "digraph includes {", 18) == 0, "not a digraph");
+  ut_assert(strstr(buf, "f0 [label=\"tests/mm/symbol_import.mm"),
+    "missing the input file");
+  ut_assert(strstr(buf, "stmts=1,"), "wrong statement count of the input");
+  ut_assert(strstr(buf, "f1 [label=\"tests/mm/symbol_export.mm"),
+    "missing the included file");
+  ut_assert(strstr(buf, "stmts=7,"), "wrong statement count of the include");
+  ut_assert(strstr(buf, "f0 -> f1;"), "missing the include");
+  return 0;
+}
+
+/* a bad count stops before verifying */
+static int
+test_halmosErrorLimit(void)
+{
+  enum { arg_size = 4 };
+  char* args[arg_size] = {"3", "abc", "", "3x"};
+  const int isStopped[arg_size] = {0, 1, 1, 1};
+  size_t i;
+  for (i = 0; i < arg_size; i++) {
+    struct halmos h;
+    halmosInit(&h);
+    h.flags[halmosflag_error_limit] = 1;
+    h.flagsArgv[halmosflag_error_limit] = &args[i];
+    halmosCompile(&h, "tests/mm/test1.mm");
+    ut_assert(h.flags[halmosflag_no_verify] == isStopped[i], "--error-limit "
+      "'%s' was %s", args[i], isStopped[i] ? "accepted" : "rejected");
+    halmosClean(&h);
+  }
+  return 0;
+}
+
 static int
 all(void)
 {
@@ -28,7 +79,9 @@ all(void)
   // ut_run(test_big_unifier_comp);
   ut_run(test_recursive_include);
   ut_run(test_symbol_import);
+  ut_run(test_halmosErrorLimit);
   ut_run(test_bugged_1);
+  ut_run(test_halmosWriteIncludeGraph);
   // ut_run(test_demo0);
   // ut_run(test_miu);
   // ut_run(test_hol);
@@ -0,0 +1,49 @@
+#include "benchmark.h"
+#include "hash.h"
+#include <string.h>
+
+struct key {
+  const char* s;
+  size_t len;
+};
+
+static void
+bench_murmur3(void* arg)
+{
+  const struct key* k = arg;
+  bench_sink += hash_murmur3(k->s, k->len, 0);
+}
+
+static void
+bench_wy64(void* arg)
+{
+  const struct key* k = arg;
+  bench_sink += hash_wy64(k->s, k->len, 0);
+}
+
+static void
+bench_djb2(void* arg)
+{
+  const struct key* k = arg;
+  bench_sink += hash_djb2(k->s, k->len, 0);
+}
+
+static void
+all(void)
+{
+/* a typical label and a long one */
+  struct key shortKey = {"ax-mp", 5};
+  struct key longKey = {"syl5ibrcom.longer.label.for.hashing.with.64.chars.xxxx",
+    0};
+  longKey.len = strlen(longKey.s);
+  printf("key of %lu chars\n", (unsigned long) shortKey.len);
+  bench_run(bench_murmur3, &shortKey);
+  bench_run(bench_wy64, &shortKey);
+  bench_run(bench_djb2, &shortKey);
+  printf("key of %lu chars\n", (unsigned long) longKey.len);
+  bench_run(bench_murmur3, &longKey);
+  bench_run(bench_wy64, &longKey);
+  bench_run(bench_djb2, &longKey);
+}
+
+BENCH(all)
@@ -12,24 +12,88 @@ test_hash_djb2(void)
 static int
 test_hash_murmur3(void)
 {
-  const char* s[4] = {
-    "hello",
-    "hello ",
-    "hello w",
-    "hello wo"
+/* reference values of MurmurHash3_x86_32 */
+  const char* s[6] = {
+    "",
+    "test",
+    "a",
+    "aa",
+    "aaa",
+    "Hello, world!"
   };
+  const uint32_t seed[6] = {0, 0, 0x9747b28c, 0x9747b28c, 0x9747b28c,
+    0x9747b28c};
+  const uint32_t expected[6] = {0, 0xba6bd213, 0x7fa09ea6, 0x5d211726,
+    0x283e0130, 0x24884cba};
   size_t i;
-  for (i = 0; i < 4; i++) {
-    hash_murmur3(s[i], strlen(s[i]), 0);
+  for (i = 0; i < 6; i++) {
+    uint32_t h = hash_murmur3(s[i], strlen(s[i]), seed[i]);
+    ut_assert(h == expected[i], "hash of '%s' is %x, expected %x", s[i],
+      (unsigned) h, (unsigned) expected[i]);
   }
   return 0;
 }
 
+/* keys may start at any address, and the hash must not depend on it */
+static int
+test_hash_unaligned(void)
+{
+  const char* s = "syl5ibrcom.longer.label";
+  const size_t len = strlen(s);
+  char buf[64];
+  size_t i, n;
+  for (n = 0; n <= len; n++) {
+    const uint32_t h32 = hash_murmur3(s, n, 0);
+    const uint64_t h64 = hash_wy64(s, n, 0);
+    for (i = 1; i < 8; i++) {
+      memcpy(buf + i, s, n);
+      ut_assert(hash_murmur3(buf + i, n, 0) == h32,
+        "murmur3 of %lu chars at offset %lu differs", n, i);
+      ut_assert(hash_wy64(buf + i, n, 0) == h64,
+        "wy64 of %lu chars at offset %lu differs", n, i);
+    }
+  }
+  return 0;
+}
+
+static int
+test_hash_wy64(void)
+{
+  const char* s = "syl5ibrcom.longer.label.for.hashing";
+  const size_t len = strlen(s);
+  size_t i, j;
+/* every prefix hashes differently, including across the word boundaries */
+  for (i = 0; i <= len; i++) {
+    for (j = 0; j < i; j++) {
+      ut_assert(hash_wy64(s, i, 0) != hash_wy64(s, j, 0),
+        "prefixes of %lu and %lu chars collide", i, j);
+    }
+  }
+  ut_assert(hash_wy64(s, len, 0) != hash_wy64(s, len, 1),
+    "the seed is ignored");
+  return 0;
+}
+
+static int
+test_hashString(void)
+{
+  const char* s = "ax-mp";
+#ifdef HASH_64
+  ut_assert(hashString(s, 5) == hash_wy64(s, 5, 0), "expected wy64");
+#else
+  ut_assert(hashString(s, 5) == hash_murmur3(s, 5, 0), "expected murmur3");
+#endif
+  return 0;
+}
+
 static int
 all(void)
 {
   ut_run(test_hash_djb2);
   ut_run(test_hash_murmur3);
+  ut_run(test_hash_unaligned);
+  ut_run(test_hash_wy64);
+  ut_run(test_hashString);
   return 0;
 }
 
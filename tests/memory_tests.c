@@ -0,0 +1,39 @@
+#include "unittest.h"
+#include "memory.h"
+
+static int
+test_memorySetTag(void)
+{
+  struct memstat before, after;
+  memoryGetStats(&before, memtag_frame);
+  enum memtag tag = memorySetTag(memtag_frame);
+  ut_assert(tag == memtag_none, "previous tag is %s, expected none",
+    memtagString(tag));
+  char* p = xmalloc(16);
+  p = xrealloc(p, 1024);
+  memorySetTag(tag);
+  xfree(p);
+  memoryGetStats(&after, memtag_frame);
+  ut_assert(after.mallocs == before.mallocs + 1, "mallocs == %lu, expected %lu",
+    after.mallocs, before.mallocs + 1);
+  ut_assert(after.reallocs == before.reallocs + 1,
+    "reallocs == %lu, expected %lu", after.reallocs, before.reallocs + 1);
+  ut_assert(after.bytes == before.bytes + 16 + 1024,
+    "bytes == %lu, expected %lu", after.bytes, before.bytes + 16 + 1024);
+#ifdef MEMORY_STATS
+  ut_assert(after.live == before.live, "live == %lu, expected %lu",
+    after.live, before.live);
+  ut_assert(after.peak >= 1024, "peak == %lu, expected at least 1024",
+    after.peak);
+#endif
+  return 0;
+}
+
+static int
+all(void)
+{
+  ut_run(test_memorySetTag);
+  return 0;
+}
+
+RUN(all)
@@ -0,0 +1,153 @@
+#include "unittest.h"
+#include "minimizer.h"
+#include "reader.h"
+#include "verifier.h"
+#include <stdio.h>
+#include <string.h>
+
+/* th proves ( ph -> ch ) as a1i does, so its proof can apply a1i */
+static const char* db =
+  "$c ( ) -> wff |- $.\n"
+  "$v ph ps ch $.\n"
+  "wph $f wff ph $.\n"
+  "wps $f wff ps $.\n"
+  "wch $f wff ch $.\n"
+  "wi $a wff ( ph -> ps ) $.\n"
+  "${ min $e |- ph $. maj $e |- ( ph -> ps ) $. ax-mp $a |- ps $. $}\n"
+  "ax-1 $a |- ( ph -> ( ps -> ph ) ) $.\n"
+  "${ a1i.1 $e |- ph $.\n"
+  "   a1i $p |- ( ps -> ph ) $= wph wps wph wi a1i.1 wph wps ax-1 ax-mp $. $}\n"
+  "${ th.1 $e |- ch $.\n"
+  "   th $p |- ( ph -> ch ) $= wch wph wch wi th.1 wch wph ax-1 ax-mp $. $}\n";
+
+static void
+compile(struct verifier* vrf, struct reader* r)
+{
+  verifierInit(vrf);
+  verifierSetLazy(vrf, 1);
+  verifierSetGrammar(vrf, 1);
+  readerInitString(r, db);
+  verifierBeginReadingFile(vrf, r);
+  verifierParseBlock(vrf);
+  verifierCheckRange(vrf, verifierFindLabel(vrf, "a1i"),
+    verifierFindLabel(vrf, "th"));
+}
+
+static int
+test_minimizerRun(void)
+{
+  struct verifier vrf;
+  struct reader r;
+  compile(&vrf, &r);
+  ut_assert(vrf.errc == 0, "%lu errors", vrf.errc);
+  struct minimizer m;
+  minimizerInit(&m, &vrf);
+  minimizerSetThreads(&m, 2);
+  minimizerAdd(&m, verifierFindLabel(&vrf, "a1i"));
+  minimizerAdd(&m, verifierFindLabel(&vrf, "th"));
+  minimizerRun(&m);
+  ut_assert(m.searched == 2, "searched %lu proofs, expected 2", m.searched);
+  ut_assert(m.rejected == 0, "%lu proofs rejected", m.rejected);
+  ut_assert(m.results.size == 1, "shortened %lu proofs, expected 1",
+    m.results.size);
+  const struct minimizerResult* res = &m.results.vals[0];
+  ut_assert(res->thm == verifierFindLabel(&vrf, "th"), "shortened the "
+    "wrong proof");
+  ut_assert(res->before == 9 && res->after == 4, "shortened from %lu to %lu "
+    "steps, expected 9 to 4", res->before, res->after);
+  const char* text = "( a1i ) BACD";
+  ut_assert(res->len == strlen(text)
+    && memcmp(m.text.vals + res->text, text, res->len) == 0,
+    "wrong proof %.*s", (int) res->len, m.text.vals + res->text);
+  ut_assert(m.before == 9 && m.after == 4, "total from %lu to %lu steps",
+    m.before, m.after);
+  minimizerClean(&m);
+  readerClean(&r);
+  verifierClean(&vrf);
+  return 0;
+}
+
+static int
+test_minimizerWrite(void)
+{
+  struct verifier vrf;
+  struct reader r;
+  char buf[4096];
+  const char* in = "tests/minimizer_in.mm";
+  const char* out = "tests/minimizer_in.mm.min";
+  const char* comment = "$( th is a1i with ch for ph $)\n";
+/* the source file has a comment the verifier does not see, and the */
+/* verifier reads it after the mark the preprocessor puts at its start */
+  FILE* f = fopen(in, "w");
+  ut_assert(f, "failed to open %s", in);
+  const char* th = strstr(db, "${ th.1");
+  fwrite(db, 1, th - db, f);
+  fputs(comment, f);
+  fputs(th, f);
+  fclose(f);
+  struct charArray text;
+  charArrayInit(&text, 1024);
+  const char* mark = "$( tests/minimizer_in.mm 0 $)\n";
+  charArrayAppend(&text, mark, strlen(mark));
+  charArrayAppend(&text, db, strlen(db) + 1);
+  verifierInit(&vrf);
+  verifierSetLazy(&vrf, 1);
+  verifierSetGrammar(&vrf, 1);
+  readerInitString(&r, text.vals);
+  verifierBeginReadingFile(&vrf, &r);
+  verifierParseBlock(&vrf);
+  verifierCheckRange(&vrf, verifierFindLabel(&vrf, "a1i"),
+    verifierFindLabel(&vrf, "th"));
+  const size_t file = verifierGetFileId(&vrf, in);
+  ut_assert(file != file_none_id, "%s was not read", in);
+  struct minimizer m;
+  minimizerInit(&m, &vrf);
+  minimizerAdd(&m, verifierFindLabel(&vrf, "th"));
+  minimizerRun(&m);
+  ut_assert(minimizerWrite(&m, file, out), "failed to write %s", out);
+  f = fopen(out, "r");
+  ut_assert(f, "no database written");
+  size_t n = fread(buf, 1, sizeof(buf) - 1, f);
+  buf[n] = '\0';
+  fclose(f);
+  remove(in);
+  remove(out);
+  ut_assert(strstr(buf, "th $p |- ( ph -> ch ) $= ( a1i ) BACD $. $}"),
+    "proof not replaced");
+  ut_assert(strstr(buf, "a1i $p |- ( ps -> ph ) $= wph wps wph wi a1i.1 "),
+    "other proof changed");
+  const char* c = strstr(buf, comment);
+  ut_assert(c, "comment not kept");
+  ut_assert(!strstr(buf, mark), "mark written");
+/* the database written is still verified, once the comment the */
+/* preprocessor would drop is taken out */
+  charArrayEmpty(&text);
+  charArrayAppend(&text, buf, c - buf);
+  c += strlen(comment);
+  charArrayAppend(&text, c, strlen(c) + 1);
+  struct verifier vrf2;
+  struct reader r2;
+  verifierInit(&vrf2);
+  readerInitString(&r2, text.vals);
+  verifierBeginReadingFile(&vrf2, &r2);
+  verifierParseBlock(&vrf2);
+  ut_assert(vrf2.errc == 0 && vrf2.proofc == 2, "checked %lu proofs with "
+    "%lu errors", vrf2.proofc, vrf2.errc);
+  readerClean(&r2);
+  verifierClean(&vrf2);
+  charArrayClean(&text);
+  minimizerClean(&m);
+  readerClean(&r);
+  verifierClean(&vrf);
+  return 0;
+}
+
+static int
+all(void)
+{
+  ut_run(test_minimizerRun);
+  ut_run(test_minimizerWrite);
+  return 0;
+}
+
+RUN(all)
@@ -0,0 +1,51 @@
+#include "unittest.h"
+#include "perf.h"
+
+static int
+test_perfStartStop(void)
+{
+  size_t i;
+  struct perf p;
+  struct perfcount c;
+  perfInit(&p);
+  perfcountInit(&c);
+/* counters that are not open count nothing */
+  perfStart(&p, &c);
+  perfStop(&p, &c);
+  ut_assert(c.count == 0, "count == %lu, expected 0", c.count);
+/* the kernel may refuse, which must leave p closed with a reason */
+  if (!perfOpen(&p)) {
+    ut_assert(!perfIsOpen(&p), "failed open left counters open");
+    ut_assert(p.err != 0, "failed open gave no reason");
+    return 0;
+  }
+  ut_assert(perfIsCounted(&p, perfevent_cycles), "cycles are not counted");
+  perfStart(&p, &c);
+  for (i = 0; i < 100000; i++) {
+    c.startEnabled += 0;
+  }
+  perfStop(&p, &c);
+  ut_assert(c.count == 1, "count == %lu, expected 1", c.count);
+  ut_assert(perfcountGet(&c, perfevent_cycles) > 0, "no cycles counted");
+  perfClose(&p);
+  ut_assert(!perfIsOpen(&p), "counters are open after perfClose");
+  return 0;
+}
+
+static int
+test_perfeventString(void)
+{
+  ut_assert(strcmp(perfeventString(perfevent_cycles), "cycles") == 0,
+    "perfevent_cycles is %s", perfeventString(perfevent_cycles));
+  return 0;
+}
+
+static int
+all(void)
+{
+  ut_run(test_perfStartStop);
+  ut_run(test_perfeventString);
+  return 0;
+}
+
+RUN(all)
@@ -1,5 +1,10 @@
+/* fileno() is POSIX, not C99 */
+#define _XOPEN_SOURCE 700
 #include "unittest.h"
+#include "memory.h"
 #include "preproc.h"
+#include <stdio.h>
+#include <string.h>
 
 static int
 test_preprocInit(void)
@@ -10,10 +15,141 @@ test_preprocInit(void)
   return 0;
 }
 
+static int
+test_preprocAddFile(void)
+{
+  struct preproc p;
+  preprocInit(&p);
+  size_t a = preprocAddFile(&p, "tests/mm/test1.mm");
+/* another path to the same file */
+  size_t b = preprocAddFile(&p, "tests/../tests/mm/test1.mm");
+  ut_assert(a == b, "same file added as %lu and %lu", a, b);
+  size_t c = preprocAddFile(&p, "tests/mm/symbol_import.mm");
+  ut_assert(c != a, "different files share id %lu", a);
+/* files that don't exist are told apart by name */
+  size_t d = preprocAddFile(&p, "tests/mm/missing1.mm");
+  size_t e = preprocAddFile(&p, "tests/mm/missing2.mm");
+  ut_assert(d != e, "missing files share id %lu", d);
+  ut_assert(preprocAddFile(&p, "tests/mm/missing1.mm") == d,
+    "missing file added twice");
+  ut_assert(p.files.size == 4, "%lu files, expected 4", p.files.size);
+  preprocClean(&p);
+  return 0;
+}
+
+/* the output must not depend on the number of threads */
+static int
+test_preprocCompileThreads(void)
+{
+  const char* in = "tests/mm/symbol_import.mm";
+  const char* out[2] = {"tests/preproc_1.mm", "tests/preproc_4.mm"};
+  const size_t threads[2] = {1, 4};
+  size_t i;
+  for (i = 0; i < 2; i++) {
+    struct preproc p;
+    preprocInit(&p);
+    preprocSetThreads(&p, threads[i]);
+    const enum memtag tag = memorySetTag(memtag_none);
+    preprocCompile(&p, in, out[i]);
+    ut_assert(memorySetTag(tag) == memtag_none, "memory tag not restored "
+      "with %lu threads", threads[i]);
+    ut_assert(p.errCount == 0, "%lu errors", p.errCount);
+    preprocClean(&p);
+  }
+  FILE* f1 = fopen(out[0], "r");
+  FILE* f2 = fopen(out[1], "r");
+  ut_assert(f1 && f2, "no output");
+  int c1, c2;
+  do {
+    c1 = fgetc(f1);
+    c2 = fgetc(f2);
+    ut_assert(c1 == c2, "outputs differ");
+  } while (c1 != EOF);
+  fclose(f1);
+  fclose(f2);
+  remove(out[0]);
+  remove(out[1]);
+  return 0;
+}
+
+/* a second run takes every file from the cache and writes the same output */
+static int
+test_preprocCache(void)
+{
+  const char* in = "tests/mm/symbol_import.mm";
+  const char* out[2] = {"tests/preproc_1.mm", "tests/preproc_2.mm"};
+  size_t i;
+  for (i = 0; i < 2; i++) {
+    struct preproc p;
+    preprocInit(&p);
+    preprocSetCache(&p, "tests/preproc_cache");
+    preprocCompile(&p, in, out[i]);
+    ut_assert(p.errCount == 0, "%lu errors", p.errCount);
+    ut_assert(p.files.size == 2, "%lu files, expected 2", p.files.size);
+    if (i == 1) {
+      ut_assert(preprocCountCached(&p) == 2, "%lu files cached, expected 2",
+        preprocCountCached(&p));
+    }
+    preprocClean(&p);
+  }
+  FILE* f1 = fopen(out[0], "r");
+  FILE* f2 = fopen(out[1], "r");
+  ut_assert(f1 && f2, "no output");
+  int c1, c2;
+  do {
+    c1 = fgetc(f1);
+    c2 = fgetc(f2);
+    ut_assert(c1 == c2, "outputs differ");
+  } while (c1 != EOF);
+  fclose(f1);
+  fclose(f2);
+  remove(out[0]);
+  remove(out[1]);
+  return 0;
+}
+
+static int
+test_preprocWriter(void)
+{
+  size_t i;
+  const char* name = "tests/preproc_writer.mm";
+  char text[] = "text\n";
+  char buf[64];
+  FILE* f = fopen(name, "w+");
+  ut_assert(f, "failed to open %s", name);
+  struct preprocWriter w;
+  preprocWriterInit(&w, fileno(f));
+/* more entries than fit in one writev */
+  for (i = 0; i < 3 * preproc_iov_size; i++) {
+    preprocWriterMark(&w, "a.mm", i);
+    preprocWriterAdd(&w, text, 5);
+  }
+  preprocWriterClean(&w);
+  ut_assert(w.err == error_none, "error %s", errorString(w.err));
+  rewind(f);
+  for (i = 0; i < 3 * preproc_iov_size; i++) {
+    char expected[64];
+    snprintf(expected, sizeof(expected), "$( a.mm %lu $)\n", i);
+    ut_assert(fgets(buf, sizeof(buf), f), "output ends at %lu", i);
+    ut_assert(strcmp(buf, expected) == 0, "got %s instead of %s", buf,
+      expected);
+    ut_assert(fgets(buf, sizeof(buf), f) && strcmp(buf, text) == 0,
+      "wrong text after %lu", i);
+  }
+  ut_assert(!fgets(buf, sizeof(buf), f), "output too long");
+  fclose(f);
+  remove(name);
+  return 0;
+}
+
 static int
 all(void)
 {
   ut_run(test_preprocInit);
+  ut_run(test_preprocAddFile);
+  ut_run(test_preprocCompileThreads);
+  ut_run(test_preprocCache);
+  ut_run(test_preprocWriter);
   return 0;
 }
 
@@ -0,0 +1,32 @@
+#include "benchmark.h"
+#include "reader.h"
+
+static const char whitespace[] = " \t\r\f\n";
+
+/* tokenize a string of 1000 labels */
+static void
+bench_readerGetToken(void* arg)
+{
+  const char* s = arg;
+  struct reader r;
+  readerInitString(&r, s);
+  while (!r.err) {
+    readerSkip(&r, whitespace);
+    bench_sink += readerGetToken(&r, whitespace)[0];
+  }
+  readerClean(&r);
+}
+
+static void
+all(void)
+{
+  size_t i;
+  static char s[reader_bufferSize];
+  size_t len = 0;
+  for (i = 0; i < 1000; i++) {
+    len += sprintf(s + len, "wph%lu ", (unsigned long) i);
+  }
+  bench_run(bench_readerGetToken, s);
+}
+
+BENCH(all)
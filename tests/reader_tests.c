@@ -156,6 +156,95 @@ Test_readerPeek(void)
 //   return 0;
 // }
 
+static int
+Test_readerGetRun(void)
+{
+  struct reader r;
+  struct charArray out;
+  charArrayInit(&out, 1);
+  readerInitString(&r, "ab\ncd $x");
+  size_t n = readerGetRun(&r, '$', &out);
+  ut_assert(n == 6, "run of %lu chars, expected 6", n);
+  ut_assert(strncmp(out.vals, "ab\ncd ", 6) == 0, "wrong run");
+  ut_assert(r.line == 2 && r.offset == 3, "at %lu:%lu, expected 2:3", r.line,
+    r.offset);
+  int c = readerGet(&r);
+  ut_assert(c == '$', "get() == %c, expected '$'", c);
+  n = readerGetRun(&r, '$', &out);
+  ut_assert(n == 1 && out.vals[6] == 'x', "wrong run to the end");
+  readerGet(&r);
+  ut_assert(r.err == error_endOfFile, ".err == %s, expected %s",
+    errorString(r.err), errorString(error_endOfFile));
+  readerClean(&r);
+/* a run across blocks of the file */
+  FILE* f = tmpfile();
+  size_t i;
+  for (i = 0; i < reader_bufferSize; i++) {
+    fputs("a\n", f);
+  }
+  fputs("b$", f);
+  rewind(f);
+  charArrayEmpty(&out);
+  readerInitFile(&r, f, "tmp");
+  n = readerGetRun(&r, '$', &out);
+  ut_assert(n == 2 * reader_bufferSize + 1, "run of %lu chars", n);
+  ut_assert(r.line == reader_bufferSize + 1 && r.offset == 1,
+    "at %lu:%lu", r.line, r.offset);
+  c = readerGet(&r);
+  ut_assert(c == '$', "get() == %c, expected '$'", c);
+  n = readerGetRun(&r, '$', &out);
+  ut_assert(n == 0, "run of %lu chars at the end", n);
+  readerGet(&r);
+  ut_assert(r.err == error_endOfFile, ".err == %s, expected %s",
+    errorString(r.err), errorString(error_endOfFile));
+  readerClean(&r);
+  fclose(f);
+  charArrayClean(&out);
+  return 0;
+}
+
+static int
+Test_readerSeek(void)
+{
+  struct reader r;
+  readerInitString(&r, "ab\ncd");
+  readerGet(&r);
+  readerPeek(&r);
+/* the character put back is not consumed */
+  size_t pos = readerTell(&r);
+  ut_assert(pos == 1, "at %lu, expected 1", pos);
+  while (readerGet(&r) != EOF) {}
+  readerSeek(&r, pos, 1, 1);
+  int c = readerGet(&r);
+  ut_assert(c == 'b' && r.err == error_none, "get() == %c, expected 'b'", c);
+  readerClean(&r);
+/* back to a position in an earlier block of the file */
+  FILE* f = tmpfile();
+  size_t i;
+  for (i = 0; i < reader_bufferSize; i++) {
+    fputs("a\n", f);
+  }
+  fputs("b$", f);
+  rewind(f);
+  readerInitFile(&r, f, "tmp");
+  readerGet(&r);
+  readerGet(&r);
+  pos = readerTell(&r);
+  ut_assert(pos == 2, "at %lu, expected 2", pos);
+  readerGetRun(&r, '$', NULL);
+  ut_assert(readerTell(&r) == 2 * reader_bufferSize + 1, "at %lu",
+    readerTell(&r));
+  ut_assert(readerGet(&r) == '$', "skipped past $");
+  readerGet(&r);
+  readerSeek(&r, pos, 2, 0);
+  c = readerGet(&r);
+  ut_assert(c == 'a' && r.line == 2 && r.offset == 1, "get() == %c at "
+    "%lu:%lu", c, r.line, r.offset);
+  readerClean(&r);
+  fclose(f);
+  return 0;
+}
+
 static int
 all()
 {
@@ -164,6 +253,8 @@ all()
   ut_run(Test_readerSkip);
   ut_run(Test_readerFind);
   ut_run(Test_readerPeek);
+  ut_run(Test_readerGetRun);
+  ut_run(Test_readerSeek);
   return 0;
 }
 
@@ -0,0 +1,68 @@
+#include "benchmark.h"
+#include "symstring.h"
+
+/* a statement like |- ( ph -> ( ps -> ph ) ) with variables 1 and 2 */
+static const size_t stmt[] = {10, 11, 1, 12, 11, 2, 12, 1, 13, 13};
+static const size_t stmt_size = sizeof(stmt) / sizeof(stmt[0]);
+
+struct substitutionData {
+  struct substitution sub;
+  struct symstring str;
+};
+
+static void
+bench_substitutionApply(void* arg)
+{
+  struct substitutionData* d = arg;
+  size_tArrayEmpty(&d->str);
+  size_tArrayAppend(&d->str, stmt, stmt_size);
+  substitutionApply(&d->sub, &d->str);
+  bench_sink += d->str.size;
+}
+
+struct equalData {
+  struct symstring a;
+  struct symstring b;
+};
+
+static void
+bench_symstringIsEqual(void* arg)
+{
+  struct equalData* d = arg;
+  bench_sink += symstringIsEqual(&d->a, &d->b);
+}
+
+static void
+all(void)
+{
+  size_t i;
+/* substitute terms of 20 symbols for the two variables */
+  struct substitutionData d;
+  substitutionInit(&d.sub);
+  symstringInit(&d.str);
+  struct symstring s1, s2;
+  symstringInit(&s1);
+  symstringInit(&s2);
+  for (i = 0; i < 20; i++) {
+    symstringAdd(&s1, 20 + i);
+    symstringAdd(&s2, 40 + i);
+  }
+  substitutionAdd(&d.sub, 1, &s1);
+  substitutionAdd(&d.sub, 2, &s2);
+  bench_run(bench_substitutionApply, &d);
+  symstringClean(&d.str);
+  substitutionClean(&d.sub);
+/* equal strings of 64 symbols, the worst case */
+  struct equalData e;
+  symstringInit(&e.a);
+  symstringInit(&e.b);
+  for (i = 0; i < 64; i++) {
+    symstringAdd(&e.a, i);
+    symstringAdd(&e.b, i);
+  }
+  bench_run(bench_symstringIsEqual, &e);
+  symstringClean(&e.a);
+  symstringClean(&e.b);
+}
+
+BENCH(all)
@@ -0,0 +1,56 @@
+#include "benchmark.h"
+#include "hash.h"
+#include "symtab.h"
+
+enum { keys_size = 10000 };
+
+struct keys {
+  hash_t h[keys_size];
+  struct symtree tree;
+  size_t i;
+};
+
+/* build a tree of keys_size keys from scratch */
+static void
+bench_symtreeInsert(void* arg)
+{
+  struct keys* k = arg;
+  size_t i;
+  struct symtree t;
+  symtreeInit(&t);
+  for (i = 0; i < keys_size; i++) {
+    symtreeInsert(&t, k->h[i], i + 1);
+  }
+  symtreeClean(&t);
+}
+
+/* find one key in a tree of keys_size keys */
+static void
+bench_symtreeFind(void* arg)
+{
+  struct keys* k = arg;
+  k->i = (k->i + 7919) % keys_size;
+  bench_sink += symtreeFind(&k->tree, k->h[k->i])->node.symId;
+}
+
+static void
+all(void)
+{
+  static struct keys k;
+  size_t i;
+  char label[32];
+  for (i = 0; i < keys_size; i++) {
+    int len = sprintf(label, "label%lu", (unsigned long) i);
+    k.h[i] = hashString(label, len);
+  }
+  symtreeInit(&k.tree);
+  for (i = 0; i < keys_size; i++) {
+    symtreeInsert(&k.tree, k.h[i], i + 1);
+  }
+  k.i = 0;
+  bench_run(bench_symtreeInsert, &k);
+  bench_run(bench_symtreeFind, &k);
+  symtreeClean(&k.tree);
+}
+
+BENCH(all)
@@ -79,6 +79,45 @@ test_symtreeFind(void)
   return 0;
 }
 
+static int
+test_symcacheFind(void)
+{
+  size_t i;
+  struct symbolArray symbols;
+  const char* names[3] = {"$none", "wff", "ph"};
+  symbolArrayInit(&symbols, 3);
+  for (i = 0; i < 3; i++) {
+    struct symbol sym;
+    symbolInit(&sym);
+    charArrayAppend(&sym.sym, names[i], strlen(names[i]) + 1);
+    sym.isActive = 1;
+    symbolArrayAdd(&symbols, sym);
+  }
+  struct symcache c;
+  symcacheInit(&c, 4);
+  ut_assert(symcacheFind(&c, &symbols, "wff", 5) == 0, "empty cache hit");
+  symcacheAdd(&c, 5, 1);
+  ut_assert(symcacheFind(&c, &symbols, "wff", 5) == 1, "wff not found");
+/* same slot, different hash */
+  ut_assert(symcacheFind(&c, &symbols, "wff", 9) == 0, "hash not checked");
+/* same hash, different name */
+  ut_assert(symcacheFind(&c, &symbols, "ph", 5) == 0, "name not checked");
+/* symbols going out of scope are no longer found */
+  symbols.vals[1].isActive = 0;
+  ut_assert(symcacheFind(&c, &symbols, "wff", 5) == 0,
+    "inactive symbol found");
+/* a colliding slot is overwritten */
+  symcacheAdd(&c, 1, 2);
+  ut_assert(symcacheFind(&c, &symbols, "ph", 1) == 2, "ph not found");
+  ut_assert(c.hits == 2, "hits == %lu, expected 2", c.hits);
+  symcacheClean(&c);
+  for (i = 0; i < symbols.size; i++) {
+    symbolClean(&symbols.vals[i]);
+  }
+  symbolArrayClean(&symbols);
+  return 0;
+}
+
 static int
 all(void)
 {
@@ -86,6 +125,7 @@ all(void)
   ut_run(test_symnodeInsert);
   ut_run(test_symtreeInsert);
   ut_run(test_symtreeFind);
+  ut_run(test_symcacheFind);
   return 0;
 }
 
@@ -0,0 +1,38 @@
+#include "unittest.h"
+#include "timer.h"
+
+static int
+test_timerStartStop(void)
+{
+  struct timer t;
+  timerInit(&t);
+  ut_assert(t.count == 0, "count == %lu, expected 0", t.count);
+  timerStart(&t);
+  timerStop(&t);
+  timerStart(&t);
+  timerStop(&t);
+  ut_assert(t.count == 2, "count == %lu, expected 2", t.count);
+  ut_assert(t.wall >= 0.0, "wall time is negative");
+  ut_assert(t.cpu >= 0.0, "cpu time is negative");
+  return 0;
+}
+
+static int
+test_phaseString(void)
+{
+  ut_assert(strcmp(phaseString(phase_read), "read") == 0,
+    "phase_read is %s", phaseString(phase_read));
+  ut_assert(strcmp(phaseString(phase_substitution), "substitution") == 0,
+    "phase_substitution is %s", phaseString(phase_substitution));
+  return 0;
+}
+
+static int
+all(void)
+{
+  ut_run(test_timerStartStop);
+  ut_run(test_phaseString);
+  return 0;
+}
+
+RUN(all)
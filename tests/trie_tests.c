@@ -0,0 +1,129 @@
+#include "unittest.h"
+#include "trie.h"
+
+/* symbols 1 to 9 are constants and 10 and up are wildcards */
+static const size_t wild = 10;
+
+static size_t
+find(struct trie* t, const size_t* str, size_t len, size_t value)
+{
+  size_t i;
+  size_t count = 0;
+  struct size_tArray found;
+  size_tArrayInit(&found, 1);
+  trieFind(t, str, len, &found);
+  for (i = 0; i < found.size; i++) {
+    if (found.vals[i] == value) { count++; }
+  }
+  size_tArrayClean(&found);
+  return count;
+}
+
+static int
+test_trieFind(void)
+{
+  struct trie t;
+  trieInit(&t);
+  trieSetWildcard(&t, wild);
+  trieSetWildcard(&t, wild + 1);
+/* 1 x 2 y 3, 1 x x, 1 2 3, and 1 x */
+  const size_t k1[5] = {1, wild, 2, wild + 1, 3};
+  const size_t k2[3] = {1, wild, wild};
+  const size_t k3[3] = {1, 2, 3};
+  const size_t k4[2] = {1, wild};
+  trieAdd(&t, k1, 5, 100);
+  trieAdd(&t, k2, 3, 200);
+  trieAdd(&t, k3, 3, 300);
+  trieAdd(&t, k4, 2, 400);
+  const size_t s1[7] = {1, 4, 4, 2, 5, 2, 3};
+  ut_assert(find(&t, s1, 7, 100) == 1, "1 x 2 y 3 not found once");
+  ut_assert(find(&t, s1, 7, 200) == 1, "1 x x not found once");
+  ut_assert(find(&t, s1, 7, 300) == 0, "1 2 3 found");
+  ut_assert(find(&t, s1, 7, 400) == 1, "1 x not found once");
+/* wildcards match no symbols too */
+  const size_t s2[3] = {1, 2, 3};
+  ut_assert(find(&t, s2, 3, 100) == 1, "1 x 2 y 3 not found");
+  ut_assert(find(&t, s2, 3, 300) == 1, "1 2 3 not found");
+  const size_t s3[2] = {2, 3};
+  ut_assert(find(&t, s3, 2, 200) == 0, "1 x x found for 2 3");
+  trieClean(&t);
+  return 0;
+}
+
+static int
+test_trieFindSpans(void)
+{
+  size_t i;
+  struct trie t;
+  trieInit(&t);
+  trieSetWildcard(&t, wild);
+/* the trees 1(x, 2) and 1(x, x) in preorder */
+  const size_t k1[3] = {1, wild, 2};
+  const size_t k2[3] = {1, wild, wild};
+  trieAdd(&t, k1, 3, 100);
+  trieAdd(&t, k2, 3, 200);
+  struct size_tArray found;
+  size_tArrayInit(&found, 1);
+/* 1(3(4, 5), 2): x matches the subtree 3(4, 5) only */
+  const size_t s1[5] = {1, 3, 4, 5, 2};
+  const size_t e1[5] = {5, 4, 3, 4, 5};
+  trieFindSpans(&t, s1, e1, 5, &found);
+  ut_assert(found.size == 2, "found %lu keys, expected 2", found.size);
+  for (i = 0; i < found.size; i++) {
+    ut_assert(found.vals[i] == 100 || found.vals[i] == 200, "found %lu",
+      found.vals[i]);
+  }
+/* 1(3(4, 2)): the 2 inside the subtree is not matched */
+  found.size = 0;
+  const size_t s2[4] = {1, 3, 4, 2};
+  const size_t e2[4] = {4, 4, 3, 4};
+  trieFindSpans(&t, s2, e2, 4, &found);
+  ut_assert(found.size == 0, "found %lu keys in a single subtree",
+    found.size);
+  size_tArrayClean(&found);
+  trieClean(&t);
+  return 0;
+}
+
+static int
+test_trieAdd(void)
+{
+  size_t i, j;
+  struct trie t;
+  trieInit(&t);
+/* enough keys to grow the tables, and long ones which are cut */
+  enum { key_count = 2000, key_size = 40 };
+  size_t key[key_size];
+  for (i = 0; i < key_count; i++) {
+    for (j = 0; j < key_size; j++) {
+      key[j] = 1 + (i + j) % 9;
+    }
+    key[0] = 1 + i % 9;
+    key[1] = 1 + (i / 9) % 9;
+    key[2] = 1 + (i / 81) % 9;
+    trieAdd(&t, key, (i % 2) ? key_size : 3, i);
+  }
+  for (i = 0; i < key_count; i++) {
+    for (j = 0; j < key_size; j++) {
+      key[j] = 1 + (i + j) % 9;
+    }
+    key[0] = 1 + i % 9;
+    key[1] = 1 + (i / 9) % 9;
+    key[2] = 1 + (i / 81) % 9;
+    ut_assert(find(&t, key, (i % 2) ? key_size : 3, i) == 1,
+      "key %lu not found", i);
+  }
+  trieClean(&t);
+  return 0;
+}
+
+static int
+all(void)
+{
+  ut_run(test_trieFind);
+  ut_run(test_trieFindSpans);
+  ut_run(test_trieAdd);
+  return 0;
+}
+
+RUN(all)
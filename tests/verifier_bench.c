@@ -0,0 +1,83 @@
+#include "benchmark.h"
+#include "verifier.h"
+
+struct applyData {
+  struct verifier vrf;
+  struct frame ctx;
+  size_t assertion;
+  struct symstring args[3];
+};
+
+/* apply a $a with two $f and one $e hypotheses to a prepared stack */
+static void
+bench_verifierApplyAssertion(void* arg)
+{
+  struct applyData* d = arg;
+  size_t i;
+  for (i = 0; i < 3; i++) {
+    struct symstring entry;
+    symstringInitArena(&entry, d->args[i].size, &d->vrf.arena);
+    symstringAppend(&entry, &d->args[i]);
+    symstringArrayAdd(&d->vrf.stack, entry);
+  }
+  verifierApplyAssertion(&d->vrf, &d->ctx, d->assertion);
+  bench_sink += d->vrf.stack.vals[0].size;
+  verifierEmptyStack(&d->vrf);
+  arenaReset(&d->vrf.arena);
+}
+
+static void
+all(void)
+{
+  static struct applyData d;
+  size_t i;
+  struct reader r;
+  struct symstring stmt;
+  verifierInit(&d.vrf);
+  readerInitString(&r, "");
+  verifierBeginReadingFile(&d.vrf, &r);
+  size_t t = verifierAddConstant(&d.vrf, "t");
+  size_t x = verifierAddVariable(&d.vrf, "x");
+  size_t y = verifierAddVariable(&d.vrf, "y");
+  symstringInit(&stmt);
+  symstringAdd(&stmt, t);
+  symstringAdd(&stmt, x);
+  verifierAddFloating(&d.vrf, "tx", &stmt);
+  symstringInit(&stmt);
+  symstringAdd(&stmt, t);
+  symstringAdd(&stmt, y);
+  verifierAddFloating(&d.vrf, "ty", &stmt);
+  symstringInit(&stmt);
+  symstringAdd(&stmt, t);
+  symstringAdd(&stmt, x);
+  symstringAdd(&stmt, y);
+  verifierAddEssential(&d.vrf, "txy", &stmt);
+  symstringInit(&stmt);
+  symstringAdd(&stmt, t);
+  symstringAdd(&stmt, y);
+  symstringAdd(&stmt, x);
+  d.assertion = verifierAddAssertion(&d.vrf, "tyx", &stmt);
+/* substitute t followed by 10 constants for x and for y */
+  size_t c = verifierAddConstant(&d.vrf, "c");
+  for (i = 0; i < 3; i++) {
+    symstringInit(&d.args[i]);
+    symstringAdd(&d.args[i], t);
+  }
+  for (i = 0; i < 20; i++) {
+    if (i < 10) {
+      symstringAdd(&d.args[0], c);
+      symstringAdd(&d.args[1], c);
+    }
+    symstringAdd(&d.args[2], c);
+  }
+  frameInit(&d.ctx);
+  bench_run(bench_verifierApplyAssertion, &d);
+  for (i = 0; i < 3; i++) {
+    symstringClean(&d.args[i]);
+  }
+  frameClean(&d.ctx);
+  readerClean(&r);
+  verifierClean(&d.vrf);
+}
+
+BENCH(all)
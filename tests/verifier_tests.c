@@ -977,6 +977,84 @@ do { \
 #undef test_file
 }
 
+/* a step applying ax2 to one hypothesis, in each kind of proof */
+static int
+Test_verifierProofErrorLocation(void)
+{
+  enum {
+    file_size = 2
+  };
+  const char* file[file_size] = {
+    "$c wff $. $v x y $. wx $f wff x $. wy $f wff y $.\n"
+    "ax1 $a wff x $. ax2 $a wff x y $.\n"
+    "th $p wff x $=\n"
+    "  wx ax2 wx\n"
+    "  $.\n",
+    "$c wff $. $v x y $. wx $f wff x $. wy $f wff y $.\n"
+    "ax1 $a wff x $. ax2 $a wff x y $.\n"
+    "th $p wff x $= ( ax1 ax2 )\n"
+    "  AC A\n"
+    "  $.\n"
+  };
+  size_t i, j;
+  for (i = 0; i < file_size; i++) {
+    struct verifier vrf;
+    verifierInit(&vrf);
+    struct reader r;
+    readerInitString(&r, file[i]);
+    verifierBeginReadingFile(&vrf, &r);
+    verifierParseBlock(&vrf);
+    const struct diag* d = NULL;
+    for (j = 0; j < vrf.diags.diags.size; j++) {
+      if (vrf.diags.diags.vals[j].err == error_stackUnderflow) {
+        d = &vrf.diags.diags.vals[j];
+        break;
+      }
+    }
+    ut_assert(d, "no stack underflow in file %lu", i);
+/* the line of ax2, not the end of the proof */
+    ut_assert(d->line == 4, "underflow at line %lu in file %lu, expected 4",
+      d->line, i);
+    readerClean(&r);
+    verifierClean(&vrf);
+  }
+  return 0;
+}
+
+static int
+Test_verifierArenaPeak(void)
+{
+  enum {
+    steps = 2000
+  };
+  struct charArray file;
+  size_t i;
+  charArrayInit(&file, 1);
+  const char* head = "$c |- T $. ax $a |- T $. ${ h $e |- T $. st $a |- T $. $}\n"
+    "th $p |- T $= ax";
+  charArrayAppend(&file, head, strlen(head));
+  for (i = 0; i < steps; i++) {
+    charArrayAppend(&file, " st", 3);
+  }
+  charArrayAppend(&file, " $.\n", 4);
+  charArrayAdd(&file, '\0');
+  struct verifier vrf;
+  verifierInit(&vrf);
+  struct reader r;
+  readerInitString(&r, file.vals);
+  verifierBeginReadingFile(&vrf, &r);
+  verifierParseBlock(&vrf);
+  ut_assert(vrf.errc == 0, "%lu errors", vrf.errc);
+/* each result overwrites the argument, so the peak does not grow with the */
+/* number of steps */
+  ut_assert(vrf.arena.peak < 1024, "arena peak %lu bytes for %d steps",
+    vrf.arena.peak, steps);
+  readerClean(&r);
+  verifierClean(&vrf);
+  charArrayClean(&file);
+  return 0;
+}
+
 static int
 Test_verifierParseProvable(void)
 {
@@ -1143,7 +1221,7 @@ Test_verifierParseStatement(void)
 static int
 Test_verifierParseBlock(void)
 {
-  enum { file_size = 4 };
+  enum { file_size = 6 };
   const char* file[file_size] = {
 /* file 0 */
     "$c |- wff S 0 $. "
@@ -1176,26 +1254,45 @@ Test_verifierParseBlock(void)
     "$v x y B R $. \n"
     "tx $f | x $. ty $f | y $. tB $f | B $. tR $f | R $. \n"
     "${ $d x y $.  $d y B $.  $d y R $. $} \n",
-/* to do: write test for compressed proof with Z tag */
-
+/* file 4 - compressed proof with Z tag */
+    "$c num 0 S + $. $v x y $. "
+    "num.x $f num x $. num.y $f num y $. "
+    "numt.0 $a num 0 $. "
+    "numt.succ $a num S x $. "
+    "numt.plus $a num + x y $. "
+    "thm $p num + S 0 S 0 $= ( numt.0 numt.succ numt.plus ) ABZDC $. \n",
+/* file 5 - uncompressed proof repeating labels */
+    "$c num 0 S + $. $v x y $. "
+    "num.x $f num x $. num.y $f num y $. "
+    "numt.0 $a num 0 $. "
+    "numt.succ $a num S x $. "
+    "numt.plus $a num + x y $. "
+    "thm $p num + S 0 S 0 $= "
+    "numt.0 numt.succ numt.0 numt.succ numt.plus $. \n",
   };
   const enum error errs[file_size] = {
     error_none,
     error_none,
     error_none,
     error_none,
+    error_none,
+    error_none,
   };
   const size_t errc[file_size] = {
     0,
     0,
     0,
     0,
+    0,
+    0,
   };
   const size_t dsymnum[file_size] = {
     0,
     0,
     0,
-    3
+    3,
+    0,
+    0
   };
   size_t i;
   for (i = 0; i < file_size; i++) {
@@ -1220,6 +1317,354 @@ Test_verifierParseBlock(void)
   return 0;
 }
 
+/* a database for checking proofs after reading it */
+static const char* late_file =
+    "$c num 0 S $. $v x $. "
+    "num.x $f num x $. "
+    "numt.0 $a num 0 $. "
+    "numt.succ $a num S x $. "
+    "one $p num S 0 $= numt.0 numt.succ $. "
+    "bad $p num 0 $= numt.0 numt.succ $. "
+    "${ h $e num S 0 $. two $p num S S 0 $= h numt.succ $. $} "
+/* h is the hypothesis in scope at three, not the one of two */
+    "${ h $e num 0 $. "
+    "three $p num S S S 0 $= h numt.succ two numt.succ $. $}\n";
+
+static int
+Test_verifierCheckOnly(void)
+{
+  enum { case_size = 4 };
+  const char* only[case_size] = {"three", "bad", "three,bad,one", "none"};
+  const size_t proofc[case_size] = {2, 1, 4, 0};
+  const size_t errc[case_size] = {0, 1, 1, 1};
+  size_t i;
+  for (i = 0; i < case_size; i++) {
+    struct verifier vrf;
+    verifierInit(&vrf);
+    verifierSetOnly(&vrf, only[i]);
+    struct reader r;
+    readerInitString(&r, late_file);
+    verifierBeginReadingFile(&vrf, &r);
+    verifierParseBlock(&vrf);
+    ut_assert(vrf.proofc == 0, "checked %lu proofs while reading",
+      vrf.proofc);
+    verifierCheckOnly(&vrf);
+    ut_assert(vrf.proofc == proofc[i], "checked %lu proofs for %s, "
+      "expected %lu", vrf.proofc, only[i], proofc[i]);
+    ut_assert(vrf.errc == errc[i], "found %lu errors for %s, expected %lu",
+      vrf.errc, only[i], errc[i]);
+    readerClean(&r);
+    verifierClean(&vrf);
+  }
+  return 0;
+}
+
+static int
+Test_verifierSetLazy(void)
+{
+  struct verifier vrf;
+  verifierInit(&vrf);
+  verifierSetLazy(&vrf, 1);
+  struct reader r;
+  readerInitString(&r, late_file);
+  verifierBeginReadingFile(&vrf, &r);
+  verifierParseBlock(&vrf);
+  ut_assert(vrf.errc == 0 && vrf.proofc == 0, "checked %lu proofs while "
+    "reading", vrf.proofc);
+  ut_assert(verifierCountProofs(&vrf, proofState_unchecked) == 4,
+    "not all proofs are unchecked");
+/* on demand */
+  const size_t two = verifierFindLabel(&vrf, "two");
+  const size_t bad = verifierFindLabel(&vrf, "bad");
+  ut_assert(verifierCheckLate(&vrf, two) == proofState_verified,
+    "two failed");
+  ut_assert(verifierCheckLate(&vrf, bad) == proofState_failed,
+    "bad did not fail");
+  ut_assert(vrf.proofc == 2 && vrf.errc == 1, "checked %lu proofs with %lu "
+    "errors", vrf.proofc, vrf.errc);
+/* checked proofs are not checked again */
+  verifierCheckRange(&vrf, bad, two);
+  ut_assert(vrf.proofc == 2, "checked %lu proofs", vrf.proofc);
+/* the rest in the background */
+  verifierBeginChecking(&vrf);
+  verifierEndChecking(&vrf, 1);
+  ut_assert(verifierCountProofs(&vrf, proofState_verified) == 3,
+    "%lu proofs verified", verifierCountProofs(&vrf, proofState_verified));
+  ut_assert(verifierGetProofState(&vrf, bad) == proofState_failed,
+    "bad did not fail");
+  ut_assert(vrf.proofc == 4 && vrf.errc == 1, "checked %lu proofs with %lu "
+    "errors", vrf.proofc, vrf.errc);
+  readerClean(&r);
+  verifierClean(&vrf);
+  return 0;
+}
+
+/* labels and states are queried while the worker checks the proofs */
+static int
+Test_verifierQueryWhileChecking(void)
+{
+/* small enough for the buffer of a string reader */
+  enum { thm_size = 300 };
+  size_t i;
+  char label[32];
+  struct charArray file;
+  charArrayInit(&file, 1);
+  const char* head = "$c num 0 S $. $v x $. num.x $f num x $. "
+    "numt.0 $a num 0 $. numt.succ $a num S x $.\n";
+  charArrayAppend(&file, head, strlen(head));
+  for (i = 0; i < thm_size; i++) {
+    const int len = snprintf(label, sizeof(label), "t%lu", i);
+    charArrayAppend(&file, label, len);
+    const char* thm = " $p num S 0 $= numt.0 numt.succ $.\n";
+    charArrayAppend(&file, thm, strlen(thm));
+  }
+  charArrayAdd(&file, '\0');
+  struct verifier vrf;
+  verifierInit(&vrf);
+  verifierSetLazy(&vrf, 1);
+  struct reader r;
+  readerInitString(&r, file.vals);
+  verifierBeginReadingFile(&vrf, &r);
+  verifierParseBlock(&vrf);
+  const size_t first = verifierFindLabel(&vrf, "t0");
+  verifierBeginChecking(&vrf);
+  i = 0;
+  while (verifierCountProofs(&vrf, proofState_unchecked) > 0) {
+    snprintf(label, sizeof(label), "t%lu", i);
+    const size_t symId = verifierFindLabel(&vrf, label);
+    ut_assert(symId == first + i, "found %s at %lu, expected %lu", label,
+      symId, first + i);
+    ut_assert(verifierGetProofState(&vrf, symId) != proofState_failed,
+      "%s failed", label);
+    i = (i + 1) % thm_size;
+  }
+  verifierEndChecking(&vrf, 1);
+  ut_assert(verifierCountProofs(&vrf, proofState_verified) == thm_size,
+    "%lu proofs verified", verifierCountProofs(&vrf, proofState_verified));
+  ut_assert(vrf.errc == 0, "%lu errors", vrf.errc);
+  readerClean(&r);
+  verifierClean(&vrf);
+  charArrayClean(&file);
+  return 0;
+}
+
+static int
+Test_verifierGetDeps(void)
+{
+  size_t n;
+  struct verifier vrf;
+  verifierInit(&vrf);
+  struct reader r;
+  readerInitString(&r, late_file);
+  verifierBeginReadingFile(&vrf, &r);
+  verifierParseBlock(&vrf);
+  const size_t succ = verifierFindLabel(&vrf, "numt.succ");
+  const size_t two = verifierFindLabel(&vrf, "two");
+  const size_t three = verifierFindLabel(&vrf, "three");
+/* hypotheses are not assertions, and each assertion is listed once */
+  const size_t* deps = verifierGetDeps(&vrf, three, &n);
+  ut_assert(n == 2 && deps[0] == succ && deps[1] == two, "three has %lu "
+    "deps", n);
+  const size_t* rdeps = verifierGetRdeps(&vrf, two, &n);
+  ut_assert(n == 1 && rdeps[0] == three, "two has %lu rdeps", n);
+  verifierGetRdeps(&vrf, succ, &n);
+  ut_assert(n == 4, "numt.succ has %lu rdeps, expected 4", n);
+  verifierGetRdeps(&vrf, three, &n);
+  ut_assert(n == 0, "three has %lu rdeps", n);
+  struct symstring cone;
+  symstringInit(&cone);
+  verifierGetCone(&vrf, verifierFindLabel(&vrf, "numt.0"), &cone);
+/* one and bad, as two starts from its hypothesis */
+  ut_assert(cone.size == 2, "cone of numt.0 has %lu theorems", cone.size);
+  cone.size = 0;
+  verifierGetCone(&vrf, two, &cone);
+  ut_assert(cone.size == 1 && cone.vals[0] == three, "cone of two has %lu "
+    "theorems", cone.size);
+  symstringClean(&cone);
+  readerClean(&r);
+  verifierClean(&vrf);
+  return 0;
+}
+
+/* late_file moved down two lines, with the proof of bad fixed */
+static const char* late_file_fixed =
+    "\n\n$c num 0 S $. $v x $. "
+    "num.x $f num x $. "
+    "numt.0 $a num 0 $. "
+    "numt.succ $a num S x $. "
+    "one $p num S 0 $= numt.0 numt.succ $. "
+    "bad $p num 0 $= numt.0 $. "
+    "${ h $e num S 0 $. two $p num S S 0 $= h numt.succ $. $} "
+    "${ h $e num 0 $. "
+    "three $p num S S S 0 $= h numt.succ two numt.succ $. $}\n";
+
+/* late_file_fixed with the statement of numt.succ broken */
+static const char* late_file_changed =
+    "\n\n$c num 0 S $. $v x $. "
+    "num.x $f num x $. "
+    "numt.0 $a num 0 $. "
+    "numt.succ $a num S S x $. "
+    "one $p num S 0 $= numt.0 numt.succ $. "
+    "bad $p num 0 $= numt.0 $. "
+    "${ h $e num S 0 $. two $p num S S 0 $= h numt.succ $. $} "
+    "${ h $e num 0 $. "
+    "three $p num S S S 0 $= h numt.succ two numt.succ $. $}\n";
+
+static int
+Test_verifierRecheck(void)
+{
+  size_t i, j, n;
+  struct verifier vrf;
+  verifierInit(&vrf);
+  verifierSetLazy(&vrf, 1);
+  struct reader r;
+  readerInitString(&r, late_file);
+  verifierBeginReadingFile(&vrf, &r);
+  verifierParseBlock(&vrf);
+  const size_t bad = verifierFindLabel(&vrf, "bad");
+  verifierBeginChecking(&vrf);
+  ut_assert(!verifierGetDeps(&vrf, bad, &n) && n == 0, "deps while "
+    "checking in the background");
+  verifierEndChecking(&vrf, 1);
+  ut_assert(vrf.proofc == 4 && vrf.errc == 1, "checked %lu proofs with %lu "
+    "errors", vrf.proofc, vrf.errc);
+  const size_t deps = vrf.deps.size;
+/* only two and its cone are checked again */
+  size_t failed = verifierRecheck(&vrf, verifierFindLabel(&vrf, "two"), NULL);
+  ut_assert(failed == 0, "%lu proofs failed", failed);
+  ut_assert(vrf.proofc == 6, "checked %lu proofs, expected 6", vrf.proofc);
+/* the error of bad and the rows are replaced, not added */
+  failed = verifierRecheck(&vrf, verifierFindLabel(&vrf, "numt.succ"), NULL);
+  ut_assert(failed == 1, "%lu proofs failed, expected 1", failed);
+  ut_assert(vrf.proofc == 10 && vrf.errc == 1, "checked %lu proofs with %lu "
+    "errors", vrf.proofc, vrf.errc);
+  ut_assert(vrf.diags.diags.size == 1, "%lu diagnostics",
+    vrf.diags.diags.size);
+  ut_assert(vrf.deps.size == deps, "%lu deps, expected %lu", vrf.deps.size,
+    deps);
+/* the changed input is read */
+  struct reader fixed;
+  readerInitString(&fixed, late_file_fixed);
+  failed = verifierRecheck(&vrf, bad, &fixed);
+  ut_assert(failed == 0 && vrf.errc == 0, "%lu proofs failed with %lu "
+    "errors", failed, vrf.errc);
+  ut_assert(verifierGetProofState(&vrf, bad) == proofState_verified,
+    "bad was not verified");
+  const size_t* ids = verifierGetDeps(&vrf, bad, &n);
+  ut_assert(n == 1 && ids[0] == verifierFindLabel(&vrf, "numt.0"),
+    "bad has %lu deps", n);
+/* the other proofs moved down too */
+  failed = verifierRecheck(&vrf, verifierFindLabel(&vrf, "numt.succ"), NULL);
+  ut_assert(failed == 0 && vrf.errc == 0, "%lu proofs failed with %lu "
+    "errors", failed, vrf.errc);
+  ut_assert(verifierCountProofs(&vrf, proofState_verified) == 4,
+    "%lu proofs verified", verifierCountProofs(&vrf, proofState_verified));
+/* the row of bad grows and shrinks, and its error comes and goes, but */
+/* deps and the text of the diagnostics do not keep growing */
+  for (i = 0; i < 20; i++) {
+    verifierRecheck(&vrf, bad, (i % 2 == 0) ? &r : &fixed);
+    size_t used = 0;
+    for (j = 0; j < vrf.locs.size; j++) {
+      used += vrf.locs.vals[j].depc;
+    }
+    ut_assert(vrf.deps.size <= 2 * used, "%lu deps for %lu in use",
+      vrf.deps.size, used);
+    ut_assert(vrf.diags.text.size < 100, "%lu characters of diagnostics",
+      vrf.diags.text.size);
+  }
+  ut_assert(vrf.errc == 0, "%lu errors", vrf.errc);
+/* the statement of numt.succ changed, which is not read again */
+  struct reader changed;
+  readerInitString(&changed, late_file_changed);
+  failed = verifierRecheck(&vrf, verifierFindLabel(&vrf, "numt.succ"),
+    &changed);
+  ut_assert(failed == 0 && vrf.err == error_changedStatement
+    && vrf.errc == 1, "changed statement not found");
+  ut_assert(vrf.r == &fixed, "the changed input was taken");
+  readerClean(&changed);
+  readerClean(&fixed);
+  readerClean(&r);
+  verifierClean(&vrf);
+  return 0;
+}
+
+static int
+Test_verifierFindConclusions(void)
+{
+  struct verifier vrf;
+  verifierInit(&vrf);
+  struct reader r;
+  readerInitString(&r, late_file);
+  verifierBeginReadingFile(&vrf, &r);
+  verifierParseBlock(&vrf);
+  const size_t three = verifierFindLabel(&vrf, "three");
+  struct symstring found;
+  symstringInit(&found);
+/* only num S x and three itself could give num S S S 0 */
+  verifierFindConclusions(&vrf, &vrf.stmts.vals[vrf.symbols.vals[three].stmt],
+    &found);
+  ut_assert(found.size == 2, "found %lu candidates, expected 2", found.size);
+  ut_assert(symstringIsIn(&found, verifierFindLabel(&vrf, "numt.succ"))
+    && symstringIsIn(&found, three), "numt.succ or three not found");
+  symstringClean(&found);
+  readerClean(&r);
+  verifierClean(&vrf);
+  return 0;
+}
+
+static int
+Test_verifierFindDuplicates(void)
+{
+  size_t i;
+  struct verifier vrf;
+  verifierInit(&vrf);
+  struct reader r;
+/* ax-mp2 and ax-1b rename variables of the same type. ax-mp3 has its */
+/* hypotheses in another order, ax-1c uses one variable twice, ax-e3 lacks */
+/* the restriction and ax-e4 renames a class to a wff */
+  readerInitString(&r,
+    "$c ( ) -> wff |- class = $.\n"
+    "$v ph ps ch A B $.\n"
+    "wph $f wff ph $. wps $f wff ps $. wch $f wff ch $.\n"
+    "cA $f class A $. cB $f class B $.\n"
+    "wi $a wff ( ph -> ps ) $.\n"
+    "weq $a wff A = B $.\n"
+    "${ min $e |- ph $. maj $e |- ( ph -> ps ) $. ax-mp $a |- ps $. $}\n"
+    "${ min2 $e |- ch $. maj2 $e |- ( ch -> ph ) $. ax-mp2 $a |- ph $. $}\n"
+    "${ maj3 $e |- ( ph -> ps ) $. min3 $e |- ph $. ax-mp3 $a |- ps $. $}\n"
+    "ax-1 $a |- ( ph -> ( ps -> ph ) ) $.\n"
+    "ax-1b $a |- ( ps -> ( ph -> ps ) ) $.\n"
+    "ax-1c $a |- ( ph -> ( ph -> ph ) ) $.\n"
+    "${ $d A B $. ax-e $a |- A = B $. $}\n"
+    "${ $d A B $. ax-e2 $a |- B = A $. $}\n"
+    "ax-e3 $a |- A = B $.\n"
+    "ax-e4 $a |- ph = B $.\n"
+    "th1 $p |- ( ch -> ( ph -> ch ) ) $= wch wph ax-1 $.\n");
+  verifierBeginReadingFile(&vrf, &r);
+  verifierParseBlock(&vrf);
+  ut_assert(vrf.errc == 0, "%lu errors", vrf.errc);
+  struct size_tArray found;
+  size_tArrayInit(&found, 1);
+  const size_t groupc = verifierFindDuplicates(&vrf, &found);
+  const char* groups[] = {"ax-mp", "ax-mp2", NULL, "ax-1", "ax-1b", "th1",
+    NULL, "ax-e", "ax-e2", NULL};
+  const size_t size = sizeof(groups) / sizeof(groups[0]);
+  ut_assert(groupc == 3, "found %lu groups, expected 3", groupc);
+  ut_assert(found.size == size, "found %lu symbols, expected %lu",
+    found.size, size);
+  for (i = 0; i < size; i++) {
+    const size_t symId = groups[i] ? verifierFindLabel(&vrf, groups[i])
+      : symbol_none_id;
+    ut_assert(found.vals[i] == symId, "found %s at %lu, expected %s",
+      verifierGetSymName(&vrf, found.vals[i]), i,
+      groups[i] ? groups[i] : "the end");
+  }
+  size_tArrayClean(&found);
+  readerClean(&r);
+  verifierClean(&vrf);
+  return 0;
+}
+
 static int
 all(void)
 {
@@ -1245,11 +1690,20 @@ all(void)
   ut_run(Test_verifierParseAssertion);
   ut_run(Test_verifierParseProofSymbol);
   ut_run(Test_verifierParseProof);
+  ut_run(Test_verifierProofErrorLocation);
+  ut_run(Test_verifierArenaPeak);
   ut_run(Test_verifierParseProvable);
   ut_run(Test_verifierParseUnlabelledStatement);
   ut_run(Test_verifierParseLabelledStatement);
   ut_run(Test_verifierParseStatement);
   ut_run(Test_verifierParseBlock);
+  ut_run(Test_verifierCheckOnly);
+  ut_run(Test_verifierSetLazy);
+  ut_run(Test_verifierQueryWhileChecking);
+  ut_run(Test_verifierGetDeps);
+  ut_run(Test_verifierRecheck);
+  ut_run(Test_verifierFindConclusions);
+  ut_run(Test_verifierFindDuplicates);
   return 0;
 }
 
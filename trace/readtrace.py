@@ -1,102 +1,152 @@
-#!/usr/bin/python
+#!/usr/bin/env python3
 # -*- coding: utf-8 -*-
+"""Analyze the binary traces written by trace.c.
+
+Prints the call count and the inclusive and exclusive time of each
+function, and writes collapsed stacks for flame graphs (one line per stack,
+'outer;inner;innermost nanoseconds', as read by flamegraph.pl).
+"""
 
 import argparse
-parser = argparse.ArgumentParser(description="Perform an analysis on the " +
-    "program trace. The output gives the function name, the call count, and " +
-    "the time spent.")
-parser.add_argument("prgm", help="program that produced trace")
-parser.add_argument("trace", help="trace to read")
-parser.add_argument("-o", "--out", help="output file", default=None)
-parser.add_argument('-t', '--time', help='sort by time', action="store_true")
-parser.add_argument('-c', '--call', help='sort by call', action='store_true')
-parser.add_argument('-f', '--force', help='force analysis',action="store_true")
-args = parser.parse_args()
-# check file existence
-tmp = open(args.prgm)
-tmp.close()
-if not args.out:
-    args.out = args.prgm + ".sum"
-# do we need to analyze? Look at trace and analysis time stamps
-do_analyze = 1
+import collections
 import os
-if os.path.isfile(args.out):
-    trace_mtime = os.stat(args.trace).st_mtime
-    out_mtime = os.stat(args.out)
-    # trace is older than the analysis
-    if trace_mtime < out_mtime:
-        do_analyze = 0
-if args.force:
-    do_analyze = 1
+import struct
 import subprocess
-def analyze_trace():
-    print "analyzing {0} for {1}".format(args.trace, args.prgm)
-    trace = open(args.trace)
-    # runmain stores the runtime address of main
-    # time stores the previous time
-    _, runmain, kernel, ptime = trace.readline().split(' ')
-    # for each function, a pair of
-    # (number of function calls, total time in function)
-    stat = {}
-    # add the first caller (the kernel)
-    stat[kernel] = [0, 0.0]
-    # whenever a function is called, add it to the stack
+import sys
+
+# must match struct traceHeader and struct traceEvent in trace.c
+HEADER = struct.Struct("<8sQQQQ3Q")
+EVENT = struct.Struct("<QQII")
+MAGIC = b"HTRACE1\0"
+ENTER, EXIT = 0, 1
+
+
+def read_trace(filename):
+    """Return the header fields and the events in the order recorded."""
+    with open(filename, "rb") as f:
+        data = f.read()
+    magic, capacity, count, tid, anchor = HEADER.unpack_from(data)[:5]
+    if magic != MAGIC:
+        sys.exit("{0} is not a trace".format(filename))
+    n = min(count, capacity)
+    # once the ring has wrapped, the oldest event is at count % capacity
+    first = count % capacity if count > capacity else 0
+    events = []
+    for i in range(n):
+        offset = HEADER.size + ((first + i) % capacity) * EVENT.size
+        events.append(EVENT.unpack_from(data, offset))
+    return tid, anchor, count, events
+
+
+def read_symbols(prgm):
+    """Map static function addresses to names using nm."""
+    out = subprocess.run(["nm", "--defined-only", prgm], check=True,
+                         stdout=subprocess.PIPE, universal_newlines=True)
+    symbols = {}
+    for line in out.stdout.splitlines():
+        fields = line.split()
+        if len(fields) == 3 and fields[1] in "tTwW":
+            symbols[int(fields[0], 16)] = fields[2]
+    return symbols
+
+
+def analyze(events, name):
+    """Return per-function statistics and collapsed stacks.
+
+    stats maps a function to [calls, inclusive ns, exclusive ns]. Recursive
+    calls count towards the inclusive time of the outermost call only.
+    """
+    stats = collections.defaultdict(lambda: [0, 0, 0])
+    stacks = collections.Counter()
+    # entries are (function, entry time, time spent in callees)
     stack = []
-    # add main()
-    stack.append(runmain)
-    ptime = float(ptime)
-    trace.seek(0)
-    for data in trace:
-        ex, callee, _, time = data.split(' ')
-        time = float(time)
-        if ex == 'e':
-            if not callee in stat:
-                stat[callee] = [0, 0.0]
-            # function entry. Add the call count of callee and time of caller
-            stat[callee][0] += 1
-            # the caller is the top of the stack
-            stat[stack[-1]][1] += time - ptime
-            stack.append(callee)
-        elif ex == 'x':
-            # function exit
-            stat[stack[-1]][1] += time - ptime
-            stack.pop()
-        ptime = time
-    trace.close()
-    # get the address of main() in the elf binary
-    gobjdump = subprocess.Popen("gobjdump -d {0}".format(args.prgm).split(),
-        stdout=subprocess.PIPE)
-    grep = subprocess.Popen("grep -m 1 _main".split(), stdin=gobjdump.stdout,
-        stdout=subprocess.PIPE)
-    gobjdump.stdout.close()
-    elfmain = int(grep.communicate()[0].split(' ', 1)[0], 16)
-    gobjdump.wait()
-    # compute the slide offset
-    runmain = int(runmain, 16)
-    slide = runmain - elfmain
-    # begin output
-    out = open(args.out, "w+")
-    for fn, data in stat.iteritems():
-        # symbolicate function address
-        atos = subprocess.Popen("atos -d -s {0} -o {1} {2}".format(hex(slide),
-         args.prgm,fn).split(' '),stdin=subprocess.PIPE,stdout=subprocess.PIPE)
-        symb, err = atos.communicate()
-        syms = symb[0:symb.find('(')] + symb[symb.find(')')+2:-1]
-        sym, _, src = syms.partition(' ')
-        if not src:
-            src = "(unknown)"
-        sym = sym[:22] + (sym[22:] and '..')
-        src = src[:22] + (src[22:] and '..')
-        out.write("{0:24} {1:24} {2:>14} {3:>14}\n".format(sym, src, data[0],
-            data[1]))
-    out.close()
-    print "wrote to {0}".format(args.out)
-
-if do_analyze:
-    analyze_trace()
-
-# sort and print the trace
-if args.time:
-    subprocess.call("sort -n -b -r -k 4 {0}".format(args.out).split(' '))
-elif args.call:
-    subprocess.call("sort -n -b -r -k 3 {0}".format(args.out).split(' '))
+    active = collections.Counter()
+    for fn, time, _, kind in events:
+        if kind == ENTER:
+            stats[name(fn)][0] += 1
+            active[fn] += 1
+            stack.append([fn, time, 0])
+            continue
+        # exits without an entry were recorded before the ring wrapped
+        if not stack or stack[-1][0] != fn:
+            continue
+        fn, start, callees = stack.pop()
+        total = time - start
+        active[fn] -= 1
+        s = stats[name(fn)]
+        if active[fn] == 0:
+            s[1] += total
+        s[2] += total - callees
+        path = ";".join(name(f) for f, _, _ in stack)
+        path = path + ";" + name(fn) if path else name(fn)
+        stacks[path] += total - callees
+        if stack:
+            stack[-1][2] += total
+    return stats, stacks
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Analyze the program trace. "
+        "The output gives the function name, the call count, and the "
+        "inclusive and exclusive time in milliseconds.")
+    parser.add_argument("prgm", help="program that produced the trace")
+    parser.add_argument("traces", nargs="+",
+                        help="trace files, trace.out.<thread id>")
+    parser.add_argument("-o", "--out", default=None,
+                        help="file for collapsed stacks (default: "
+                        "PRGM.folded)")
+    parser.add_argument("-t", "--time", action="store_true",
+                        help="sort by exclusive time (default: inclusive)")
+    parser.add_argument("-c", "--call", action="store_true",
+                        help="sort by call count")
+    parser.add_argument("-n", "--lines", type=int, default=40,
+                        help="number of functions to print")
+    args = parser.parse_args()
+    if not args.out:
+        args.out = args.prgm + ".folded"
+    symbols = read_symbols(args.prgm)
+    anchor_static = next((a for a, s in symbols.items()
+                          if s == "trace_anchor"), None)
+    if anchor_static is None:
+        sys.exit("{0} was not linked with trace.o".format(args.prgm))
+    stats = collections.defaultdict(lambda: [0, 0, 0])
+    stacks = collections.Counter()
+    for filename in args.traces:
+        tid, anchor, count, events = read_trace(filename)
+        if count > len(events):
+            print("{0}: ring wrapped, kept the last {1} of {2} events".format(
+                filename, len(events), count))
+        slide = anchor - anchor_static
+
+        def name(fn):
+            return symbols.get(fn - slide, hex(fn - slide))
+
+        s, st = analyze(events, name)
+        for fn, v in s.items():
+            t = stats[fn]
+            t[0] += v[0]
+            t[1] += v[1]
+            t[2] += v[2]
+        # one flame graph root per thread
+        for path, v in st.items():
+            stacks["thread {0};{1}".format(tid, path)] += v
+    with open(args.out, "w") as out:
+        for path, v in sorted(stacks.items()):
+            out.write("{0} {1}\n".format(path, v))
+    key = 1
+    if args.time:
+        key = 2
+    if args.call:
+        key = 0
+    rows = sorted(stats.items(), key=lambda kv: kv[1][key], reverse=True)
+    print("{0:32} {1:>12} {2:>14} {3:>14}".format("function", "calls",
+          "inclusive ms", "exclusive ms"))
+    for fn, (calls, incl, excl) in rows[:args.lines]:
+        fn = fn[:30] + (fn[30:] and "..")
+        print("{0:32} {1:>12} {2:>14.3f} {3:>14.3f}".format(fn, calls,
+              incl / 1e6, excl / 1e6))
+    print("wrote collapsed stacks to {0}".format(args.out))
+
+
+if __name__ == "__main__":
+    main()
@@ -3,80 +3,174 @@
 /* usage */
 /* compile the code to instrument with -c and -finstrument-functions */
 /* compile this file with gcc -c FILENAME -o FILENAME.o, without the */
-/* -finstrument-functions (otherwise it will crash) */
-/* link them together */
-
+/* -finstrument-functions */
+/* link them together, or use 'make trace' */
+/* */
+/* Every function entry and exit is recorded as a fixed-size binary event */
+/* in a ring buffer. Each thread has its own buffer, memory-mapped from the */
+/* file trace.out.<thread id>, so recording an event is a few stores and */
+/* nothing has to be flushed at exit. When a buffer is full the oldest */
+/* events are overwritten. The number of events per thread can be set with */
+/* the environment variable HALMOS_TRACE_EVENTS. Read the traces with */
+/* readtrace.py */
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
 #include <sys/types.h>
 #include <time.h>
 #include <unistd.h>
 
-// #include <mach/mach.h>
-// #include <mach/mach_vm.h>
-// #include <mach-o/getsect.h>
+#define NOTRACE __attribute__((no_instrument_function))
+
+enum {
+  trace_enter = 0,
+  trace_exit = 1
+};
+
+/* must match readtrace.py */
+struct traceEvent {
+/* address of the function */
+  uint64_t fn;
+/* nanoseconds, CLOCK_MONOTONIC */
+  uint64_t time;
+  uint32_t tid;
+  uint32_t type;
+};
+
+struct traceHeader {
+  char magic[8];
+/* number of events the ring holds */
+  uint64_t capacity;
+/* number of events written. The ring starts at count % capacity once it */
+/* has wrapped */
+  uint64_t count;
+  uint64_t tid;
+/* the address of trace_anchor in this process, for undoing the relocation */
+/* of position independent executables */
+  uint64_t anchor;
+  uint64_t reserved[3];
+};
+
+struct traceBuffer {
+  struct traceHeader* header;
+  struct traceEvent* events;
+  size_t size;
+};
+
+static const char trace_file[] = "trace.out";
+static const char trace_magic[8] = "HTRACE1";
+static const uint64_t trace_default_capacity = 1 << 20;
+
+static __thread struct traceBuffer trace_buffer;
+/* set if the buffer of the thread could not be created */
+static __thread int trace_failed;
+
+void NOTRACE
+trace_anchor(void)
+{
+}
+
+static uint64_t NOTRACE
+traceNow(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000u + (uint64_t) ts.tv_nsec;
+}
 
-static FILE* trace;
+static uint32_t NOTRACE
+traceTid(void)
+{
+  return (uint32_t) syscall(SYS_gettid);
+}
 
-static const char* trace_file = "trace.out";
-void
-__attribute__((constructor))
-begin_trace(void)
+static int NOTRACE
+traceOpen(struct traceBuffer* b)
 {
-  trace = fopen(trace_file, "w");
-  if (trace == NULL) {
-    fprintf(stderr, "failed to open %s\n", trace_file);
-    exit(0);
+  uint64_t capacity = trace_default_capacity;
+  const char* env = getenv("HALMOS_TRACE_EVENTS");
+  if (env && strtoull(env, NULL, 10) > 0) {
+    capacity = strtoull(env, NULL, 10);
+  }
+  const uint32_t tid = traceTid();
+  char filename[sizeof(trace_file) + 32];
+  snprintf(filename, sizeof(filename), "%s.%u", trace_file, tid);
+  int fd = open(filename, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    fprintf(stderr, "failed to open %s\n", filename);
+    return 0;
   }
-  // printf("etext %p\n", (void*)get_etext());
-/* get the base address of the process */
+  b->size = sizeof(struct traceHeader) + capacity * sizeof(struct traceEvent);
+  if (ftruncate(fd, b->size) != 0) {
+    fprintf(stderr, "failed to size %s\n", filename);
+    close(fd);
+    return 0;
+  }
+  void* p = mmap(NULL, b->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (p == MAP_FAILED) {
+    fprintf(stderr, "failed to map %s\n", filename);
+    return 0;
+  }
+  b->header = p;
+  b->events = (struct traceEvent*) (b->header + 1);
+  memcpy(b->header->magic, trace_magic, sizeof(trace_magic));
+  b->header->capacity = capacity;
+  b->header->count = 0;
+  b->header->tid = tid;
+  b->header->anchor = (uint64_t) (uintptr_t) &trace_anchor;
+  return 1;
+}
 
-/* old version: this is most probably wrong */
-  // pid_t pid = getpid();
-  // mach_port_t task;
-  // kern_return_t kern_return = task_for_pid(mach_task_self(), pid, &task);
-  // if (kern_return != KERN_SUCCESS) {
-  //   printf("task_for_pid failed, error [%s]", mach_error_string(kern_return));
-  //   exit(1);
-  // }
-  // kern_return_t kret;
-  // vm_region_basic_info_data_t info;
-  // mach_vm_size_t size;
-  // mach_port_t object_name;
-  // mach_msg_type_number_t count;
-  // mach_vm_address_t address = 1;
-  // kret = mach_vm_region(task, &address, &size, VM_REGION_BASIC_INFO,
-  //   (vm_region_info_t) &info, &count, &object_name);
-  // if (kret != KERN_SUCCESS) {
-  //   printf("mach_vm_region failed, error [%s]",
-  //    mach_error_string(kern_return));
-  //   exit(1);
-  // }
-  // printf("base addr: %llx\n", address);
+static inline void NOTRACE
+traceRecord(void* fn, uint32_t type)
+{
+  struct traceBuffer* b = &trace_buffer;
+  if (!b->header) {
+    if (trace_failed) { return; }
+    if (!traceOpen(b)) {
+      trace_failed = 1;
+      return;
+    }
+  }
+  struct traceHeader* h = b->header;
+  struct traceEvent* e = &b->events[h->count % h->capacity];
+  e->fn = (uint64_t) (uintptr_t) fn;
+  e->time = traceNow();
+  e->tid = (uint32_t) h->tid;
+  e->type = type;
+  h->count++;
 }
 
-void
+void NOTRACE
 __attribute__((destructor))
 end_trace(void)
 {
-  if (trace != NULL) {
-    fclose(trace);
-    printf("wrote trace log to %s\n", trace_file);
+  struct traceBuffer* b = &trace_buffer;
+  if (b->header) {
+    printf("wrote %llu trace events to %s.%llu\n",
+      (unsigned long long) b->header->count, trace_file,
+      (unsigned long long) b->header->tid);
+    munmap(b->header, b->size);
+    b->header = NULL;
   }
 }
-#include <stdlib.h>
-void
+
+void NOTRACE
 __cyg_profile_func_enter(void* this_fn, void* call_site)
 {
-  if (trace != NULL) {
-    fprintf(trace, "e %p %p %lu\n", this_fn, call_site, clock());
-  }
+  (void) call_site;
+  traceRecord(this_fn, trace_enter);
 }
 
-void
+void NOTRACE
 __cyg_profile_func_exit(void* this_fn, void* call_site)
 {
-  if (trace != NULL) {
-    fprintf(trace, "x %p %p %lu\n", this_fn, call_site, clock());
-  }
+  (void) call_site;
+  traceRecord(this_fn, trace_exit);
 }